@@ -3,49 +3,244 @@
 
 #include <Exceptions.h>
 #include <ServerGame.h>
-#include <ChangeRemove.h>
-#include <ChangeLeave.h>
-#include <ChangeEnter.h>
 #include <ChangeList.pb.h>
+#include <PayloadBuilder.h>
 
 
 DEFINE_int32(max_change_list_size, 100, "Maximum amount of changes (game turns) stored in memory");
 
+std::vector<ChangeList::Pending> ChangeList::mPending;
+std::vector< boost::shared_ptr<ChangeList::Turn> > ChangeList::mJournal;
+uint32 ChangeList::mTurn = 0;
+
+ChangeList::~ChangeList()
+{
+    if (mPendingCount > 0)
+    {
+        size_t kept = 0;
+        for (size_t i = 0; i < mPending.size(); ++i)
+        {
+            if (mPending[i].mList != this)
+            {
+                mPending[kept++] = mPending[i];
+            }
+        }
+        mPending.resize(kept);
+    }
+}
+
+void ChangeList::Add(Turn::Type aType, UnitId aUnit, TileId aTile, uint32 aVisualCode)
+{
+    const Pending pending = { this, { aType, aUnit, aTile, aVisualCode } };
+    mPending.push_back(pending);
+    ++mPendingCount;
+}
+
 void ChangeList::AddEnter(UnitId aUnit, uint32 aVisualCode, TileId aFrom)
 {
-    mCurrentChanges.push_back(new ChangeEnter(aUnit, aVisualCode, aFrom, mTileId));
+    Add(Turn::ENTER, aUnit, aFrom, aVisualCode);
 }
 
 void ChangeList::AddLeave(UnitId aUnit, TileId aTo)
 {
-    mCurrentChanges.push_back(new ChangeLeave(aUnit, aTo));
+    Add(Turn::LEAVE, aUnit, aTo, 0);
+}
+
+void ChangeList::AddRemove(UnitId aUnit)
+{
+    Add(Turn::REMOVE, aUnit, 0, 0);
+}
+
+void ChangeList::AddCreate(UnitId aUnit, uint32 aVisualCode)
+{
+    Add(Turn::CREATE, aUnit, 0, aVisualCode);
+}
+
+void ChangeList::CommitTurn()
+{
+    if (mJournal.empty())
+    {
+        mJournal.resize(std::max(FLAGS_max_change_list_size, 1));
+    }
+    // Journal of the turn which left the history, snapshots may still read it
+    boost::shared_ptr<Turn>& turn = mJournal[mTurn % mJournal.size()];
+    if (turn.unique())
+    {
+        turn->Clear();
+    }
+    else
+    {
+        turn.reset(new Turn());
+    }
+
+    // Changes of each tile become one range, in order they happened
+    std::stable_sort(mPending.begin(), mPending.end(), IsBefore);
+    for (size_t i = 0; i < mPending.size(); ++i)
+    {
+        ChangeList* list = mPending[i].mList;
+        turn->Add(list->mTileId, mPending[i].mChange);
+        list->mPendingCount = 0;
+    }
+    mPending.clear();
+    ++mTurn;
 }
 
-void ChangeList::Commit()
+ChangeList::TurnPtr ChangeList::GetTurnChanges(uint32 aTurn)
 {
-    mChanges.push_front(TurnChanges());
-    TurnChanges& front = mChanges.front();
-    front.transfer(front.end(), mCurrentChanges.begin(), mCurrentChanges.end(), mCurrentChanges);
+    if (aTurn >= mTurn || mTurn - aTurn > mJournal.size())
+    {
+        boost::throw_exception(std::out_of_range("Turn is not in change list"));
+    }
+    return mJournal[aTurn % mJournal.size()];
 }
 
-void ChangeList::Write(INetwork& aNetwork, size_t aIndex, VisibleTiles& aVisibleTiles) const
+void ChangeList::Turn::Clear()
 {
-    const TurnChanges& turnChanges = mChanges.at(aIndex);
-    if (!turnChanges.empty())
+    // Only unheld turn is cleared, nobody encodes it meanwhile
+    mChanges.clear();
+    mFragments.clear();
+    mWire.clear();
+    mEncoded.store(false, boost::memory_order_relaxed);
+    mRanges.clear();
+}
+
+void ChangeList::Turn::Add(TileId aTileId, const Change& aRecord)
+{
+    const uint32 index = mChanges.size();
+    if (mRanges.empty() || mRanges.back().mTileId != aTileId)
     {
-        PayloadMsg msg;
-        msg.set_last(false);
-        TurnChanges::const_iterator i = turnChanges.begin();
-        for (;i != turnChanges.end(); ++i)
+        const Range range = { aTileId, index, index };
+        mRanges.push_back(range);
+    }
+    ++mRanges.back().mEnd;
+    mChanges.push_back(aRecord);
+}
+
+void ChangeList::Turn::Encode() const
+{
+    if (mEncoded.load(boost::memory_order_acquire))
+    {
+        return;
+    }
+    boost::lock_guard<boost::mutex> lock(mEncodeMutex);
+    if (mEncoded.load(boost::memory_order_relaxed))
+    {
+        return;
+    }
+
+    mFragments.resize(mChanges.size());
+    PayloadMsg msg;
+    for (size_t r = 0; r < mRanges.size(); ++r)
+    {
+        for (uint32 i = mRanges[r].mBegin; i != mRanges[r].mEnd; ++i)
         {
-            ChangeMsg* change = msg.add_changes();
-            i->FillChangeMsg(*change, aVisibleTiles);
+            const Change& record = mChanges[i];
+            Fragment& fragment = mFragments[i];
+            msg.Clear();
+            fragment.mHidden = mWire.size();
+            FillChangeMsg(*msg.add_changes(), mRanges[r].mTileId, record, false);
+            msg.AppendToString(&mWire);
+            fragment.mHiddenEnd = mWire.size();
+            if (record.mType == REMOVE || record.mType == CREATE)
+            {
+                // Other tile is not used
+                fragment.mVisible = fragment.mHidden;
+                fragment.mVisibleEnd = fragment.mHiddenEnd;
+            }
+            else
+            {
+                msg.Clear();
+                fragment.mVisible = mWire.size();
+                FillChangeMsg(*msg.add_changes(), mRanges[r].mTileId, record, true);
+                msg.AppendToString(&mWire);
+                fragment.mVisibleEnd = mWire.size();
+            }
         }
-        aNetwork.WriteMessage(msg);
     }
+    mEncoded.store(true, boost::memory_order_release);
 }
 
-void ChangeList::AddRemove(UnitId aUnit)
+void ChangeList::Turn::GetUnitChanges(std::vector<UnitChange>& aChanges) const
 {
-    mCurrentChanges.push_back(new ChangeRemove(aUnit));
+    for (size_t r = 0; r < mRanges.size(); ++r)
+    {
+        for (uint32 i = mRanges[r].mBegin; i != mRanges[r].mEnd; ++i)
+        {
+            const Change& record = mChanges[i];
+            const bool entered = record.mType == ENTER || record.mType == CREATE;
+            const UnitChange change = { mRanges[r].mTileId, record.mUnitId, entered, record.mVisualCode };
+            aChanges.push_back(change);
+        }
+    }
+}
+
+const ChangeList::Turn::Range* ChangeList::Turn::GetRange(TileId aTileId) const
+{
+    const Range key = { aTileId, 0, 0 };
+    std::vector<Range>::const_iterator it = std::lower_bound(mRanges.begin(), mRanges.end(), key, IsBefore);
+    if (it != mRanges.end() && it->mTileId == aTileId)
+    {
+        return &*it;
+    }
+    return NULL;
+}
+
+void ChangeList::Turn::FillChangeMsg(ChangeMsg& aChange, TileId aTileId, const Change& aRecord, bool aOtherVisible)
+{
+    switch (aRecord.mType)
+    {
+    case ENTER:
+    {
+        UnitEnterMsg* msg = aChange.mutable_unitenter();
+        msg->set_unitid(aRecord.mUnitId);
+        msg->set_to(aTileId);
+        if (!aOtherVisible)
+        {
+            msg->set_visualcode(aRecord.mVisualCode);
+        }
+        break;
+    }
+    case LEAVE:
+        if (!aOtherVisible)
+        {
+            UnitLeaveMsg* msg = aChange.mutable_unitleave();
+            msg->set_unitid(aRecord.mUnitId);
+            msg->set_to(aRecord.mTile);
+        }
+        break;
+    case REMOVE:
+        aChange.mutable_remove()->set_unitid(aRecord.mUnitId);
+        break;
+    case CREATE:
+    {
+        // Nobody saw the unit before, so everybody needs its visual code
+        UnitEnterMsg* msg = aChange.mutable_unitenter();
+        msg->set_unitid(aRecord.mUnitId);
+        msg->set_to(aTileId);
+        msg->set_visualcode(aRecord.mVisualCode);
+        break;
+    }
+    }
+}
+
+void ChangeList::Turn::Write(PayloadBuilder& aBuilder, TileId aTileId, const VisibleTiles& aVisibleTiles) const
+{
+    const Range* range = GetRange(aTileId);
+    if (range)
+    {
+        Encode();
+        const char* wire = mWire.data();
+        for (uint32 i = range->mBegin; i != range->mEnd; ++i)
+        {
+            const Fragment& fragment = mFragments[i];
+            if (IsVisible(aVisibleTiles, mChanges[i].mTile))
+            {
+                aBuilder.AddEncoded(wire + fragment.mVisible, fragment.mVisibleEnd - fragment.mVisible);
+            }
+            else
+            {
+                aBuilder.AddEncoded(wire + fragment.mHidden, fragment.mHiddenEnd - fragment.mHidden);
+            }
+        }
+    }
 }
@@ -2,28 +2,128 @@
 #define CHANGELIST_H
 #include <Typedefs.h>
 #include <INetwork.h>
-#include <boost/circular_buffer.hpp>
-#include <boost/ptr_container/ptr_vector.hpp>
-#include <IChange.h>
+#include <VisibleTiles.h>
 #include <gflags/gflags.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
 
 DECLARE_int32(max_change_list_size);
 
+class PayloadBuilder;
+
+// Changes of a tile by game turn. Changes of all tiles in a turn are plain
+// records in one journal, grouped by tile on commit and indexed by tile
+// id, so idle tiles hold no history at all. Journal of a committed turn is
+// never changed, it is reused when the turn leaves the history unless a
+// snapshot still holds it. Changes of a turn are encoded for the wire
+// once, by the first client which writes them, others only copy the bytes
 class ChangeList
 {
 public:
-    typedef boost::ptr_vector<IChange> TurnChanges;
-    ChangeList(): mChanges(FLAGS_max_change_list_size) { }
+    // Changes of all tiles in one committed turn
+    class Turn: public boost::noncopyable
+    {
+    public:
+        Turn(): mEncoded(false) { }
+        // Unit was created on or entered the tile, or left or was removed from it
+        struct UnitChange
+        {
+            TileId mTileId;
+            UnitId mUnitId;
+            bool mEntered;
+            uint32 mVisualCode;
+        };
+        void Write(PayloadBuilder& aBuilder, TileId aTileId, const VisibleTiles& aVisibleTiles) const;
+        // Appends changes by tile id, changes of a tile in order they happened
+        void GetUnitChanges(std::vector<UnitChange>& aChanges) const;
+    private:
+        friend class ChangeList;
+        enum Type
+        {
+            ENTER,
+            LEAVE,
+            REMOVE,
+            CREATE
+        };
+        struct Change
+        {
+            uint32 mType;
+            UnitId mUnitId;
+            // Enter source or leave destination
+            TileId mTile;
+            uint32 mVisualCode;
+        };
+        // Changes of the tile in the journal
+        struct Range
+        {
+            TileId mTileId;
+            uint32 mBegin;
+            uint32 mEnd;
+        };
+        // Change encoded as element of PayloadMsg changes, client sees it
+        // differently if it sees the other tile of the change. Both point
+        // to the same bytes when they do not differ
+        struct Fragment
+        {
+            uint32 mHidden;
+            uint32 mHiddenEnd;
+            uint32 mVisible;
+            uint32 mVisibleEnd;
+        };
+        static bool IsBefore(const Range& aLeft, const Range& aRight) { return aLeft.mTileId < aRight.mTileId; }
+        static void FillChangeMsg(ChangeMsg& aChange, TileId aTileId, const Change& aRecord, bool aOtherVisible);
+
+        void Add(TileId aTileId, const Change& aRecord);
+        // Encodes all changes on the first call, safe to call from any thread
+        void Encode() const;
+        const Range* GetRange(TileId aTileId) const;
+        void Clear();
+
+        std::vector<Change> mChanges;
+        mutable std::vector<Fragment> mFragments;
+        mutable std::string mWire;
+        mutable boost::atomic<bool> mEncoded;
+        mutable boost::mutex mEncodeMutex;
+        // Sorted by tile
+        std::vector<Range> mRanges;
+    };
+    typedef boost::shared_ptr<const Turn> TurnPtr;
+
+    ChangeList(): mPendingCount(0), mTileId(0) { }
+    ~ChangeList();
     void AddEnter(UnitId aUnit, uint32 aVisualCode, TileId aFrom);
     void AddLeave(UnitId aUnit, TileId aTo);
     void AddRemove(UnitId aUnit);
-    void Write(INetwork& aNetwork, size_t aIndex, VisibleTiles& aVisibleTiles) const;
-    void Commit();
+    void AddCreate(UnitId aUnit, uint32 aVisualCode);
     void SetTileId(TileId aTileId) { mTileId = aTileId; }
+
+    // Commits current changes of all lists as the next turn
+    static void CommitTurn();
+    // Turns committed so far, the last one is GetTurn() - 1
+    static uint32 GetTurn() { return mTurn; }
+    // Throws if turn is not committed yet or is already forgotten. Turn
+    // stays valid while it is held, even after it leaves the history
+    static TurnPtr GetTurnChanges(uint32 aTurn);
 private:
-    boost::circular_buffer<TurnChanges> mChanges;
-    TurnChanges mCurrentChanges;
+    struct Pending
+    {
+        ChangeList* mList;
+        Turn::Change mChange;
+    };
+    static bool IsBefore(const Pending& aLeft, const Pending& aRight) { return aLeft.mList->mTileId < aRight.mList->mTileId; }
+
+    void Add(Turn::Type aType, UnitId aUnit, TileId aTile, uint32 aVisualCode);
+
+    uint32 mPendingCount;
     TileId mTileId;
+
+    // Changes of the current turn in order they happened
+    static std::vector<Pending> mPending;
+    // Journal of turn t is mJournal[t % size]
+    static std::vector< boost::shared_ptr<Turn> > mJournal;
+    static uint32 mTurn;
 };
 
 #endif // CHANGELIST_H
@@ -390,6 +390,13 @@ void ClientApp::OnAppHanshake(ServerProxyPtr aServerProxy, ConstPayloadPtr aRes)
         LOG(INFO) << "App handshake done. World size: " << aRes->size();
 
         mGame = new ClientGame(aServerProxy, aRes->avatar(), aRes->size());
+
+        if (aRes->has_grid_checksum() && aRes->grid_checksum() != mGame->GetGrid().GetChecksum())
+        {
+            delete mGame;
+            mGame = 0;
+            throw std::runtime_error("Map does not match server map");
+        }
     }
     catch (std::exception& e)
     {
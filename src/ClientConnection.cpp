@@ -4,90 +4,438 @@
 #include <ServerGame.h>
 #include <ServerUnit.h>
 #include <ServerTile.h>
-#include <Network.h>
 #include <ChangeList.h>
-#include <boost/thread.hpp>
 #include <ProtocolVersion.h>
 #include <UnitList.h>
+#include <MindList.h>
 #include <ClientFOV.h>
 #include <UserList.h>
+#include <Header.pb.h>
+#include <HighResolutionClock.h>
 
 DEFINE_int32(vision_range, 6, "Radius (in tiles) around player to send over network");
+DEFINE_int32(push_window, 4, "Updates pushed to subscribed client ahead of its acknowledgements");
+DEFINE_int32(max_request_size, 65536, "Largest client request (in bytes) accepted, bigger ones close the session");
 
-void ClientConnection(ServerGame& aGame, SSLStreamPtr aSSLStream)
+std::vector< boost::weak_ptr<ClientConnection> > ClientConnection::mSubscribers;
+boost::mutex ClientConnection::mSubscribersMutex;
+ClientConnection::SendStats ClientConnection::mStats = { 0, 0, 0 };
+boost::mutex ClientConnection::mStatsMutex;
+
+ClientConnection::ClientConnection(ServerGame& aGame, boost::asio::io_service& aIOService, boost::asio::ssl::context& aContext):
+    mGame(aGame), mStrand(aIOService), mSSLStream(aIOService, aContext), mUser(NULL),
+    mCountedBytes(0), mClosing(false), mWriting(false), mReadAfterWrite(false),
+    mSubscribed(false), mPushPending(false), mSentTime(0), mAckedTime(0)
 {
-    Network network(aSSLStream);
-    try
+    HeaderMsg header;
+    header.set_size(0);
+    mHeader.resize(header.ByteSize());
+}
+
+ClientConnection::~ClientConnection()
+{
+    mOutput.clear();
+    mQueue.clear();
+    CountQueued();
+    LOG(INFO) << "ClientConnection closed";
+}
+
+ClientConnection::SendStats ClientConnection::GetSendStats()
+{
+    boost::lock_guard<boost::mutex> lock(mStatsMutex);
+    return mStats;
+}
+
+void ClientConnection::CountQueued()
+{
+    const size_t bytes = mOutput.size() + mQueue.size();
+    boost::lock_guard<boost::mutex> lock(mStatsMutex);
+    mStats.mQueuedBytes += bytes;
+    mStats.mQueuedBytes -= mCountedBytes;
+    mCountedBytes = bytes;
+}
+
+void ClientConnection::Start()
+{
+    LOG(INFO) << "SSL handshake";
+    mSSLStream.async_handshake(boost::asio::ssl::stream_base::server,
+        mStrand.wrap(boost::bind(&ClientConnection::HandleHandshake, shared_from_this(), boost::asio::placeholders::error)));
+}
+
+void ClientConnection::HandleHandshake(const boost::system::error_code& aError)
+{
+    if (aError)
     {
-        LOG(INFO) << "SSL handshake";
-        aSSLStream->handshake(boost::asio::ssl::stream_base::server);
+        LOG(INFO) << "SSL handshake failed: " << aError.message();
+        return;
+    }
+    ReadHeader();
+}
 
-        PayloadMsg req;
-        network.ReadMessage(req);
-        LOG(INFO) << "App handshake " << req.ShortDebugString();
+void ClientConnection::ReadHeader()
+{
+    boost::asio::async_read(mSSLStream, boost::asio::buffer(mHeader),
+        mStrand.wrap(boost::bind(&ClientConnection::HandleHeader, shared_from_this(), boost::asio::placeholders::error)));
+}
 
-        PayloadMsg res;
-        res.set_protocolversion(PROTOCOL_VERSION);
+void ClientConnection::HandleHeader(const boost::system::error_code& aError)
+{
+    if (aError)
+    {
+        LOG(INFO) << "ClientConnection read: " << aError.message();
+        Close();
+        return;
+    }
+    if (mClosing)
+    {
+        // Subscribed session keeps reading while it is pushed to
+        return;
+    }
+    HeaderMsg header;
+    if (!header.ParseFromArray(&mHeader[0], mHeader.size()))
+    {
+        LOG(INFO) << "ClientConnection: broken header";
+        Close();
+        return;
+    }
+    if (header.size() > static_cast<uint32>(std::max(FLAGS_max_request_size, 0)))
+    {
+        LOG(INFO) << "ClientConnection: request of " << header.size() << " bytes is too big";
+        Close();
+        return;
+    }
+    mInput.resize(header.size());
+    boost::asio::async_read(mSSLStream, boost::asio::buffer(mInput),
+        mStrand.wrap(boost::bind(&ClientConnection::HandleBody, shared_from_this(), boost::asio::placeholders::error)));
+}
 
-        if (req.protocolversion() != PROTOCOL_VERSION)
+void ClientConnection::HandleBody(const boost::system::error_code& aError)
+{
+    if (aError)
+    {
+        LOG(INFO) << "ClientConnection read: " << aError.message();
+        Close();
+        return;
+    }
+    if (mClosing)
+    {
+        return;
+    }
+    try
+    {
+        PayloadMsg req;
+        if (!req.ParseFromArray(mInput.empty() ? NULL : &mInput[0], mInput.size()))
+        {
+            boost::throw_exception(std::runtime_error("Broken message"));
+        }
+        if (mSubscribed)
         {
-            res.set_reason("Wrong protocol version");
-            network.WriteMessage(res);
+            // Nothing is answered, the next read is started right away
+            Acknowledge(req);
+            ReadHeader();
+            if (mPushPending)
+            {
+                Push();
+            }
             return;
         }
+        if (!mUser)
+        {
+            mClosing = !Login(req);
+        }
+        else
+        {
+            Update(req);
+        }
+    }
+    catch (...)
+    {
+        // Network threads serve other sessions, error ends only this one
+        LOG(INFO) << "ClientConnection exception: " << boost::current_exception_diagnostic_information();
+        Close();
+        return;
+    }
+    Send(true);
+}
+
+void ClientConnection::Send(bool aReadAfter)
+{
+    mWriting = true;
+    mReadAfterWrite = aReadAfter;
+    mOutput.swap(mQueue);
+    mQueue.clear();
+    CountQueued();
+    boost::asio::async_write(mSSLStream, boost::asio::buffer(mOutput),
+        mStrand.wrap(boost::bind(&ClientConnection::HandleWrite, shared_from_this(), boost::asio::placeholders::error)));
+}
+
+void ClientConnection::HandleWrite(const boost::system::error_code& aError)
+{
+    mWriting = false;
+    mOutput.clear();
+    CountQueued();
+    if (aError)
+    {
+        LOG(INFO) << "ClientConnection write: " << aError.message();
+        Close();
+        return;
+    }
+    if (!mClosing)
+    {
+        if (mReadAfterWrite)
+        {
+            ReadHeader();
+        }
+        if (!mQueue.empty())
+        {
+            Send(false);
+        }
+        else
+        {
+            mPolicy.Drained();
+            if (mPushPending)
+            {
+                Push();
+            }
+        }
+    }
+}
+
+void ClientConnection::Close()
+{
+    mClosing = true;
+    // Pending operations complete with error and release the session
+    boost::system::error_code error;
+    GetSocket().close(error);
+}
+
+bool ClientConnection::Login(const PayloadMsg& aRequest)
+{
+    LOG(INFO) << "App handshake " << aRequest.ShortDebugString();
+
+    PayloadMsg res;
+    res.set_protocolversion(PROTOCOL_VERSION);
+
+    if (aRequest.protocolversion() != PROTOCOL_VERSION)
+    {
+        res.set_reason("Wrong protocol version");
+        WriteMessage(res);
+        return false;
+    }
+
+    const char* userName = SSL_get_srp_username(mSSLStream.native_handle());
+
+    LOG(INFO) << "ClientConnection " << userName;
 
-        const char* userName = SSL_get_srp_username(aSSLStream->native_handle());
+    const User* user = GetUser(userName);
+    if (!user)
+    {
+        res.set_reason("Unknown user!");
+        WriteMessage(res);
+        return false;
+    }
+
+    res.set_avatar(user->GetUnitId());
+    res.set_size(mGame.GetSize());
+    res.set_grid_checksum(mGame.GetGrid().GetChecksum());
+    WriteMessage(res);
+    LOG(INFO) << "Response " << res.ShortDebugString();
 
-        LOG(INFO) << "ClientConnection " << userName;
+    mUser = user;
+    mFOV.reset(new ClientFOV(*this, mGame.GetTiles(), mGame.GetRings(), user->GetUnitId()));
+    return true;
+}
 
-        const User* user = GetUser(userName);
-        if (!user)
+void ClientConnection::Update(const PayloadMsg& aRequest)
+{
+    if (aRequest.has_commandmove())
+    {
+        Command(aRequest.commandmove());
+    }
+    if (aRequest.has_time())
+    {
+        const WorldSnapshotPtr snapshot = mGame.GetSnapshot();
+        WriteUpdate(*snapshot, aRequest.time());
+        if (aRequest.subscribe())
         {
-            res.set_reason("Unknown user!");
-            network.WriteMessage(res);
-            return;
+            // Client has what it was just sent, pushes go from there
+            mSentTime = snapshot->GetTime();
+            mAckedTime = mSentTime;
+            mSubscribed = true;
+            boost::lock_guard<boost::mutex> lock(mSubscribersMutex);
+            mSubscribers.push_back(shared_from_this());
         }
+    }
+    else
+    {
+        PayloadMsg res;
+        WriteMessage(res);
+    }
+}
+
+void ClientConnection::WriteUpdate(const WorldSnapshot& aSnapshot, GameTime aClientTime)
+{
+    const GameTime time = aSnapshot.GetTime();
+    // Client ahead of the snapshot has no turns in common with it
+    const bool outOfBounds = aClientTime <= 0 || aClientTime > time ||
+        (time - aClientTime) / FLAGS_time_step >= static_cast<GameTime>(std::max(FLAGS_max_change_list_size, 0));
+    if (outOfBounds)
+    {
+        mFOV->WriteFullUpdate(aSnapshot, FLAGS_vision_range);
+    }
+    else
+    {
+        const int32 toSend = static_cast<int32>((time - aClientTime) / FLAGS_time_step);
+        mFOV->WritePartialUpdate(aSnapshot, toSend, FLAGS_vision_range);
+    }
+    mFOV->WriteFinalMessage(aSnapshot.GetTime(), mGame.GetUpdateLength());
+}
 
-        res.set_avatar(user->GetUnitId());
-        res.set_size(aGame.GetSize());
-        network.WriteMessage(res);
-        LOG(INFO) << "Response " << res.ShortDebugString();
+void ClientConnection::Acknowledge(const PayloadMsg& aRequest)
+{
+    if (aRequest.has_commandmove())
+    {
+        Command(aRequest.commandmove());
+    }
+    if (aRequest.has_time())
+    {
+        mAckedTime = std::max<GameTime>(mAckedTime, aRequest.time());
+    }
+}
 
-        ClientFOV fov(network, aGame.GetTiles(), user->GetUnitId());
+void ClientConnection::Command(const CommandMoveMsg& aCommand)
+{
+    const ServerGeodesicGrid::Tiles& tiles = mGame.GetTiles();
+    TileId target = aCommand.position();
+    if (target >= tiles.size())
+    {
+        LOG(INFO) << "ClientConnection: command to no tile " << target;
+        return;
+    }
+    if (aCommand.has_target_x() && aCommand.has_target_y() && aCommand.has_target_z())
+    {
+        // Tile of the client is where the search starts, it is one step away at most
+        const Ogre::Vector3 point(aCommand.target_x(), aCommand.target_y(), aCommand.target_z());
+        target = mGame.GetGrid().GetIndex().GetTile(point, target);
+    }
+    // Game thread gives the command before the next update, so network
+    // thread does not wait for the game lock
+    MindList::PostCommand(mUser->GetUnitId(), *tiles[target]);
+}
 
-        while (true)
+void ClientConnection::Push()
+{
+    mPushPending = true;
+    if (mClosing)
+    {
+        return;
+    }
+    if (mPolicy.ShouldDisconnect(GetMiliseconds()))
+    {
+        LOG(INFO) << "ClientConnection: slow client disconnected";
         {
-            PayloadMsg req;
-            network.ReadMessage(req);
-            if (req.has_commandmove())
-            {
-                const CommandMoveMsg& move = req.commandmove();
-                user->GetMind()->SetCommand(*aGame.GetTiles().at(move.position()));
-            }
-            if (req.has_time())
-            {
-                boost::shared_lock<boost::shared_mutex> rl(aGame.GetGameMutex());
-                const int32 toSend = (aGame.GetTime() - req.time()) / FLAGS_time_step;
-                const bool outOfBounds = req.time() <= 0 || toSend >= FLAGS_max_change_list_size;
-                if (outOfBounds)
-                {
-                    fov.WriteFullUpdate(FLAGS_vision_range);
-                }
-                else
-                {
-                    fov.WritePartialUpdate(toSend, FLAGS_vision_range);
-                }
-                fov.WriteFinalMessage(aGame.GetTime(), aGame.GetUpdateLength());
-            }
-            else
-            {
-                PayloadMsg res;
-                network.WriteMessage(res);
-            }
+            boost::lock_guard<boost::mutex> lock(mStatsMutex);
+            ++mStats.mDisconnects;
         }
+        Close();
+        return;
+    }
+    if ((mSentTime - mAckedTime) / FLAGS_time_step >= static_cast<GameTime>(std::max(FLAGS_push_window, 1)))
+    {
+        // Client is behind, the next update after acknowledgement covers all turns it missed
+        return;
+    }
+    if (mPolicy.ShouldDrop(mOutput.size() + mQueue.size(), mWriting))
+    {
+        // Pushed when the queue drains
+        Drop();
+        return;
+    }
+    mPushPending = false;
+    const size_t queued = mQueue.size();
+    try
+    {
+        const WorldSnapshotPtr snapshot = mGame.GetSnapshot();
+        if (snapshot->GetTime() == mSentTime)
+        {
+            return;
+        }
+        // Full update replaces updates client missed
+        WriteUpdate(*snapshot, mPolicy.IsResync() ? 0 : mSentTime);
+        if (mPolicy.IsOverBudget(mOutput.size() + mQueue.size(), mWriting))
+        {
+            // Field of view goes back to what client was sent
+            mQueue.resize(queued);
+            mFOV->Rollback();
+            Drop();
+            return;
+        }
+        mPolicy.Sent();
+        mSentTime = snapshot->GetTime();
     }
     catch (...)
     {
+        // Subscribed read would go on if the socket was left open
         LOG(INFO) << "ClientConnection exception: " << boost::current_exception_diagnostic_information();
+        Close();
+        return;
+    }
+    if (mWriting)
+    {
+        CountQueued();
+    }
+    else
+    {
+        Send(false);
+    }
+}
+
+void ClientConnection::Drop()
+{
+    mPolicy.Dropped(GetMiliseconds());
+    mPushPending = true;
+    boost::lock_guard<boost::mutex> lock(mStatsMutex);
+    ++mStats.mDrops;
+}
+
+void ClientConnection::PushUpdates()
+{
+    boost::lock_guard<boost::mutex> lock(mSubscribersMutex);
+    size_t kept = 0;
+    for (size_t i = 0; i < mSubscribers.size(); ++i)
+    {
+        if (ClientConnectionPtr connection = mSubscribers[i].lock())
+        {
+            connection->mStrand.post(boost::bind(&ClientConnection::Push, connection));
+            mSubscribers[kept++] = mSubscribers[i];
+        }
     }
+    mSubscribers.resize(kept);
+}
+
+void ClientConnection::AppendFrame(const char* aMessage, size_t aSize)
+{
+    HeaderMsg header;
+    header.set_size(aSize);
+    header.AppendToString(&mQueue);
+    mQueue.append(aMessage, aSize);
+}
+
+void ClientConnection::WriteMessage(const PayloadMsg& aMessage)
+{
+    const std::string& message = aMessage.SerializeAsString();
+    AppendFrame(message.data(), message.size());
+}
+
+void ClientConnection::WriteEncoded(const std::string* aMessages, size_t aCount)
+{
+    for (size_t i = 0; i < aCount; ++i)
+    {
+        AppendFrame(aMessages[i].data(), aMessages[i].size());
+    }
+}
+
+void ClientConnection::ReadMessage(PayloadMsg& aMessage)
+{
+    boost::throw_exception(std::logic_error("ClientConnection reads only asynchronously"));
 }
@@ -2,10 +2,107 @@
 #define CLIENTCONNECTION_H
 
 #include <Typedefs.h>
+#include <INetwork.h>
+#include <SendPolicy.h>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <gflags/gflags.h>
 
 class ServerGame;
-class ServerUnit;
+class ClientFOV;
+class WorldSnapshot;
+class User;
 
-void ClientConnection(ServerGame& aGame, SSLStreamPtr aSocket);
+DECLARE_int32(vision_range);
+DECLARE_int32(push_window);
+DECLARE_int32(max_request_size);
+
+// Session of one client driven by completion handlers on network threads.
+// Session reads a request, answers it and only then reads the next one.
+// Subscribed session reads acknowledgements and commands all the time and
+// is pushed an update after each game update, so its handlers go through
+// a strand. Idle session is only a pending read. Updates pushed while a
+// write is in flight are queued, SendPolicy drops them for slow clients
+class ClientConnection: public INetwork, public boost::enable_shared_from_this<ClientConnection>, public boost::noncopyable
+{
+public:
+    ClientConnection(ServerGame& aGame, boost::asio::io_service& aIOService, boost::asio::ssl::context& aContext);
+    ~ClientConnection();
+    struct SendStats
+    {
+        // Bytes being written or queued in all sessions
+        size_t mQueuedBytes;
+        uint32 mDrops;
+        uint32 mDisconnects;
+    };
+    static SendStats GetSendStats();
+
+    SSLStream::lowest_layer_type& GetSocket() { return mSSLStream.lowest_layer(); }
+    void Start();
+    // Called after game update, subscribed sessions send it to clients
+    static void PushUpdates();
+
+    // Messages are gathered while request is handled and sent after it
+    virtual void WriteMessage(const PayloadMsg& aMessage);
+    virtual void WriteEncoded(const std::string* aMessages, size_t aCount);
+    // Session only reads asynchronously
+    virtual void ReadMessage(PayloadMsg& aMessage);
+private:
+    void HandleHandshake(const boost::system::error_code& aError);
+    void ReadHeader();
+    void HandleHeader(const boost::system::error_code& aError);
+    void HandleBody(const boost::system::error_code& aError);
+    void HandleWrite(const boost::system::error_code& aError);
+    // Starts writing the queue, no write should be in flight
+    void Send(bool aReadAfter);
+    void Close();
+    // False if session should be closed after the response
+    bool Login(const PayloadMsg& aRequest);
+    void Update(const PayloadMsg& aRequest);
+    void Acknowledge(const PayloadMsg& aRequest);
+    // Commands to no tile are ignored, others are given on the next update
+    void Command(const CommandMoveMsg& aCommand);
+    // Game lock is not held, snapshot is not changed while update is written
+    void WriteUpdate(const WorldSnapshot& aSnapshot, GameTime aClientTime);
+    void Push();
+    // Drops pushed update of congested client
+    void Drop();
+    void AppendFrame(const char* aMessage, size_t aSize);
+    // Updates queued bytes in stats
+    void CountQueued();
+
+    ServerGame& mGame;
+    boost::asio::io_service::strand mStrand;
+    SSLStream mSSLStream;
+    const User* mUser;
+    boost::scoped_ptr<ClientFOV> mFOV;
+    std::vector<char> mHeader;
+    std::vector<char> mInput;
+    // Frames being written, header and message each
+    std::string mOutput;
+    // Frames to write after the current write
+    std::string mQueue;
+    size_t mCountedBytes;
+    bool mClosing;
+    bool mWriting;
+    bool mReadAfterWrite;
+
+    bool mSubscribed;
+    bool mPushPending;
+    // Game time of the last update sent and acknowledged by client
+    GameTime mSentTime;
+    GameTime mAckedTime;
+    SendPolicy mPolicy;
+
+    static std::vector< boost::weak_ptr<ClientConnection> > mSubscribers;
+    static boost::mutex mSubscribersMutex;
+    static SendStats mStats;
+    static boost::mutex mStatsMutex;
+};
+
+typedef boost::shared_ptr<ClientConnection> ClientConnectionPtr;
 
 #endif // CLIENTCONNECTION_H
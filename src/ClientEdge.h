@@ -1,9 +0,0 @@
-#ifndef CLIENTEDGE_H
-#define CLIENTEDGE_H
-
-#include <Edge.h>
-#include <ClientTile.h>
-
-typedef Edge<ClientTile> ClientEdge;
-
-#endif // EDGE_H
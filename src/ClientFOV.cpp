@@ -2,10 +2,12 @@
 
 #include <ClientFOV.h>
 #include <ServerTile.h>
-#include <UnitList.h>
 
-ClientFOV::ClientFOV(INetwork& aNetwork, const ServerGeodesicGrid::Tiles& aTiles, UnitId aAvatarId):
-    mAvatarId(aAvatarId), mNetwork(aNetwork), mTiles(aTiles)
+ClientFOV::ClientFOV(INetwork& aNetwork, const ServerGeodesicGrid::Tiles& aTiles, KRingCache& aRings, UnitId aAvatarId):
+    mAvatarId(aAvatarId), mNetwork(aNetwork), mTiles(aTiles), mRings(aRings),
+    mRing(new KRing()), mCentre(0), mDepth(-1),
+    mPreviousRing(mRing), mPreviousCentre(0), mPreviousDepth(-1), mVisibleTiles(aTiles.size()),
+    mBuilder(aNetwork, FLAGS_max_payload_size)
 {
 }
 
@@ -14,7 +16,7 @@ ClientFOV::~ClientFOV()
     //dtor
 }
 
-void AddShowTile(PayloadMsg& aResponse, TileId aTileId, const ServerGeodesicGrid::Tiles& aTiles)
+void AddShowTile(PayloadMsg& aResponse, TileId aTileId, const ServerGeodesicGrid::Tiles& aTiles, const WorldSnapshot& aSnapshot)
 {
     ChangeMsg* change = aResponse.add_changes();
     ShowTileMsg* showTile = change->mutable_showtile();
@@ -23,14 +25,14 @@ void AddShowTile(PayloadMsg& aResponse, TileId aTileId, const ServerGeodesicGrid
     showTile->set_height(tile.GetHeight());
     showTile->set_whater(tile.GetWater());
 
-    for (ServerTile::UnitIterator i = tile.GetUnits(); !tile.IsLastUnit(i); ++i)
+    const WorldSnapshot::UnitIterator end = aSnapshot.GetUnitsEnd(aTileId);
+    for (WorldSnapshot::UnitIterator i = aSnapshot.GetUnitsBegin(aTileId); i != end; ++i)
     {
-        const ServerUnit* unit = UnitList::GetUnit(*i);
         ChangeMsg* change = aResponse.add_changes();
         UnitEnterMsg* unitEnter = change->mutable_unitenter();
-        unitEnter->set_unitid(*i);
+        unitEnter->set_unitid(i->mUnitId);
         unitEnter->set_to(aTileId);
-        unitEnter->set_visualcode(unit->GetClass().GetVisualCode());
+        unitEnter->set_visualcode(i->mVisualCode);
     }
 }
 
@@ -41,96 +43,175 @@ void AddHideTile(PayloadMsg& aResponse, TileId aTileId)
     hideTile->set_tileid(aTileId);
 }
 
-std::set<TileId> ClientFOV::GetVisibleTiles(int aDepth)
+KRingPtr ClientFOV::GetRing(TileId aCentre, int aDepth)
 {
-    std::set<TileId> result;
-    std::set<TileId> toIterate;
-    ServerTile& tile = UnitList::GetUnit(mAvatarId)->GetUnitTile();
-    toIterate.insert(tile.GetTileId());
-    result.insert(tile.GetTileId());
+    if (aCentre == mCentre && aDepth == mDepth)
+    {
+        return mRing;
+    }
+    return mRings.GetRing(aCentre, aDepth);
+}
 
-    for (int d = 0; d < aDepth; ++d)
+bool ClientFOV::IsNeighbour(TileId aTile, TileId aNeighbour) const
+{
+    const ServerTile& tile = *mTiles.at(aTile);
+    for (size_t n = 0; n < tile.GetNeighbourCount(); ++n)
     {
-        std::set<TileId> newTiles;
-        for (std::set<TileId>::iterator i = toIterate.begin(); i != toIterate.end(); ++i)
+        if (tile.GetNeighbourId(n) == aNeighbour)
         {
-            ServerTile* tile = mTiles.at(*i);
-            for (size_t n = 0; n < tile->GetNeighbourCount(); ++n)
+            return true;
+        }
+    }
+    return false;
+}
+
+void ClientFOV::UpdateVisibleTiles(const KRing& aRing, TileId aCentre, int aDepth)
+{
+    mNewVisibleTiles.clear();
+    mNewHiddenTiles.clear();
+
+    if (aDepth == mDepth && IsNeighbour(mCentre, aCentre))
+    {
+        // After one step tiles can appear only on the new perimeter and disappear only from the old one
+        for (TileRing::const_iterator n = aRing.mPerimeter.begin(); n != aRing.mPerimeter.end(); ++n)
+        {
+            if (!mVisibleTiles.test(*n))
             {
-                const TileId tileId = tile->GetNeighbour(n).GetTileId();
-                if (result.find(tileId) == result.end())
-                {
-                    newTiles.insert(tileId);
-                }
+                mNewVisibleTiles.push_back(*n);
+            }
+        }
+        for (TileRing::const_iterator n = mRing->mPerimeter.begin(); n != mRing->mPerimeter.end(); ++n)
+        {
+            if (!std::binary_search(aRing.mTiles.begin(), aRing.mTiles.end(), *n))
+            {
+                mNewHiddenTiles.push_back(*n);
             }
         }
-        toIterate = newTiles;
-        result.insert(newTiles.begin(), newTiles.end());
+    }
+    else
+    {
+        std::set_difference(
+            aRing.mTiles.begin(), aRing.mTiles.end(),
+            mRing->mTiles.begin(), mRing->mTiles.end(), std::back_inserter(mNewVisibleTiles));
+        std::set_difference(
+            mRing->mTiles.begin(), mRing->mTiles.end(),
+            aRing.mTiles.begin(), aRing.mTiles.end(), std::back_inserter(mNewHiddenTiles));
     }
 
-    return result;
+    std::vector<TileId>::const_iterator n;
+    for (n = mNewVisibleTiles.begin(); n != mNewVisibleTiles.end(); ++n)
+    {
+        mVisibleTiles.set(*n);
+    }
+    for (n = mNewHiddenTiles.begin(); n != mNewHiddenTiles.end(); ++n)
+    {
+        mVisibleTiles.reset(*n);
+    }
 }
 
-void ClientFOV::WritePartialUpdate(const int32 toSend, const int32 aVisionRadius)
+void ClientFOV::WritePartialUpdate(const WorldSnapshot& aSnapshot, const int32 toSend, const int32 aVisionRadius)
 {
-    std::set<TileId> currentVisibleTiles = GetVisibleTiles(aVisionRadius);
+    const TileId centre = aSnapshot.GetUnitTile(mAvatarId);
+    const KRingPtr ring = GetRing(centre, aVisionRadius);
 
-    std::vector<TileId> newVisibleTiles(currentVisibleTiles.size());
-    std::vector<TileId>::iterator newVisibleEnd = std::set_difference(
-                currentVisibleTiles.begin(), currentVisibleTiles.end(),
-                mVisibleTiles.begin(), mVisibleTiles.end(), newVisibleTiles.begin());
-
-    std::vector<TileId> newHiddenTiles(mVisibleTiles.size());
-    std::vector<TileId>::iterator newHiddenEnd = std::set_difference(
-                mVisibleTiles.begin(), mVisibleTiles.end(),
-                currentVisibleTiles.begin(), currentVisibleTiles.end(), newHiddenTiles.begin());
-
-    if (newVisibleTiles.begin() != newVisibleEnd || newHiddenTiles.begin() != newHiddenEnd)
+    if (ring != mRing)
     {
-        PayloadMsg response;
-        response.set_last(false);
+        UpdateVisibleTiles(*ring, centre, aVisionRadius);
 
-        std::vector<TileId>::iterator n;
-        for (n = newVisibleTiles.begin(); n != newVisibleEnd; ++n)
+        if (!mNewVisibleTiles.empty() || !mNewHiddenTiles.empty())
         {
-            AddShowTile(response, *n, mTiles);
-        }
+            PayloadMsg response;
 
-        for (n = newHiddenTiles.begin(); n != newHiddenEnd; ++n)
-        {
-            AddHideTile(response, *n);
-        }
+            std::vector<TileId>::const_iterator n;
+            for (n = mNewVisibleTiles.begin(); n != mNewVisibleTiles.end(); ++n)
+            {
+                AddShowTile(response, *n, mTiles, aSnapshot);
+            }
+
+            for (n = mNewHiddenTiles.begin(); n != mNewHiddenTiles.end(); ++n)
+            {
+                AddHideTile(response, *n);
+            }
 
-        mNetwork.WriteMessage(response);
+            AddChanges(response);
+        }
     }
 
     // send events
+    const uint32 turn = aSnapshot.GetTurn();
     for (int32 t = toSend - 1; t >= 0; --t)
     {
-        for (std::set<TileId>::iterator n = currentVisibleTiles.begin(); n != currentVisibleTiles.end(); ++n)
+        const ChangeList::Turn& changes = aSnapshot.GetChanges(turn - 1 - t);
+        for (TileRing::const_iterator n = ring->mTiles.begin(); n != ring->mTiles.end(); ++n)
         {
-            const TileId id = *n;
-            ServerTile* tile = mTiles.at(id);
-            tile->GetChangeList()->Write(mNetwork, t, currentVisibleTiles);
+            changes.Write(mBuilder, *n, mVisibleTiles);
         }
     }
+    mBuilder.Flush();
 
-    mVisibleTiles = currentVisibleTiles;
+    SetRing(ring, centre, aVisionRadius);
 }
 
-void ClientFOV::WriteFullUpdate(const int32 aVisionRadius)
+void ClientFOV::WriteFullUpdate(const WorldSnapshot& aSnapshot, const int32 aVisionRadius)
 {
-    std::set<TileId> currentVisibleTiles = GetVisibleTiles(aVisionRadius);
+    const TileId centre = aSnapshot.GetUnitTile(mAvatarId);
+    const KRingPtr ring = GetRing(centre, aVisionRadius);
 
+    // Client may have missed changes of any tile it was sent
     PayloadMsg msg;
-    msg.set_last(false);
-    for (std::set<TileId>::iterator n = currentVisibleTiles.begin(); n != currentVisibleTiles.end(); ++n)
+    mNewHiddenTiles.clear();
+    std::set_difference(
+        mRing->mTiles.begin(), mRing->mTiles.end(),
+        ring->mTiles.begin(), ring->mTiles.end(), std::back_inserter(mNewHiddenTiles));
+    std::vector<TileId>::const_iterator n;
+    for (n = mNewHiddenTiles.begin(); n != mNewHiddenTiles.end(); ++n)
+    {
+        AddHideTile(msg, *n);
+        mVisibleTiles.reset(*n);
+    }
+    for (n = ring->mTiles.begin(); n != ring->mTiles.end(); ++n)
     {
-        AddShowTile(msg, *n, mTiles);
+        AddShowTile(msg, *n, mTiles, aSnapshot);
+        mVisibleTiles.set(*n);
     }
-    mNetwork.WriteMessage(msg);
+    AddChanges(msg);
+    mBuilder.Flush();
 
-    mVisibleTiles = currentVisibleTiles;
+    SetRing(ring, centre, aVisionRadius);
+}
+
+void ClientFOV::SetRing(const KRingPtr& aRing, TileId aCentre, int aDepth)
+{
+    mPreviousRing = mRing;
+    mPreviousCentre = mCentre;
+    mPreviousDepth = mDepth;
+    mRing = aRing;
+    mCentre = aCentre;
+    mDepth = aDepth;
+}
+
+void ClientFOV::Rollback()
+{
+    TileRing::const_iterator n;
+    for (n = mRing->mTiles.begin(); n != mRing->mTiles.end(); ++n)
+    {
+        mVisibleTiles.reset(*n);
+    }
+    for (n = mPreviousRing->mTiles.begin(); n != mPreviousRing->mTiles.end(); ++n)
+    {
+        mVisibleTiles.set(*n);
+    }
+    mRing = mPreviousRing;
+    mCentre = mPreviousCentre;
+    mDepth = mPreviousDepth;
+}
+
+void ClientFOV::AddChanges(const PayloadMsg& aMessage)
+{
+    for (int i = 0; i < aMessage.changes_size(); ++i)
+    {
+        mBuilder.Add(aMessage.changes(i));
+    }
 }
 
 void ClientFOV::WriteFinalMessage(const GameTime aServerTime, const Miliseconds aGameUpdateLength)
@@ -4,29 +4,54 @@
 #include<INetwork.h>
 #include<ServerGame.h>
 #include<Typedefs.h>
-#include<IChange.h>
+#include<VisibleTiles.h>
+#include<KRingCache.h>
+#include<PayloadBuilder.h>
+#include<WorldSnapshot.h>
 #include<boost/noncopyable.hpp>
 
 
-void AddShowTile(PayloadMsg& aResponse, TileId aTileId, const ServerGeodesicGrid::Tiles& aTiles);
+void AddShowTile(PayloadMsg& aResponse, TileId aTileId, const ServerGeodesicGrid::Tiles& aTiles, const WorldSnapshot& aSnapshot);
 
 void AddHideTile(PayloadMsg& aResponse, TileId aTileId);
 
+// Field of view of one client. Updates are written from a world snapshot,
+// so they need no game lock
 class ClientFOV: public boost::noncopyable
 {
 public:
-    ClientFOV(INetwork& aNetwork, const ServerGeodesicGrid::Tiles& aTiles, UnitId aAvatarId);
+    ClientFOV(INetwork& aNetwork, const ServerGeodesicGrid::Tiles& aTiles, KRingCache& aRings, UnitId aAvatarId);
     ~ClientFOV();
-    void WritePartialUpdate(const int32 toSend, const int32 aVisionRadius);
-    void WriteFullUpdate(const int32 aVisionRadius);
+    void WritePartialUpdate(const WorldSnapshot& aSnapshot, const int32 toSend, const int32 aVisionRadius);
+    // Hides tiles client was sent before and shows all it sees now, shown
+    // tile replaces units client has on it
+    void WriteFullUpdate(const WorldSnapshot& aSnapshot, const int32 aVisionRadius);
+    // Last update was not sent, client still sees tiles of the one before
+    void Rollback();
     void WriteFinalMessage(const GameTime aServerTime, const Miliseconds aGameUpdateLength);
 private:
-    std::set<TileId> GetVisibleTiles(int aDepth);
+    KRingPtr GetRing(TileId aCentre, int aDepth);
+    void UpdateVisibleTiles(const KRing& aRing, TileId aCentre, int aDepth);
+    void SetRing(const KRingPtr& aRing, TileId aCentre, int aDepth);
+    bool IsNeighbour(TileId aTile, TileId aNeighbour) const;
+    void AddChanges(const PayloadMsg& aMessage);
     const UnitId mAvatarId;
     INetwork& mNetwork;
     const ServerGeodesicGrid::Tiles& mTiles;
-    std::set<TileId> mVisibleTiles;
-
+    KRingCache& mRings;
+    KRingPtr mRing;
+    TileId mCentre;
+    int mDepth;
+    // Field of view before the last update, restored by Rollback
+    KRingPtr mPreviousRing;
+    TileId mPreviousCentre;
+    int mPreviousDepth;
+    // Tiles of mRing
+    VisibleTiles mVisibleTiles;
+    // Kept between updates to not allocate them each time
+    std::vector<TileId> mNewVisibleTiles;
+    std::vector<TileId> mNewHiddenTiles;
+    PayloadBuilder mBuilder;
 };
 
 #endif // CLIENTFOV_H
@@ -11,20 +11,22 @@
 #include <CEGUILocalization.h>
 #include <GUI.h>
 
+DEFINE_bool(subscribe, false, "Receive updates pushed by server instead of asking for them");
+
 ClientGame::ClientUnits ClientGame::mUnits;
 
 ClientGame::ClientGame(ServerProxyPtr aServerProxy, UnitId aAvatar, int32 aGridSize):
     mTileUnderCursor(NULL),
+    mCursorPosition(Ogre::Vector3::ZERO),
     mTime(0),
     mSyncTimer(1000),
     mServerUpdateLength(1000),
     mServerProxy(aServerProxy),
     mLifeTime(0),
     mAvatar(aAvatar),
+    mGrid(mTiles, aGridSize),
     mFreeCamera(false)
 {
-    ClientGeodesicGrid grid(mTiles, aGridSize);
-
     // Create a light
     Ogre::Light* myLight = ClientApp::GetSceneMgr().createLight("Light0");
     myLight->setType(Ogre::Light::LT_DIRECTIONAL);
@@ -34,6 +36,7 @@ ClientGame::ClientGame(ServerProxyPtr aServerProxy, UnitId aAvatar, int32 aGridS
     myLight->setSpecularColour(1, 1, 1);
 
     mTileUnderCursor = mTiles.at(0);
+    mCursorPosition = mTileUnderCursor->GetPosition();
     mSelectionMarker = ClientApp::GetSceneMgr().getRootSceneNode()->createChildSceneNode();
     mSelectionMarker->setScale(Ogre::Vector3(0.1));
     mSelectionMarker->attachObject(ClientApp::GetSceneMgr().createEntity("Marker", Ogre::SceneManager::PT_SPHERE));
@@ -51,7 +54,14 @@ ClientGame::ClientGame(ServerProxyPtr aServerProxy, UnitId aAvatar, int32 aGridS
     Hide("ServerBrowser");
     Show("StatusPanel");
 
-    RequestUpdate();
+    if (FLAGS_subscribe)
+    {
+        mServerProxy->Subscribe(boost::bind(&ClientGame::OnPayloadMsg, this, _1), mTime);
+    }
+    else
+    {
+        RequestUpdate();
+    }
 }
 
 ClientGame::~ClientGame()
@@ -85,7 +95,8 @@ void ClientGame::UpdateTileUnderCursor(Ogre::Ray aRay)
     if (res.first)
     {
         Ogre::Vector3 position(aRay.getPoint(res.second));
-        mTileUnderCursor = mTileUnderCursor->GetTileAtPosition(position);
+        mTileUnderCursor = mTiles.at(mGrid.GetIndex().GetTile(position));
+        mCursorPosition = position;
         if (mSelectionMarker->getParent())
         {
             mSelectionMarker->getParent()->removeChild(mSelectionMarker);
@@ -163,6 +174,9 @@ void ClientGame::OnAct()
         PayloadPtr req(new PayloadMsg());
         CommandMoveMsg* move = req->mutable_commandmove();
         move->set_position(mTileUnderCursor->GetTileId());
+        move->set_target_x(mCursorPosition.x);
+        move->set_target_y(mCursorPosition.y);
+        move->set_target_z(mCursorPosition.z);
         mServerProxy->Request(boost::bind(&ClientGame::OnPayloadMsg, this, _1), req);
     }
 }
@@ -197,6 +211,15 @@ void ClientGame::DeleteUnit(UnitId aUnitId)
     }
 }
 
+void ClientGame::DeleteUnits(ClientTile& aTile)
+{
+    // Deleted unit is removed from the tile
+    while (!aTile.IsLastUnit(aTile.GetUnits()))
+    {
+        DeleteUnit(*aTile.GetUnits());
+    }
+}
+
 void ClientGame::CreateUnit(UnitId aUnitId, uint32 aVisualCode, TileId aTile)
 {
     ClientUnit* unit = new ClientUnit(aUnitId, aVisualCode, mTiles.at(aTile));
@@ -246,6 +269,8 @@ void ClientGame::LoadEvents(ConstPayloadPtr aPayloadMsg)
         {
             TileId tileId = change.showtile().tileid();
             ClientTile* tile = mTiles.at(tileId);
+            // Tile shown again comes with all its units
+            DeleteUnits(*tile);
             tile->CreateEntity(change.showtile().whater() == 0);
         }
 
@@ -254,10 +279,7 @@ void ClientGame::LoadEvents(ConstPayloadPtr aPayloadMsg)
             TileId tileId = change.hidetile().tileid();
             ClientTile* tile = mTiles.at(tileId);
             tile->DestroyEntity();
-            for (ClientTile::UnitIterator i = tile->GetUnits(); !tile->IsLastUnit(i); ++i)
-            {
-                DeleteUnit(*i);
-            }
+            DeleteUnits(*tile);
         }
     }
 }
@@ -360,7 +382,8 @@ void ClientGame::UpdateMovementAnimation(Miliseconds aFrameTime)
 
 void ClientGame::CheckSyncTimer()
 {
-    if (mSyncTimer.IsTime())
+    // Subscribed client does not poll
+    if (!FLAGS_subscribe && mSyncTimer.IsTime())
     {
         RequestUpdate();
         mSyncTimer.Reset(mServerUpdateLength);
@@ -31,8 +31,10 @@ public:
     void keyReleased(const OIS::KeyEvent& arg);
 
     static ClientUnit* GetUnit(UnitId aUnitId);
+    const ClientGeodesicGrid& GetGrid() const { return mGrid; }
 private:
     void DeleteUnit(UnitId aUnitId);
+    void DeleteUnits(ClientTile& aTile);
     void CreateUnit(UnitId aUnitId, uint32 aVisualCode, TileId aTile);
 
     bool OnExit(const CEGUI::EventArgs& args);
@@ -45,7 +47,9 @@ private:
     static ClientUnits mUnits;
     const UnitId mAvatar;
     ClientGeodesicGrid::Tiles mTiles;
+    ClientGeodesicGrid mGrid;
     ClientTile* mTileUnderCursor;
+    Ogre::Vector3 mCursorPosition;
     Ogre::SceneNode* mSelectionMarker;
     Ogre::SceneNode* mTargetMarker;
     Ogre::SceneNode* mAxes;
@@ -16,22 +16,29 @@ public:
     TileEntity* GetTile() const { return mTile; }
     void DestroyEntity();
 
-    void AddNeighbour(ClientTile& aTile) { mNeighbourhood.push_back(&aTile); }
-    void RemoveNeighbour(ClientTile& aTile);
-    void SortNeighbourhood();
-    inline size_t GetNeighbourCount() const { return mNeighbourhood.size(); }
-    ClientTile& GetNeighbour(size_t aIndex) const { return *mNeighbourhood[aIndex]; }
+    void SetNeighbourhood(const TileId* aNeighbours, uint32 aCount, const std::vector<ClientTile*>& aTiles)
+    {
+        mNeighbours = aNeighbours;
+        mNeighbourCount = aCount;
+        mTiles = &aTiles;
+    }
+    inline size_t GetNeighbourCount() const { return mNeighbourCount; }
+    TileId GetNeighbourId(size_t aIndex) const { return mNeighbours[aIndex]; }
+    ClientTile& GetNeighbour(size_t aIndex) const { return *(*mTiles)[mNeighbours[aIndex]]; }
 
     TileId GetTileId() const { return mTileId; }
     Ogre::Vector3 GetPosition() const { return mPosition; }
-    ClientTile* GetTileAtPosition(const Ogre::Vector3& aPosistion);
 
     UnitIterator GetUnits() const { return mUnits.begin(); }
     bool IsLastUnit(UnitIterator aIterator) const { return aIterator == mUnits.end(); }
     void AddUnit(UnitId aUnit) { mUnits.insert(aUnit); }
     void RemoveUnit(UnitId aUnit) { mUnits.erase(aUnit); }
 private:
-    std::vector< ClientTile* > mNeighbourhood;
+    // Points into grid adjacency table
+    const TileId* mNeighbours;
+    uint32 mNeighbourCount;
+    // Vector of grid tiles, not its storage, which may be reallocated
+    const std::vector<ClientTile*>* mTiles;
     std::set<UnitId> mUnits;
     const TileId mTileId;
     TileEntity* mTile;
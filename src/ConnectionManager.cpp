@@ -7,6 +7,8 @@
 #include <openssl/srp.h>
 #include <UserList.h>
 
+DEFINE_int32(network_threads, 0, "Threads serving client connections, 0 - one per hardware thread");
+
 static int SSLSRPServerParamCallback(SSL *s, int *ad, void *arg)
 {
 	const char* userName = SSL_get_srp_username(s);
@@ -38,35 +40,86 @@ static int SSLSRPServerParamCallback(SSL *s, int *ad, void *arg)
 	return SSL_ERROR_NONE;
 }
 
-void ConnectionManager(ServerGame& aGame, Ogre::String aAddress, int32 aPort)
+struct Listener
 {
-    LOG(INFO) << "Init SRP";
+    Listener(ServerGame& aGame, boost::asio::ssl::context& aContext, int32 aPort):
+        mGame(aGame), mContext(aContext),
+        mGate(mIOService, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), aPort))
+    {
+    }
+    ServerGame& mGame;
+    boost::asio::ssl::context& mContext;
+    boost::asio::io_service mIOService;
+    boost::asio::ip::tcp::acceptor mGate;
+};
 
-    boost::asio::ssl::context sslCtx(boost::asio::ssl::context::tlsv1_server);
-    SSL_CTX* ctx = sslCtx.native_handle();
+static void StartAccept(Listener& aListener);
+
+static void HandleAccept(Listener& aListener, ClientConnectionPtr aConnection, const boost::system::error_code& aError)
+{
+    if (aError)
+    {
+        LOG(ERROR) << "Accept failed: " << aError.message();
+    }
+    else
+    {
+        aConnection->Start();
+    }
+    StartAccept(aListener);
+}
+
+static void StartAccept(Listener& aListener)
+{
+    ClientConnectionPtr connection(new ClientConnection(aListener.mGame, aListener.mIOService, aListener.mContext));
+    aListener.mGate.async_accept(connection->GetSocket(),
+        boost::bind(HandleAccept, boost::ref(aListener), connection, boost::asio::placeholders::error));
+}
+
+static void RunNetwork(boost::asio::io_service& aIOService)
+{
+    aIOService.run();
+}
+
+bool InitServerContext(boost::asio::ssl::context& aContext)
+{
+    SSL_CTX* ctx = aContext.native_handle();
 
     SSL_CTX_set_info_callback(ctx, SSLInfoCallback);
     SSL_CTX_SRP_CTX_init(ctx);
     if (SSL_CTX_set_cipher_list(ctx, "SRP") != 1)
     {
         LOG(ERROR) << "Can not set SRP ciphers";
-        return;
+        return false;
     }
 
     SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, NULL);
     SSL_CTX_set_srp_username_callback(ctx, SSLSRPServerParamCallback);
+    return true;
+}
+
+void ConnectionManager(ServerGame& aGame, Ogre::String aAddress, int32 aPort)
+{
+    LOG(INFO) << "Init SRP";
+
+    boost::asio::ssl::context sslCtx(boost::asio::ssl::context::tlsv1_server);
+    if (!InitServerContext(sslCtx))
+    {
+        return;
+    }
 
-    AddUser("test", "test");
+    AddUser("test", "test", aGame.GetGameMutex());
 
     LOG(INFO) << "Listening to " << aAddress << ":" << aPort;
-    boost::asio::io_service IOService;
-    boost::asio::ip::tcp::acceptor gate(IOService,
-        boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), aPort));
+    Listener listener(aGame, sslCtx, aPort);
+    StartAccept(listener);
 
-    while (true)
+    const size_t threadCount = FLAGS_network_threads > 0 ? FLAGS_network_threads : std::max(boost::thread::hardware_concurrency(), 1u);
+    LOG(INFO) << "Network threads " << threadCount;
+    boost::thread_group threads;
+    for (size_t i = 1; i < threadCount; ++i)
     {
-        SSLStreamPtr sslStream(new SSLStream(IOService, sslCtx));
-        gate.accept(sslStream->lowest_layer());
-        boost::thread thrd(boost::bind(ClientConnection, boost::ref(aGame), sslStream));
+        threads.create_thread(boost::bind(RunNetwork, boost::ref(listener.mIOService)));
     }
+    RunNetwork(listener.mIOService);
+    threads.join_all();
 }
@@ -3,6 +3,8 @@
 
 class ServerGame;
 
+// Users from the user list log in with SRP
+bool InitServerContext(boost::asio::ssl::context& aContext);
 void ConnectionManager(ServerGame& aGame, Ogre::String aAddress, int32 aPort);
 
 
@@ -13,6 +13,8 @@ typedef struct srp_client_arg_st
     char *srplogin;
 } SRP_CLIENT_ARG;
 
+DEFINE_bool(subscribe, false, "Receive updates pushed by server instead of asking for them");
+
 static char* ssl_give_srp_client_pwd_cb(SSL *s, void *arg)
 {
     SRP_CLIENT_ARG *srp_client_arg = (SRP_CLIENT_ARG *)arg;
@@ -70,7 +72,30 @@ int main(int argc, char **argv)
 
         PayloadMsg res;
         net->ReadMessage(res);
-        if(res.has_avatar() && res.has_size())
+        if(res.has_avatar() && res.has_size() && FLAGS_subscribe)
+        {
+            PayloadMsg req;
+            req.set_time(0);
+            req.set_subscribe(true);
+            net->WriteMessage(req);
+            while(true)
+            {
+                PayloadMsg rsp;
+                net->ReadMessage(rsp);
+                while(!rsp.last())
+                {
+                    LOG(INFO) << "Changes " << rsp.changes_size();
+                    rsp.Clear();
+                    net->ReadMessage(rsp);
+                }
+                LOG(INFO) << "Pushed time " << rsp.time();
+                // Acknowledgement lets server push further
+                PayloadMsg ack;
+                ack.set_time(rsp.time());
+                net->WriteMessage(ack);
+            }
+        }
+        else if(res.has_avatar() && res.has_size())
         {
             int64 mTime = 0;
 
@@ -20,12 +20,27 @@ void DummyNetwork::WriteMessage(const PayloadMsg& aMessage)
     mChangesWrited += aMessage.changes_size();
 }
 
+void DummyNetwork::WriteEncoded(const std::string* aMessages, size_t aCount)
+{
+    for (size_t i = 0; i < aCount; ++i)
+    {
+        PayloadMsg message;
+        if (!message.ParseFromString(aMessages[i]))
+        {
+            boost::throw_exception(std::runtime_error("Encoded message is broken"));
+        }
+        WriteMessage(message);
+        mEncodedSizes.push_back(aMessages[i].size());
+    }
+    ++mEncodedWrites;
+}
+
 void DummyNetwork::ReadMessage(PayloadMsg& aMessage)
 {
 
 }
 
-DummyNetwork::DummyNetwork(): mIsLastWrited(false), mChangesWrited(0), mWrites(0)
+DummyNetwork::DummyNetwork(): mIsLastWrited(false), mChangesWrited(0), mWrites(0), mEncodedWrites(0)
 {
     //ctor
 }
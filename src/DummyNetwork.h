@@ -9,6 +9,7 @@ public:
     ~DummyNetwork();
     DummyNetwork(const DummyNetwork& other);
     virtual void WriteMessage(const PayloadMsg& aMessage);
+    virtual void WriteEncoded(const std::string* aMessages, size_t aCount);
     virtual void ReadMessage(PayloadMsg& aMessage);
 
     bool IsLastWrited() const { return mIsLastWrited; }
@@ -16,12 +17,16 @@ public:
     int GetWrites() const { return mWrites; }
     GameTime GetTimeWrited() const { return mTimeWrited; }
     const std::vector<PayloadMsg>& GetMessages() const { return mMessages; }
+    int GetEncodedWrites() const { return mEncodedWrites; }
+    const std::vector<size_t>& GetEncodedSizes() const { return mEncodedSizes; }
 private:
    bool mIsLastWrited;
    int mChangesWrited;
    int mWrites;
    GameTime mTimeWrited;
    std::vector<PayloadMsg> mMessages;
+   int mEncodedWrites;
+   std::vector<size_t> mEncodedSizes;
 };
 
 #endif // DUMMYNETWORK_H
@@ -0,0 +1,114 @@
+#include <pch.h>
+
+#include <FlowField.h>
+
+DEFINE_int32(flow_field_users, 4, "Minds heading to the same tile share a flow field instead of searching paths once there are this many of them");
+
+const TileId FlowField::NO_HOP;
+
+const ServerGeodesicGrid::Tiles* FlowFieldList::mTiles = NULL;
+const TileAdjacency* FlowFieldList::mAdjacency = NULL;
+FlowFieldList::FlowFieldMap FlowFieldList::mFlowFields;
+boost::mutex FlowFieldList::mMutex;
+
+FlowField::FlowField(const ServerGeodesicGrid::Tiles& aTiles, const TileAdjacency& aAdjacency, TileId aTarget):
+    mTiles(aTiles), mAdjacency(aAdjacency), mTarget(aTarget), mVersion(0)
+{
+}
+
+TileId FlowField::GetNextHop(TileId aTile) const
+{
+    {
+        boost::shared_lock<boost::shared_mutex> lock(mMutex);
+        if (!mNextHops.empty() && mVersion == ServerTile::GetTerrainVersion())
+        {
+            return mNextHops[aTile];
+        }
+    }
+    boost::lock_guard<boost::shared_mutex> lock(mMutex);
+    if (mNextHops.empty() || mVersion != ServerTile::GetTerrainVersion())
+    {
+        Build();
+    }
+    return mNextHops[aTile];
+}
+
+void FlowField::Build() const
+{
+    mVersion = ServerTile::GetTerrainVersion();
+    mNextHops.assign(mTiles.size(), NO_HOP);
+    if (!mTiles[mTarget]->CanEnter())
+    {
+        return;
+    }
+
+    // Tiles are reached from the target, so the tile they are reached from is their next hop
+    std::vector<TileId> queue;
+    queue.reserve(mTiles.size());
+    queue.push_back(mTarget);
+    mNextHops[mTarget] = mTarget;
+    for (size_t q = 0; q < queue.size(); ++q)
+    {
+        const TileId tile = queue[q];
+        const TileId* neighbours = mAdjacency.GetNeighbours(tile);
+        for (uint32 n = 0; n < mAdjacency.GetNeighbourCount(tile); ++n)
+        {
+            const TileId neighbour = neighbours[n];
+            if (mNextHops[neighbour] == NO_HOP && mTiles[neighbour]->CanEnter())
+            {
+                mNextHops[neighbour] = tile;
+                queue.push_back(neighbour);
+            }
+        }
+    }
+}
+
+struct FlowFieldList::Deleter
+{
+    void operator()(const FlowField* aFlowField) const
+    {
+        {
+            boost::lock_guard<boost::mutex> lock(FlowFieldList::mMutex);
+            FlowFieldMap::iterator i = FlowFieldList::mFlowFields.find(aFlowField->GetTarget());
+            // Field for the same target may have been created after this one expired
+            if (i != FlowFieldList::mFlowFields.end() && i->second.expired())
+            {
+                FlowFieldList::mFlowFields.erase(i);
+            }
+        }
+        delete aFlowField;
+    }
+};
+
+void FlowFieldList::Init(const ServerGeodesicGrid::Tiles& aTiles, const TileAdjacency& aAdjacency)
+{
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    mTiles = &aTiles;
+    mAdjacency = &aAdjacency;
+}
+
+void FlowFieldList::Clear()
+{
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    mFlowFields.clear();
+    mTiles = NULL;
+    mAdjacency = NULL;
+}
+
+FlowFieldPtr FlowFieldList::GetFlowField(TileId aTarget)
+{
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    FlowFieldPtr flowField = mFlowFields[aTarget].lock();
+    if (!flowField)
+    {
+        flowField.reset(new FlowField(*mTiles, *mAdjacency, aTarget), Deleter());
+        mFlowFields[aTarget] = flowField;
+    }
+    return flowField;
+}
+
+size_t FlowFieldList::GetSize()
+{
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    return mFlowFields.size();
+}
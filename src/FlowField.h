@@ -0,0 +1,56 @@
+#ifndef FLOWFIELD_H
+#define FLOWFIELD_H
+
+#include <Typedefs.h>
+#include <ServerGeodesicGrid.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/thread/shared_mutex.hpp>
+
+DECLARE_int32(flow_field_users);
+
+// Next step towards one target from every tile, found by one breadth
+// first search from the target. Rebuilt on first use after terrain change
+class FlowField: public boost::noncopyable
+{
+public:
+    static const TileId NO_HOP = 0xFFFFFFFF;
+
+    FlowField(const ServerGeodesicGrid::Tiles& aTiles, const TileAdjacency& aAdjacency, TileId aTarget);
+    TileId GetTarget() const { return mTarget; }
+    // NO_HOP if target can not be reached from aTile
+    TileId GetNextHop(TileId aTile) const;
+private:
+    void Build() const;
+
+    const ServerGeodesicGrid::Tiles& mTiles;
+    const TileAdjacency& mAdjacency;
+    const TileId mTarget;
+    mutable std::vector<TileId> mNextHops;
+    mutable uint32 mVersion;
+    mutable boost::shared_mutex mMutex;
+};
+
+typedef boost::shared_ptr<const FlowField> FlowFieldPtr;
+
+// Flow fields shared by all minds heading to the same tile, a field is
+// removed when the last mind releases it
+class FlowFieldList
+{
+public:
+    static void Init(const ServerGeodesicGrid::Tiles& aTiles, const TileAdjacency& aAdjacency);
+    static void Clear();
+    static FlowFieldPtr GetFlowField(TileId aTarget);
+    static size_t GetSize();
+private:
+    struct Deleter;
+
+    typedef boost::unordered_map< TileId, boost::weak_ptr<const FlowField> > FlowFieldMap;
+    static const ServerGeodesicGrid::Tiles* mTiles;
+    static const TileAdjacency* mAdjacency;
+    static FlowFieldMap mFlowFields;
+    static boost::mutex mMutex;
+};
+
+#endif // FLOWFIELD_H
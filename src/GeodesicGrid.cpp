@@ -0,0 +1,5 @@
+#include <pch.h>
+
+#include <GeodesicGrid.h>
+
+DEFINE_int32(grid_threads, 0, "Threads building geodesic grid, 0 or less - one per hardware thread");
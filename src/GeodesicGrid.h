@@ -1,8 +1,17 @@
 #ifndef GEODESICGRID_H
 #define GEODESICGRID_H
 
-#include <Edge.h>
+#include <Typedefs.h>
+#include <CompareEdgesAngles.h>
+#include <TileAdjacency.h>
+#include <TileIndex.h>
+#include <GeodesicGridFile.h>
+#include <WorkerPool.h>
 
+DECLARE_int32(grid_threads);
+
+// Builds geodesic grid on flat index arrays, tile objects are created and linked once at the end.
+// If grid directory is set, built grid is saved to grid file and mapped from it on next start
 template <typename T>
 class GeodesicGrid: public boost::noncopyable
 {
@@ -10,17 +19,96 @@ public:
     typedef std::vector<T*> Tiles;
     GeodesicGrid(Tiles& aTiles, int32 aSize);
 
-    Ogre::Real GetTileRadius() const;
-    ~GeodesicGrid();
+    Ogre::Real GetTileRadius() const { return mTileRadius; }
+    // Same for the same topology, server and client compare it
+    uint32 GetChecksum() const { return mChecksum; }
+    const TileAdjacency& GetAdjacency() const { return mAdjacency; }
+    // Finds tiles by direction, for clicks of clients and their commands
+    const TileIndex& GetIndex() const { return mIndex; }
 private:
-    std::vector< Edge<T>* > mEdges;
-    void Subdivide(const Ogre::Real aSphereRadius, Tiles& aTiles);
-    void InitTiles(Tiles& aTiles);
-    TileId mIdCounter;
+    typedef std::pair<TileId, TileId> Edge;
+    typedef std::vector<Edge> Edges;
+    static const size_t MAX_NEIGHBOURS = 6;
+
+    class CompareAltitude
+    {
+    public:
+        CompareAltitude(const std::vector<Ogre::Vector3>& aPositions): mPositions(aPositions) {}
+        bool operator()(TileId a, TileId b) const { return mPositions[a].z < mPositions[b].z; }
+    private:
+        const std::vector<Ogre::Vector3>& mPositions;
+    };
+
+    class CompareAngles
+    {
+    public:
+        CompareAngles(const std::vector<Ogre::Vector3>& aPositions, TileId aRoot, TileId aPole):
+            mPositions(aPositions), mCompare(aPositions[aRoot], aPositions[aPole]) {}
+        bool operator()(TileId a, TileId b) const
+        {
+            return mCompare.CalcAngle(mPositions[a]) < mCompare.CalcAngle(mPositions[b]);
+        }
+    private:
+        const std::vector<Ogre::Vector3>& mPositions;
+        CompareEdgesAngles<T> mCompare;
+    };
+
+    void Build(int32 aSize);
+    void AddTile(const Ogre::Vector3& aPosition);
+    void AddEdge(Edges& aEdges, TileId aTileA, TileId aTileB);
+    void Subdivide(WorkerPool& aPool, const Ogre::Real aSphereRadius);
+    void DivideEdges(const Ogre::Real aSphereRadius, TileId aFirstTile, size_t aBegin, size_t aEnd);
+    void SortNeighbourhood(TileId aTile);
+    void SortNeighbourhoods(size_t aBegin, size_t aEnd);
+    void InitAdjacency(WorkerPool& aPool);
+    void LinkTiles(Tiles& aTiles);
+    void BuildIndex(const Tiles& aTiles);
+
+    std::vector<Ogre::Vector3> mPositions;
+    // MAX_NEIGHBOURS slots per tile, mNeighbourCounts of them are used
+    std::vector<TileId> mNeighbours;
+    std::vector<uint32> mNeighbourCounts;
+    Edges mEdges;
+    Ogre::Real mTileRadius;
+    uint32 mChecksum;
+    TileAdjacency mAdjacency;
+    TileIndex mIndex;
+    GeodesicGridFile mFile;
 };
 
 template <typename T>
-GeodesicGrid<T>::GeodesicGrid(Tiles& aTiles, int aSize)
+GeodesicGrid<T>::GeodesicGrid(Tiles& aTiles, int32 aSize)
+{
+    if (mFile.Open(aSize))
+    {
+        mTileRadius = mFile.GetTileRadius();
+        mChecksum = mFile.GetChecksum();
+        mAdjacency.Assign(mFile.GetOffsets(), mFile.GetNeighbours(), mFile.GetTileCount());
+        aTiles.reserve(mFile.GetTileCount());
+        for (TileId i = 0; i < mFile.GetTileCount(); ++i)
+        {
+            aTiles.push_back(new T(i, mFile.GetPosition(i)));
+        }
+    }
+    else
+    {
+        Build(aSize);
+        mChecksum = GeodesicGridFile::CalcChecksum(aSize, mAdjacency);
+        mFile.Save(aSize, mTileRadius, mChecksum, mPositions, mAdjacency);
+        aTiles.reserve(mPositions.size());
+        for (TileId i = 0; i < mPositions.size(); ++i)
+        {
+            aTiles.push_back(new T(i, mPositions[i]));
+        }
+        std::vector<Ogre::Vector3>().swap(mPositions);
+    }
+
+    LinkTiles(aTiles);
+    BuildIndex(aTiles);
+}
+
+template <typename T>
+void GeodesicGrid<T>::Build(int32 aSize)
 {
     // 2    600
     // 3   2000
@@ -36,26 +124,29 @@ GeodesicGrid<T>::GeodesicGrid(Tiles& aTiles, int aSize)
 
     int edgeCount = tileCount * 3;
 
-    aTiles.reserve(tileCount);
+    WorkerPool pool(std::max(FLAGS_grid_threads, 0));
+
+    mPositions.reserve(tileCount);
+    mNeighbours.reserve(tileCount * MAX_NEIGHBOURS);
+    mNeighbourCounts.reserve(tileCount);
     mEdges.reserve(edgeCount);
 
     // Vertices of icoshaedron
 
-    aTiles.push_back(new T( 0, Ogre::Vector3(0.0f, 1.0f, phi).normalisedCopy() * sphereRadius));
-    aTiles.push_back(new T( 1, Ogre::Vector3(0.0f, 1.0f, -phi).normalisedCopy() * sphereRadius));
-    aTiles.push_back(new T( 2, Ogre::Vector3(0.0f, -1.0f, phi).normalisedCopy() * sphereRadius));
-    aTiles.push_back(new T( 3, Ogre::Vector3(0.0f, -1.0f, -phi).normalisedCopy() * sphereRadius));
+    AddTile(Ogre::Vector3(0.0f, 1.0f, phi).normalisedCopy() * sphereRadius);
+    AddTile(Ogre::Vector3(0.0f, 1.0f, -phi).normalisedCopy() * sphereRadius);
+    AddTile(Ogre::Vector3(0.0f, -1.0f, phi).normalisedCopy() * sphereRadius);
+    AddTile(Ogre::Vector3(0.0f, -1.0f, -phi).normalisedCopy() * sphereRadius);
 
-    aTiles.push_back(new T( 4, Ogre::Vector3(1.0f, phi, 0.0f).normalisedCopy() * sphereRadius));
-    aTiles.push_back(new T( 5, Ogre::Vector3(1.0f, -phi, 0.0f).normalisedCopy() * sphereRadius));
-    aTiles.push_back(new T( 6, Ogre::Vector3(-1.0f, phi, 0.0f).normalisedCopy() * sphereRadius));
-    aTiles.push_back(new T( 7, Ogre::Vector3(-1.0f, -phi, 0.0f).normalisedCopy() * sphereRadius));
+    AddTile(Ogre::Vector3(1.0f, phi, 0.0f).normalisedCopy() * sphereRadius);
+    AddTile(Ogre::Vector3(1.0f, -phi, 0.0f).normalisedCopy() * sphereRadius);
+    AddTile(Ogre::Vector3(-1.0f, phi, 0.0f).normalisedCopy() * sphereRadius);
+    AddTile(Ogre::Vector3(-1.0f, -phi, 0.0f).normalisedCopy() * sphereRadius);
 
-    aTiles.push_back(new T( 8, Ogre::Vector3(phi, 0.0f, 1.0f).normalisedCopy() * sphereRadius));
-    aTiles.push_back(new T( 9, Ogre::Vector3(phi, 0.0f, -1.0f).normalisedCopy() * sphereRadius));
-    aTiles.push_back(new T(10, Ogre::Vector3(-phi, 0.0f, 1.0f).normalisedCopy() * sphereRadius));
-    aTiles.push_back(new T(11, Ogre::Vector3(-phi, 0.0f, -1.0f).normalisedCopy() * sphereRadius));
-    mIdCounter = 12;
+    AddTile(Ogre::Vector3(phi, 0.0f, 1.0f).normalisedCopy() * sphereRadius);
+    AddTile(Ogre::Vector3(phi, 0.0f, -1.0f).normalisedCopy() * sphereRadius);
+    AddTile(Ogre::Vector3(-phi, 0.0f, 1.0f).normalisedCopy() * sphereRadius);
+    AddTile(Ogre::Vector3(-phi, 0.0f, -1.0f).normalisedCopy() * sphereRadius);
 
     // Link icoshaedron
 
@@ -64,139 +155,187 @@ GeodesicGrid<T>::GeodesicGrid(Tiles& aTiles, int aSize)
     //    9 - 5 - 7 -11 - 1 - 9
     //      3   3   3   3   3
 
-    mEdges.push_back(new Edge<T>(*aTiles[0], *aTiles[2]));
-    mEdges.push_back(new Edge<T>(*aTiles[0], *aTiles[4]));
-    mEdges.push_back(new Edge<T>(*aTiles[0], *aTiles[6]));
-    mEdges.push_back(new Edge<T>(*aTiles[0], *aTiles[8]));
-    mEdges.push_back(new Edge<T>(*aTiles[0], *aTiles[10]));
+    AddEdge(mEdges, 0, 2);
+    AddEdge(mEdges, 0, 4);
+    AddEdge(mEdges, 0, 6);
+    AddEdge(mEdges, 0, 8);
+    AddEdge(mEdges, 0, 10);
 
-    mEdges.push_back(new Edge<T>(*aTiles[1], *aTiles[3]));
-    mEdges.push_back(new Edge<T>(*aTiles[1], *aTiles[4]));
-    mEdges.push_back(new Edge<T>(*aTiles[1], *aTiles[6]));
-    mEdges.push_back(new Edge<T>(*aTiles[1], *aTiles[9]));
-    mEdges.push_back(new Edge<T>(*aTiles[1], *aTiles[11]));
+    AddEdge(mEdges, 1, 3);
+    AddEdge(mEdges, 1, 4);
+    AddEdge(mEdges, 1, 6);
+    AddEdge(mEdges, 1, 9);
+    AddEdge(mEdges, 1, 11);
 
-    mEdges.push_back(new Edge<T>(*aTiles[2], *aTiles[5]));
-    mEdges.push_back(new Edge<T>(*aTiles[2], *aTiles[7]));
-    mEdges.push_back(new Edge<T>(*aTiles[2], *aTiles[8]));
-    mEdges.push_back(new Edge<T>(*aTiles[2], *aTiles[10]));
+    AddEdge(mEdges, 2, 5);
+    AddEdge(mEdges, 2, 7);
+    AddEdge(mEdges, 2, 8);
+    AddEdge(mEdges, 2, 10);
 
-    mEdges.push_back(new Edge<T>(*aTiles[3], *aTiles[5]));
-    mEdges.push_back(new Edge<T>(*aTiles[3], *aTiles[7]));
-    mEdges.push_back(new Edge<T>(*aTiles[3], *aTiles[9]));
-    mEdges.push_back(new Edge<T>(*aTiles[3], *aTiles[11]));
+    AddEdge(mEdges, 3, 5);
+    AddEdge(mEdges, 3, 7);
+    AddEdge(mEdges, 3, 9);
+    AddEdge(mEdges, 3, 11);
 
-    mEdges.push_back(new Edge<T>(*aTiles[4], *aTiles[6]));
-    mEdges.push_back(new Edge<T>(*aTiles[4], *aTiles[8]));
-    mEdges.push_back(new Edge<T>(*aTiles[4], *aTiles[9]));
+    AddEdge(mEdges, 4, 6);
+    AddEdge(mEdges, 4, 8);
+    AddEdge(mEdges, 4, 9);
 
-    mEdges.push_back(new Edge<T>(*aTiles[5], *aTiles[7]));
-    mEdges.push_back(new Edge<T>(*aTiles[5], *aTiles[8]));
-    mEdges.push_back(new Edge<T>(*aTiles[5], *aTiles[9]));
+    AddEdge(mEdges, 5, 7);
+    AddEdge(mEdges, 5, 8);
+    AddEdge(mEdges, 5, 9);
 
-    mEdges.push_back(new Edge<T>(*aTiles[6], *aTiles[10]));
-    mEdges.push_back(new Edge<T>(*aTiles[6], *aTiles[11]));
+    AddEdge(mEdges, 6, 10);
+    AddEdge(mEdges, 6, 11);
 
-    mEdges.push_back(new Edge<T>(*aTiles[7], *aTiles[10]));
-    mEdges.push_back(new Edge<T>(*aTiles[7], *aTiles[11]));
+    AddEdge(mEdges, 7, 10);
+    AddEdge(mEdges, 7, 11);
 
-    mEdges.push_back(new Edge<T>(*aTiles[8], *aTiles[9]));
+    AddEdge(mEdges, 8, 9);
 
-    mEdges.push_back(new Edge<T>(*aTiles[10], *aTiles[11]));
+    AddEdge(mEdges, 10, 11);
 
     for (int i = 0; i <= aSize; ++i)
     {
-        Subdivide(sphereRadius, aTiles);
+        Subdivide(pool, sphereRadius);
     }
 
-    InitTiles(aTiles);
+    InitAdjacency(pool);
 }
 
 template <typename T>
-GeodesicGrid<T>::~GeodesicGrid()
+void GeodesicGrid<T>::AddTile(const Ogre::Vector3& aPosition)
 {
-    for (size_t i = 0; i < mEdges.size(); ++i)
-    {
-        delete mEdges[i];
-        mEdges[i] = NULL;
-    }
+    mPositions.push_back(aPosition);
+    mNeighbours.resize(mNeighbours.size() + MAX_NEIGHBOURS);
+    mNeighbourCounts.push_back(0);
 }
 
 template <typename T>
-void GeodesicGrid<T>::Subdivide(const Ogre::Real aSphereRadius, Tiles& aTiles)
+void GeodesicGrid<T>::AddEdge(Edges& aEdges, TileId aTileA, TileId aTileB)
 {
-    Tiles newTiles;
-    newTiles.reserve(mEdges.size());
-    std::vector< Edge<T>* > newEdges;
-
-    // Dividing edges
-    for (size_t i = 0; i < mEdges.size(); ++i)
-    {
-        Edge<T>* edge = mEdges[i];
-        const Ogre::Vector3& a = edge->GetTileA().GetPosition();
-        const Ogre::Vector3& b = edge->GetTileB().GetPosition();
-
-        T* tile = new T(mIdCounter, (a + b).normalisedCopy() * aSphereRadius);
-        mIdCounter += 1;
-
-        newEdges.push_back(new Edge<T>(*tile, edge->GetTileA()));
-        newEdges.push_back(new Edge<T>(*tile, edge->GetTileB()));
-        newTiles.push_back(tile);
-    }
+    assert(mNeighbourCounts[aTileA] < MAX_NEIGHBOURS);
+    assert(mNeighbourCounts[aTileB] < MAX_NEIGHBOURS);
+    mNeighbours[aTileA * MAX_NEIGHBOURS + mNeighbourCounts[aTileA]++] = aTileB;
+    mNeighbours[aTileB * MAX_NEIGHBOURS + mNeighbourCounts[aTileB]++] = aTileA;
+    aEdges.push_back(Edge(aTileA, aTileB));
+}
 
-    // Replacing edges
+template <typename T>
+void GeodesicGrid<T>::Subdivide(WorkerPool& aPool, const Ogre::Real aSphereRadius)
+{
+    const TileId oldTileCount = mPositions.size();
+    const TileId tileCount = oldTileCount + mEdges.size();
+    Edges newEdges;
+    newEdges.reserve(mEdges.size() * 4);
+
+    // Old tiles are linked only with the tiles in the middle of their edges
+    std::fill(mNeighbourCounts.begin(), mNeighbourCounts.end(), 0);
+    mPositions.resize(tileCount);
+    mNeighbours.resize(tileCount * MAX_NEIGHBOURS);
+    mNeighbourCounts.resize(tileCount, 0);
+
+    // Dividing edges, middle of edge i is tile oldTileCount + i
+    aPool.ParallelFor(mEdges.size(), boost::bind(&GeodesicGrid<T>::DivideEdges, this, aSphereRadius, oldTileCount, _1, _2));
+    // Neighbourhoods are filled in edge order, sorting results depend on it
     for (size_t i = 0; i < mEdges.size(); ++i)
     {
-        mEdges[i]->Unlink();
-        delete mEdges[i];
+        const TileId tile = oldTileCount + i;
+        AddEdge(newEdges, tile, mEdges[i].first);
+        AddEdge(newEdges, tile, mEdges[i].second);
     }
-    mEdges = newEdges;
-
+    mEdges.swap(newEdges);
 
-    // Linking new tiles (mTiles holds only old tiles)
-    for (size_t i = 0; i < aTiles.size(); ++i)
+    // Linking new tiles around each old one
+    aPool.ParallelFor(oldTileCount, boost::bind(&GeodesicGrid<T>::SortNeighbourhoods, this, _1, _2));
+    for (TileId i = 0; i < oldTileCount; ++i)
     {
-        T* tile = aTiles[i];
-        tile->SortNeighbourhood();
-        for (size_t i = 0; i < tile->GetNeighbourCount(); ++i)
+        const size_t count = mNeighbourCounts[i];
+        const TileId* neighbours = &mNeighbours[i * MAX_NEIGHBOURS];
+        for (size_t n = 0; n < count; ++n)
         {
-            size_t to = i + 1;
-            if (to >= tile->GetNeighbourCount())
+            size_t to = n + 1;
+            if (to >= count)
             {
                 to = 0;
             }
-            mEdges.push_back(new Edge<T>(tile->GetNeighbour(i), tile->GetNeighbour(to)));
+            AddEdge(mEdges, neighbours[n], neighbours[to]);
         }
     }
+}
 
-    // Appending tiles
-    aTiles.insert(aTiles.end(), newTiles.begin(), newTiles.end());
-
+template <typename T>
+void GeodesicGrid<T>::DivideEdges(const Ogre::Real aSphereRadius, TileId aFirstTile, size_t aBegin, size_t aEnd)
+{
+    for (size_t i = aBegin; i < aEnd; ++i)
+    {
+        const Edge& edge = mEdges[i];
+        mPositions[aFirstTile + i] = (mPositions[edge.first] + mPositions[edge.second]).normalisedCopy() * aSphereRadius;
+    }
 }
 
+template <typename T>
+void GeodesicGrid<T>::SortNeighbourhood(TileId aTile)
+{
+    TileId* begin = &mNeighbours[aTile * MAX_NEIGHBOURS];
+    TileId* end = begin + mNeighbourCounts[aTile];
+    std::sort(begin, end, CompareAltitude(mPositions));
+    std::sort(begin + 1, end, CompareAngles(mPositions, aTile, *begin));
+}
 
 template <typename T>
-void GeodesicGrid<T>::InitTiles(Tiles& aTiles)
+void GeodesicGrid<T>::SortNeighbourhoods(size_t aBegin, size_t aEnd)
 {
-    for (TileId i = 0; i < aTiles.size(); ++i)
+    for (size_t i = aBegin; i < aEnd; ++i)
     {
-        aTiles[i]->SortNeighbourhood();
-        assert(aTiles[i]->GetTileId() == i);
+        SortNeighbourhood(i);
     }
 }
 
 template <typename T>
-Ogre::Real GeodesicGrid<T>::GetTileRadius() const
+void GeodesicGrid<T>::InitAdjacency(WorkerPool& aPool)
 {
     Ogre::Real sum = 0;
     for (size_t i = 0; i < mEdges.size(); ++i)
     {
-        const Edge<T>* edge = mEdges.at(i);
-        sum += (edge->GetTileA().GetPosition() - edge->GetTileB().GetPosition()).squaredLength();
+        const Edge& edge = mEdges[i];
+        sum += (mPositions[edge.first] - mPositions[edge.second]).squaredLength();
     }
-    return sqrt(sum / mEdges.size() / 2.0f);
+    mTileRadius = sqrt(sum / mEdges.size() / 2.0f);
+    Edges().swap(mEdges);
+
+    aPool.ParallelFor(mPositions.size(), boost::bind(&GeodesicGrid<T>::SortNeighbourhoods, this, _1, _2));
+    mAdjacency.Reserve(mPositions.size(), mPositions.size() * MAX_NEIGHBOURS);
+    for (TileId i = 0; i < mPositions.size(); ++i)
+    {
+        const TileId* neighbours = &mNeighbours[i * MAX_NEIGHBOURS];
+        mAdjacency.AddTile(neighbours, neighbours + mNeighbourCounts[i]);
+    }
+    std::vector<TileId>().swap(mNeighbours);
+    std::vector<uint32>().swap(mNeighbourCounts);
 }
 
+template <typename T>
+void GeodesicGrid<T>::LinkTiles(Tiles& aTiles)
+{
+    // Tiles keep the vector, it must outlive them and tiles must not be removed
+    for (TileId i = 0; i < aTiles.size(); ++i)
+    {
+        aTiles[i]->SetNeighbourhood(mAdjacency.GetNeighbours(i), mAdjacency.GetNeighbourCount(i), aTiles);
+    }
+}
 
-#endif // SERVERGEODESICGRID_H
+template <typename T>
+void GeodesicGrid<T>::BuildIndex(const Tiles& aTiles)
+{
+    // Built before the grid is shared, so threads only read it
+    std::vector<Ogre::Vector3> positions;
+    positions.reserve(aTiles.size());
+    for (TileId i = 0; i < aTiles.size(); ++i)
+    {
+        positions.push_back(aTiles[i]->GetPosition());
+    }
+    mIndex.Build(positions, mAdjacency);
+}
 
+#endif // GEODESICGRID_H
@@ -0,0 +1,186 @@
+#include <pch.h>
+
+#include <GeodesicGridFile.h>
+#include <boost/interprocess/file_mapping.hpp>
+#include <fstream>
+
+DEFINE_string(grid_dir, "grid", "Directory for precomputed geodesic grid files, empty to build grid on every start");
+DEFINE_bool(grid_verify, false, "Check whole body of grid file when it is mapped, not only its header");
+
+namespace
+{
+    const char MAGIC[4] = {'S', 'C', 'G', 'G'};
+
+    uint32 HashBytes(uint32 aHash, const void* aData, size_t aLength)
+    {
+        const unsigned char* data = static_cast<const unsigned char*>(aData);
+        for (size_t i = 0; i < aLength; ++i)
+        {
+            aHash = (aHash ^ data[i]) * 16777619u;
+        }
+        return aHash;
+    }
+
+    std::vector<float> ToFloats(const std::vector<Ogre::Vector3>& aPositions)
+    {
+        std::vector<float> result;
+        result.reserve(aPositions.size() * 3);
+        for (size_t i = 0; i < aPositions.size(); ++i)
+        {
+            result.push_back(aPositions[i].x);
+            result.push_back(aPositions[i].y);
+            result.push_back(aPositions[i].z);
+        }
+        return result;
+    }
+
+    // Positions are left out, floats of the same grid differ between compilers
+    uint32 HashTopology(int32 aSize, const uint32* aOffsets, const TileId* aNeighbours, size_t aTileCount)
+    {
+        const uint32 version = GeodesicGridFile::VERSION;
+        uint32 hash = 2166136261u;
+        hash = HashBytes(hash, &aSize, sizeof(aSize));
+        hash = HashBytes(hash, &version, sizeof(version));
+        hash = HashBytes(hash, aOffsets, (aTileCount + 1) * sizeof(uint32));
+        hash = HashBytes(hash, aNeighbours, aOffsets[aTileCount] * sizeof(TileId));
+        return hash;
+    }
+
+    uint32 HashPositions(const float* aPositions, size_t aTileCount)
+    {
+        return HashBytes(2166136261u, aPositions, aTileCount * 3 * sizeof(float));
+    }
+}
+
+std::string GeodesicGridFile::GetPath(int32 aSize)
+{
+    return (boost::filesystem::path(FLAGS_grid_dir) / ("grid" + Ogre::StringConverter::toString(aSize) + ".bin")).string();
+}
+
+uint32 GeodesicGridFile::CalcChecksum(int32 aSize, const TileAdjacency& aAdjacency)
+{
+    return HashTopology(aSize, aAdjacency.GetOffsets(), aAdjacency.GetNeighbours(0), aAdjacency.GetTileCount());
+}
+
+bool GeodesicGridFile::Open(int32 aSize)
+{
+    if (FLAGS_grid_dir.empty())
+    {
+        return false;
+    }
+
+    const std::string path = GetPath(aSize);
+    boost::interprocess::mapped_region region;
+    try
+    {
+        boost::interprocess::file_mapping file(path.c_str(), boost::interprocess::read_only);
+        boost::interprocess::mapped_region(file, boost::interprocess::read_only).swap(region);
+    }
+    catch (const boost::interprocess::interprocess_exception& e)
+    {
+        LOG(INFO) << "No grid file " << path << " " << e.what();
+        return false;
+    }
+
+    const size_t fileSize = region.get_size();
+    const Header* header = static_cast<const Header*>(region.get_address());
+    const uint32 tileCount = 10 * (1u << (2 * (aSize + 1))) + 2;
+    if (fileSize < sizeof(Header) ||
+        memcmp(header->mMagic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header->mVersion != VERSION ||
+        header->mSize != aSize ||
+        header->mTileCount != tileCount ||
+        fileSize != sizeof(Header) + tileCount * 3 * sizeof(float) + (tileCount + 1) * sizeof(uint32) + header->mNeighbourCount * sizeof(TileId))
+    {
+        LOG(WARNING) << "Invalid grid file " << path;
+        return false;
+    }
+
+    const char* data = static_cast<const char*>(region.get_address()) + sizeof(Header);
+    const float* positions = reinterpret_cast<const float*>(data);
+    const uint32* offsets = reinterpret_cast<const uint32*>(positions + tileCount * 3);
+    const TileId* neighbours = reinterpret_cast<const TileId*>(offsets + tileCount + 1);
+    // Body is trusted by tile linking and indexing, so stale or corrupt
+    // file must not get there. Ranges are checked on every start, hashes
+    // of the whole body only on request
+    bool valid = offsets[0] == 0 && offsets[tileCount] == header->mNeighbourCount;
+    for (uint32 i = 0; valid && i < tileCount; ++i)
+    {
+        valid = offsets[i] <= offsets[i + 1] && offsets[i + 1] - offsets[i] <= MAX_NEIGHBOURS;
+    }
+    for (uint32 i = 0; valid && i < header->mNeighbourCount; ++i)
+    {
+        valid = neighbours[i] < tileCount;
+    }
+    for (uint32 i = 0; valid && i < tileCount * 3; ++i)
+    {
+        // False for infinity and NaN
+        valid = positions[i] - positions[i] == 0;
+    }
+    if (valid && FLAGS_grid_verify)
+    {
+        valid = HashTopology(aSize, offsets, neighbours, tileCount) == header->mChecksum &&
+            HashPositions(positions, tileCount) == header->mPositionHash;
+    }
+    if (!valid)
+    {
+        LOG(WARNING) << "Invalid grid file " << path;
+        return false;
+    }
+
+    mRegion.swap(region);
+    mHeader = header;
+    mPositions = positions;
+    mOffsets = offsets;
+    mNeighbours = neighbours;
+    LOG(INFO) << "Grid file mapped " << path;
+    return true;
+}
+
+void GeodesicGridFile::Save(int32 aSize, Ogre::Real aTileRadius, uint32 aChecksum, const std::vector<Ogre::Vector3>& aPositions, const TileAdjacency& aAdjacency)
+{
+    if (FLAGS_grid_dir.empty())
+    {
+        return;
+    }
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.mMagic, MAGIC, sizeof(MAGIC));
+    header.mVersion = VERSION;
+    header.mSize = aSize;
+    header.mTileCount = aAdjacency.GetTileCount();
+    header.mNeighbourCount = aAdjacency.GetTotalNeighbourCount();
+    header.mChecksum = aChecksum;
+    header.mTileRadius = aTileRadius;
+
+    const std::vector<float> positions = ToFloats(aPositions);
+    header.mPositionHash = HashPositions(&positions[0], header.mTileCount);
+
+    // Written aside and renamed, so that nobody maps half written file
+    const std::string path = GetPath(aSize);
+    const std::string temp = path + ".tmp";
+    boost::system::error_code error;
+    boost::filesystem::create_directories(FLAGS_grid_dir, error);
+    {
+        std::ofstream out(temp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(&positions[0]), positions.size() * sizeof(float));
+        out.write(reinterpret_cast<const char*>(aAdjacency.GetOffsets()), (header.mTileCount + 1) * sizeof(uint32));
+        out.write(reinterpret_cast<const char*>(aAdjacency.GetNeighbours(0)), header.mNeighbourCount * sizeof(TileId));
+        if (!out)
+        {
+            LOG(WARNING) << "Can not write grid file " << temp;
+            return;
+        }
+    }
+
+    boost::filesystem::rename(temp, path, error);
+    if (error)
+    {
+        LOG(WARNING) << "Can not write grid file " << path << " " << error.message();
+        boost::filesystem::remove(temp, error);
+        return;
+    }
+    LOG(INFO) << "Grid file saved " << path;
+}
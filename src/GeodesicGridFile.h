@@ -0,0 +1,62 @@
+#ifndef GEODESICGRIDFILE_H
+#define GEODESICGRIDFILE_H
+
+#include <Typedefs.h>
+#include <OgreVector3.h>
+#include <TileAdjacency.h>
+#include <gflags/gflags.h>
+#include <boost/interprocess/mapped_region.hpp>
+
+DECLARE_string(grid_dir);
+DECLARE_bool(grid_verify);
+
+// Precomputed grid of one size, mapped read only. Layout after the header:
+// float positions[3 * tile count], uint32 offsets[tile count + 1], TileId neighbours[neighbour count]
+class GeodesicGridFile: public boost::noncopyable
+{
+public:
+    // Must be increased on any change of the grid algorithm or of the layout,
+    // server and client compare grid checksums on handshake anyway
+    static const uint32 VERSION = 2;
+    // Neighbours of a tile in a valid file
+    static const uint32 MAX_NEIGHBOURS = 6;
+
+    GeodesicGridFile(): mHeader(NULL) {}
+
+    bool Open(int32 aSize);
+    void Save(int32 aSize, Ogre::Real aTileRadius, uint32 aChecksum, const std::vector<Ogre::Vector3>& aPositions, const TileAdjacency& aAdjacency);
+    static std::string GetPath(int32 aSize);
+    // Hash of the size, the version and the topology, same on every platform
+    static uint32 CalcChecksum(int32 aSize, const TileAdjacency& aAdjacency);
+
+    size_t GetTileCount() const { return mHeader->mTileCount; }
+    Ogre::Real GetTileRadius() const { return mHeader->mTileRadius; }
+    uint32 GetChecksum() const { return mHeader->mChecksum; }
+    Ogre::Vector3 GetPosition(TileId aTile) const
+    {
+        return Ogre::Vector3(mPositions[aTile * 3], mPositions[aTile * 3 + 1], mPositions[aTile * 3 + 2]);
+    }
+    const uint32* GetOffsets() const { return mOffsets; }
+    const TileId* GetNeighbours() const { return mNeighbours; }
+private:
+    struct Header
+    {
+        char mMagic[4];
+        uint32 mVersion;
+        int32 mSize;
+        uint32 mTileCount;
+        uint32 mNeighbourCount;
+        uint32 mChecksum;
+        float mTileRadius;
+        // Positions are checked apart from the checksum
+        uint32 mPositionHash;
+    };
+
+    boost::interprocess::mapped_region mRegion;
+    const Header* mHeader;
+    const float* mPositions;
+    const uint32* mOffsets;
+    const TileId* mNeighbours;
+};
+
+#endif // GEODESICGRIDFILE_H
@@ -9,6 +9,8 @@ class INetwork
 {
 public:
     virtual void WriteMessage(const PayloadMsg& aMessage) = 0;
+    // Already serialized PayloadMsgs, written at once
+    virtual void WriteEncoded(const std::string* aMessages, size_t aCount) = 0;
     virtual void ReadMessage(PayloadMsg& aMessage) = 0;
     virtual ~INetwork() {}
 };
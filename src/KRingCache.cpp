@@ -0,0 +1,88 @@
+#include <pch.h>
+
+#include <KRingCache.h>
+
+DEFINE_int32(ring_cache_size, 4096, "Amount of field of view rings kept in memory");
+
+KRingCache::KRingCache(const TileAdjacency& aAdjacency, size_t aCapacity):
+    mAdjacency(aAdjacency), mCapacity(std::max<size_t>(aCapacity, 1))
+{
+}
+
+KRingPtr KRingCache::GetRing(TileId aCentre, uint32 aRadius)
+{
+    const Key key(aCentre, aRadius);
+    {
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        Rings::iterator i = mRings.find(key);
+        if (i != mRings.end())
+        {
+            mUsage.splice(mUsage.begin(), mUsage, i->second.second);
+            return i->second.first;
+        }
+    }
+
+    // Calculated without lock, other thread may add the same ring meanwhile
+    KRingPtr ring = CalcRing(mAdjacency, aCentre, aRadius);
+
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    Rings::iterator i = mRings.find(key);
+    if (i != mRings.end())
+    {
+        mUsage.splice(mUsage.begin(), mUsage, i->second.second);
+        return i->second.first;
+    }
+    if (mRings.size() >= mCapacity)
+    {
+        mRings.erase(mUsage.back());
+        mUsage.pop_back();
+    }
+    mUsage.push_front(key);
+    mRings.insert(Rings::value_type(key, Entry(ring, mUsage.begin())));
+    return ring;
+}
+
+size_t KRingCache::GetSize() const
+{
+    boost::lock_guard<boost::mutex> lock(mMutex);
+    return mRings.size();
+}
+
+KRingPtr KRingCache::CalcRing(const TileAdjacency& aAdjacency, TileId aCentre, uint32 aRadius)
+{
+    // Neighbours of a layer lie in the previous, the same or the next layer only
+    std::vector<TileId> previous;
+    std::vector<TileId> current(1, aCentre);
+    std::vector<TileId> next;
+    boost::shared_ptr<KRing> ring(new KRing());
+    ring->mTiles.reserve(1 + 3 * aRadius * (aRadius + 1));
+    ring->mTiles.push_back(aCentre);
+
+    for (uint32 d = 0; d < aRadius; ++d)
+    {
+        next.clear();
+        for (size_t i = 0; i < current.size(); ++i)
+        {
+            const TileId* neighbours = aAdjacency.GetNeighbours(current[i]);
+            const uint32 count = aAdjacency.GetNeighbourCount(current[i]);
+            for (uint32 n = 0; n < count; ++n)
+            {
+                const TileId tile = neighbours[n];
+                if (!std::binary_search(previous.begin(), previous.end(), tile) &&
+                    !std::binary_search(current.begin(), current.end(), tile))
+                {
+                    next.push_back(tile);
+                }
+            }
+        }
+        std::sort(next.begin(), next.end());
+        next.erase(std::unique(next.begin(), next.end()), next.end());
+        ring->mTiles.insert(ring->mTiles.end(), next.begin(), next.end());
+        previous.swap(current);
+        current.swap(next);
+    }
+
+    std::sort(ring->mTiles.begin(), ring->mTiles.end());
+    ring->mPerimeter = current;
+    return ring;
+}
@@ -0,0 +1,48 @@
+#ifndef KRINGCACHE_H
+#define KRINGCACHE_H
+
+#include <Typedefs.h>
+#include <TileAdjacency.h>
+#include <gflags/gflags.h>
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
+#include <list>
+
+DECLARE_int32(ring_cache_size);
+
+typedef std::vector<TileId> TileRing;
+
+struct KRing
+{
+    // Sorted ids of all tiles within radius steps from the centre tile
+    TileRing mTiles;
+    // Sorted ids of tiles exactly radius steps away
+    TileRing mPerimeter;
+};
+typedef boost::shared_ptr<const KRing> KRingPtr;
+
+// Memoises rings of recently asked (tile, radius), least recently used ones are dropped.
+// Returned rings are immutable, so they stay valid for their holders after eviction
+class KRingCache: public boost::noncopyable
+{
+public:
+    KRingCache(const TileAdjacency& aAdjacency, size_t aCapacity);
+
+    KRingPtr GetRing(TileId aCentre, uint32 aRadius);
+    size_t GetSize() const;
+    static KRingPtr CalcRing(const TileAdjacency& aAdjacency, TileId aCentre, uint32 aRadius);
+private:
+    typedef std::pair<TileId, uint32> Key;
+    typedef std::list<Key> Usage;
+    typedef std::pair<KRingPtr, Usage::iterator> Entry;
+    typedef boost::unordered_map<Key, Entry> Rings;
+
+    const TileAdjacency& mAdjacency;
+    const size_t mCapacity;
+    mutable boost::mutex mMutex;
+    // Front is the most recently used
+    Usage mUsage;
+    Rings mRings;
+};
+
+#endif // KRINGCACHE_H
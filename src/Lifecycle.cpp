@@ -0,0 +1,178 @@
+#include <pch.h>
+#include <Lifecycle.h>
+
+#include <UnitList.h>
+#include <UnitClass.h>
+#include <MindList.h>
+
+const uint32 Lifecycle::NONE;
+const uint32 Lifecycle::LEVEL_SIZE;
+const uint32 Lifecycle::LEVELS;
+
+std::vector<GameTime> Lifecycle::mDeaths;
+std::vector<uint32> Lifecycle::mSlots;
+std::vector<uint32> Lifecycle::mNext;
+std::vector<uint32> Lifecycle::mPrev;
+std::vector<uint32> Lifecycle::mHeads(Lifecycle::SLOT_COUNT, Lifecycle::NONE);
+size_t Lifecycle::mLevelCounts[Lifecycle::LEVELS + 1];
+size_t Lifecycle::mPendingCount = 0;
+std::vector<Lifecycle::Death> Lifecycle::mDied;
+GameTime Lifecycle::mTime = 0;
+
+void Lifecycle::Schedule(UnitId aUnitId, uint32 aAge)
+{
+    const uint32 index = UnitList::GetIndex(aUnitId);
+    if (index >= mSlots.size())
+    {
+        mDeaths.resize(index + 1, 0);
+        mSlots.resize(index + 1, NONE);
+        mNext.resize(index + 1, NONE);
+        mPrev.resize(index + 1, NONE);
+    }
+    Unlink(index);
+
+    const uint32 maxAge = UnitList::GetClass(index).GetMaxAge();
+    if (maxAge > 0)
+    {
+        mDeaths[index] = UnitList::GetBirthTime(index) + maxAge - std::min(aAge, maxAge - 1);
+        Insert(index);
+    }
+}
+
+void Lifecycle::Cancel(UnitId aUnitId)
+{
+    const uint32 index = UnitList::GetIndex(aUnitId);
+    if (index < mSlots.size() && UnitList::GetUnitId(index) == aUnitId)
+    {
+        Unlink(index);
+    }
+}
+
+void Lifecycle::Insert(uint32 aIndex)
+{
+    const GameTime death = std::max(mDeaths[aIndex], mTime);
+    // Lowest level on which death and current time share all higher digits
+    uint32 level = 0;
+    while (level < LEVELS && (death >> (LEVEL_BITS * (level + 1))) != (mTime >> (LEVEL_BITS * (level + 1))))
+    {
+        ++level;
+    }
+    const uint32 slot = level == LEVELS ? LEVELS * LEVEL_SIZE :
+        level * LEVEL_SIZE + ((death >> (LEVEL_BITS * level)) & (LEVEL_SIZE - 1));
+
+    mSlots[aIndex] = slot;
+    mPrev[aIndex] = NONE;
+    mNext[aIndex] = mHeads[slot];
+    if (mHeads[slot] != NONE)
+    {
+        mPrev[mHeads[slot]] = aIndex;
+    }
+    mHeads[slot] = aIndex;
+    ++mLevelCounts[level];
+    ++mPendingCount;
+}
+
+void Lifecycle::Unlink(uint32 aIndex)
+{
+    const uint32 slot = mSlots[aIndex];
+    if (slot != NONE)
+    {
+        if (mPrev[aIndex] != NONE)
+        {
+            mNext[mPrev[aIndex]] = mNext[aIndex];
+        }
+        else
+        {
+            mHeads[slot] = mNext[aIndex];
+        }
+        if (mNext[aIndex] != NONE)
+        {
+            mPrev[mNext[aIndex]] = mPrev[aIndex];
+        }
+        mSlots[aIndex] = NONE;
+        --mLevelCounts[slot / LEVEL_SIZE];
+        --mPendingCount;
+    }
+}
+
+void Lifecycle::Cascade(uint32 aSlot)
+{
+    uint32 index = mHeads[aSlot];
+    while (index != NONE)
+    {
+        const uint32 next = mNext[index];
+        Unlink(index);
+        Insert(index);
+        index = next;
+    }
+}
+
+void Lifecycle::Expire(uint32 aSlot)
+{
+    while (mHeads[aSlot] != NONE)
+    {
+        const uint32 index = mHeads[aSlot];
+        const UnitId unitId = UnitList::GetUnitId(index);
+        Unlink(index);
+        if (MindList::HasMind(unitId) && !MindList::IsFree(index))
+        {
+            // Avatars of users do not die, they are looked at again later
+            mDeaths[index] = mTime + UnitList::GetClass(index).GetMaxAge();
+            Insert(index);
+        }
+        else
+        {
+            const Death death = { &UnitList::GetPosition(index), &UnitList::GetClass(index) };
+            mDied.push_back(death);
+            UnitList::DeleteUnit(unitId);
+        }
+    }
+}
+
+void Lifecycle::Advance(GameTime aTime)
+{
+    mDied.clear();
+    while (mTime <= aTime)
+    {
+        if (mPendingCount == 0)
+        {
+            mTime = aTime + 1;
+            break;
+        }
+
+        // Higher levels first, their deaths may fall into lower slots due now
+        for (uint32 level = LEVELS; level > 0; --level)
+        {
+            const GameTime span = 1ull << (LEVEL_BITS * level);
+            if (mTime % span == 0)
+            {
+                Cascade(level == LEVELS ? LEVELS * LEVEL_SIZE :
+                    level * LEVEL_SIZE + ((mTime >> (LEVEL_BITS * level)) & (LEVEL_SIZE - 1)));
+            }
+        }
+        Expire(mTime & (LEVEL_SIZE - 1));
+
+        // Nothing happens until lowest non empty level cascades again
+        uint32 level = 0;
+        while (level < LEVELS && mLevelCounts[level] == 0)
+        {
+            ++level;
+        }
+        const GameTime span = 1ull << (LEVEL_BITS * level);
+        const GameTime next = level == 0 ? mTime + 1 : (mTime / span + 1) * span;
+        mTime = std::min(next, aTime + 1);
+    }
+}
+
+void Lifecycle::Clear()
+{
+    mDeaths.clear();
+    mSlots.clear();
+    mNext.clear();
+    mPrev.clear();
+    mHeads.assign(SLOT_COUNT, NONE);
+    std::fill(mLevelCounts, mLevelCounts + LEVELS + 1, 0);
+    mPendingCount = 0;
+    mDied.clear();
+    mTime = 0;
+}
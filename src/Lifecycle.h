@@ -0,0 +1,56 @@
+#ifndef LIFECYCLE_H
+#define LIFECYCLE_H
+
+#include <Typedefs.h>
+class ServerTile;
+class UnitClass;
+
+// Deaths of units by unit slot, see UnitList. Units are kept in a
+// hierarchical timing wheel by the time they die, each level has 256
+// slots and spans 256 times more time than the level below. Slots are
+// lists linked through arrays by unit slot, so memory stays flat
+class Lifecycle
+{
+public:
+    // Unit dies at its birth time plus max age of its class, never if max
+    // age is 0. Unit may be born aAge old, but it lives at least one turn
+    static void Schedule(UnitId aUnitId, uint32 aAge = 0);
+    static void Cancel(UnitId aUnitId);
+    // Deletes units which die up to and including aTime
+    static void Advance(GameTime aTime);
+    // Tile and class of units deleted by the last Advance, for newborns
+    struct Death
+    {
+        ServerTile* mTile;
+        const UnitClass* mClass;
+    };
+    static const std::vector<Death>& GetDied() { return mDied; }
+    static size_t GetPendingCount() { return mPendingCount; }
+    static void Clear();
+private:
+    static void Insert(uint32 aIndex);
+    static void Unlink(uint32 aIndex);
+    static void Cascade(uint32 aSlot);
+    static void Expire(uint32 aSlot);
+
+    static const uint32 NONE = 0xFFFFFFFF;
+    static const uint32 LEVEL_BITS = 8;
+    static const uint32 LEVEL_SIZE = 1 << LEVEL_BITS;
+    // Deaths beyond the last level wait in one more slot
+    static const uint32 LEVELS = 4;
+    static const uint32 SLOT_COUNT = LEVELS * LEVEL_SIZE + 1;
+
+    static std::vector<GameTime> mDeaths;
+    // Wheel slot of unit, NONE if it is not scheduled
+    static std::vector<uint32> mSlots;
+    static std::vector<uint32> mNext;
+    static std::vector<uint32> mPrev;
+    static std::vector<uint32> mHeads;
+    static size_t mLevelCounts[LEVELS + 1];
+    static size_t mPendingCount;
+    static std::vector<Death> mDied;
+    // Next time to expire
+    static GameTime mTime;
+};
+
+#endif // LIFECYCLE_H
@@ -4,64 +4,116 @@
 #include <ServerUnit.h>
 #include <ServerTile.h>
 #include <UnitList.h>
+#include <MindList.h>
+#include <ServerGame.h>
+#include <RandomStream.h>
 
-Mind::Mind(UnitId aUnitId):mTarget(NULL), mUnitId(aUnitId), mIsFree(true)
+Mind::Mind(UnitId aUnitId):mUnitId(aUnitId), mIndex(UnitList::GetIndex(aUnitId)), mPathVersion(0), mDecision(NOTHING)
 {
     //ctor
 }
 
-Ogre::Radian CalcDistance3(const Ogre::Vector3& a, const Ogre::Vector3& b)
+void Mind::SetCommand(ServerTile& aTile)
 {
-    Ogre::Real lenProduct = a.length() * b.length();
+    MindList::SetTarget(mIndex, &aTile);
+    mPath.clear();
+    mFlowField = FlowFieldList::GetFlowField(aTile.GetTileId());
+    // Decision made for the old command is not applied, see MindList::ApplyMoves
+    mDecision = NOTHING;
+    MindList::Wake(mUnitId);
+}
 
-    // Divide by zero check
-    if(lenProduct < 1e-6f)
-        lenProduct = 1e-6f;
+void Mind::ClearCommand()
+{
+    MindList::SetTarget(mIndex, NULL);
+    mPath.clear();
+    mFlowField.reset();
+    mDecision = NOTHING;
+}
 
-    Ogre::Real f = a.dotProduct(b) / lenProduct;
+void Mind::ApplyDecision(bool aIsApplied)
+{
+    switch (aIsApplied ? mDecision : NOTHING)
+    {
+    case PATH_STEP:
+        mPath.pop_back();
+        break;
+    case FIELD_STEP:
+        // Path is stale once the unit follows the flow field
+        mPath.clear();
+        break;
+    case FINISH:
+        ClearCommand();
+        break;
+    case NOTHING:
+        break;
+    }
+    mDecision = NOTHING;
+}
 
-    f = Ogre::Math::Clamp(f, (Ogre::Real)-1.0, (Ogre::Real)1.0);
-    return Ogre::Math::ACos(f);
+ServerTile* Mind::DecideFree(UnitId aUnitId, ServerTile& aTile)
+{
+    // Same choices whatever thread decides and in which order
+    RandomStream random(FLAGS_world_seed, aUnitId, RandomStream::MIND_MOVE, ServerGame::GetTime());
+    ServerTile& randomTile = aTile.GetNeighbour(random.Next(aTile.GetNeighbourCount()));
+    return randomTile.CanEnter() ? &randomTile : NULL;
 }
 
-void Mind::Update(GameTime aPeriod)
+ServerTile* Mind::Decide(GameTime aPeriod, bool aShared)
 {
-    ServerUnit* unit = UnitList::GetUnit(mUnitId);
-    if (mIsFree)
+    mDecision = NOTHING;
+    ServerTile& currentTile = UnitList::GetPosition(mIndex);
+    ServerTile* target = MindList::GetTarget(mIndex);
+    if (!target)
     {
-        ServerTile& position = unit->GetUnitTile();
-        ServerTile& randomTile = position.GetNeighbour(rand() % position.GetNeighbourCount());
-        if(randomTile.CanEnter())
-        {
-            unit->Move(randomTile);
-        }
+        return NULL;
+    }
+
+    TileId nextId = FlowField::NO_HOP;
+    if (aShared)
+    {
+        nextId = mFlowField->GetNextHop(currentTile.GetTileId());
     }
     else
     {
-        if (mTarget)
+        if (mPath.empty() || mPathVersion != ServerTile::GetTerrainVersion())
         {
-            ServerTile& currentTile = unit->GetUnitTile();
-            ServerTile* currentTarget = &currentTile.GetNeighbour(0);
-            Ogre::Radian currentDist = CalcDistance3(currentTarget->GetPosition(), mTarget->GetPosition());
-            for (size_t i = 1; i < currentTile.GetNeighbourCount(); ++i)
-            {
-                Ogre::Radian dist = CalcDistance3(currentTile.GetNeighbour(i).GetPosition(), mTarget->GetPosition());
-                if (dist < currentDist)
-                {
-                    currentTarget = &currentTile.GetNeighbour(i);
-                    currentDist = dist;
-                }
-            }
+            mPathVersion = ServerTile::GetTerrainVersion();
+            PathFinder::FindPath(currentTile.GetTileId(), target->GetTileId(), mPath);
+        }
+        if (!mPath.empty())
+        {
+            nextId = mPath.back();
+        }
+    }
+    if (nextId == FlowField::NO_HOP || &currentTile == target)
+    {
+        mDecision = FINISH;
+        return NULL;
+    }
 
-            if (currentTarget->CanEnter())
-            {
-                unit->Move(*currentTarget);
-                if (mTarget == currentTarget)
-                {
-                    mTarget = NULL;
-                    //ChangeList::AddCommandDone(mUnitId);
-                }
-            }
+    ServerTile* nextTile = NULL;
+    for (size_t i = 0; i < currentTile.GetNeighbourCount(); ++i)
+    {
+        if (currentTile.GetNeighbourId(i) == nextId)
+        {
+            nextTile = &currentTile.GetNeighbour(i);
         }
     }
+
+    if (!nextTile || !nextTile->CanEnter())
+    {
+        // Unit was moved off the path, or path got blocked
+        mPath.clear();
+        return NULL;
+    }
+
+    // Terrain does not change between decision and move, so the move is done
+    mDecision = aShared ? FIELD_STEP : PATH_STEP;
+    if (target == nextTile)
+    {
+        mDecision = FINISH;
+        //ChangeList::AddCommandDone(mUnitId);
+    }
+    return nextTile;
 }
@@ -3,21 +3,49 @@
 
 #include <Typedefs.h>
 #include <ServerTile.h>
+#include <PathFinder.h>
+#include <FlowField.h>
+#include <MindList.h>
 
 
 class Mind
 {
 public:
     Mind(UnitId aUnitId);
-    void Update(GameTime aPeriod);
-    void SetCommand(ServerTile& aTile) { mTarget = &aTile; }
-    bool IsFree() const { return mIsFree; }
+    // Next tile of a commanded unit, or NULL. Minds decide in parallel,
+    // so only the cached path may change here, world and other minds are
+    // read only. aShared tells to follow the flow field
+    ServerTile* Decide(GameTime aPeriod, bool aShared);
+    // Serially after moves, drops the command or the step taken. Decision
+    // for a command which changed since, or whose move was refused, is
+    // dropped without being applied
+    void ApplyDecision(bool aIsApplied);
+    // Enough minds head to the same tile to share one search
+    bool IsShared() const { return mFlowField.use_count() >= FLAGS_flow_field_users; }
+    static ServerTile* DecideFree(UnitId aUnitId, ServerTile& aTile);
+    void SetCommand(ServerTile& aTile);
+    bool IsFree() const { return MindList::IsFree(mIndex); }
     UnitId GetUnitId() const { return mUnitId; }
-    void SetFree(bool aValue) { mIsFree = aValue; }
+    void SetFree(bool aValue) { MindList::SetFree(mIndex, aValue); MindList::Wake(mUnitId); }
 private:
+    void ClearCommand();
+
+    enum Decision
+    {
+        NOTHING,
+        PATH_STEP,
+        FIELD_STEP,
+        FINISH
+    };
+
     const UnitId mUnitId;
-    ServerTile* mTarget;
-    bool mIsFree;
+    const uint32 mIndex;
+    // Cached path to target, found for mPathVersion of terrain
+    PathFinder::Path mPath;
+    uint32 mPathVersion;
+    // Shared by all minds heading to target, followed once enough of them do
+    FlowFieldPtr mFlowField;
+    Decision mDecision;
 };
 
 #endif // MIND_H
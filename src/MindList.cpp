@@ -4,53 +4,342 @@
 #include <Mind.h>
 #include <ServerUnit.h>
 #include <UnitList.h>
+#include <WorkerPool.h>
 
-MindList::MindListMap MindList::mMinds;
+DEFINE_int32(mind_threads, 0, "Threads deciding moves of minds, 0 or less - one per hardware thread");
+DEFINE_int32(step_updates, 1, "Updates between steps of unit with speed 1, faster units step proportionally more often");
+DEFINE_int32(wander_interval, 1, "Free minds step this many times less often than commanded ones, 1 - as often");
+DEFINE_int32(mind_wheel_size, 256, "Slots in timing wheel of minds");
+
+const uint64 MindList::SLEEPING;
+
+std::vector<Mind*> MindList::mMinds;
+std::vector<UnitId> MindList::mMindIds;
+std::vector<uint8> MindList::mFree;
+std::vector<ServerTile*> MindList::mTargets;
+std::vector<uint32> MindList::mCommands;
+std::vector<uint64> MindList::mNextUpdates;
+size_t MindList::mCount = 0;
+size_t MindList::mActiveCount = 0;
+uint64 MindList::mUpdate = 0;
+std::vector< std::vector<MindList::Entry> > MindList::mWheel;
+std::vector<MindList::Entry> MindList::mDue;
+std::vector<UnitId> MindList::mWoken;
+boost::mutex MindList::mWokenMutex;
+std::vector<MindList::Command> MindList::mPosted;
+std::vector<MindList::Command> MindList::mPostedTaken;
+boost::mutex MindList::mPostedMutex;
+std::vector<uint32> MindList::mDeciding;
+std::vector<ServerTile*> MindList::mMoves;
+std::vector<uint32> MindList::mDecidedCommands;
+std::vector<uint8> MindList::mShared;
+std::vector<UnitId> MindList::mDeleteList;
+boost::scoped_ptr<WorkerPool> MindList::mPool;
 
 void MindList::NewMind(UnitId aUnitId)
 {
-    mMinds.insert(aUnitId, new Mind(aUnitId));
+    const uint32 index = UnitList::GetIndex(aUnitId);
+    if (index >= mMinds.size())
+    {
+        mMinds.resize(index + 1, NULL);
+        mMindIds.resize(index + 1, 0);
+        mFree.resize(index + 1, 0);
+        mTargets.resize(index + 1, NULL);
+        mCommands.resize(index + 1, 0);
+        mNextUpdates.resize(index + 1, SLEEPING);
+    }
+    // Mind of the unit which had the slot before
+    Delete(index);
+
+    mMindIds[index] = aUnitId;
+    mFree[index] = true;
+    mTargets[index] = NULL;
+    ++mCommands[index];
+    mMinds[index] = new Mind(aUnitId);
+    ++mCount;
+    // Free minds are spread over the wander period, so only a small part of
+    // them acts on each update
+    Schedule(index, mUpdate + index % GetWanderPeriod(index));
+}
+
+void MindList::Wake(UnitId aUnitId)
+{
+    boost::lock_guard<boost::mutex> lock(mWokenMutex);
+    mWoken.push_back(aUnitId);
+}
+
+void MindList::PostCommand(UnitId aUnitId, ServerTile& aTile)
+{
+    const Command command = { aUnitId, &aTile };
+    boost::lock_guard<boost::mutex> lock(mPostedMutex);
+    mPosted.push_back(command);
+}
+
+void MindList::Schedule(uint32 aIndex, uint64 aUpdate)
+{
+    mNextUpdates[aIndex] = aUpdate;
+    if (aUpdate != SLEEPING)
+    {
+        if (mWheel.empty())
+        {
+            mWheel.resize(std::max(FLAGS_mind_wheel_size, 1));
+        }
+        const Entry entry = { mMindIds[aIndex], aUpdate };
+        mWheel[aUpdate % mWheel.size()].push_back(entry);
+    }
+}
+
+uint64 MindList::GetStep(uint32 aIndex)
+{
+    const uint32 speed = std::max<uint32>(UnitList::GetClass(aIndex).GetMaxSpeed(), 1);
+    return std::max<uint32>(FLAGS_step_updates / speed, 1);
+}
+
+uint64 MindList::GetWanderPeriod(uint32 aIndex)
+{
+    return GetStep(aIndex) * std::max(FLAGS_wander_interval, 1);
+}
+
+void MindList::Reschedule(uint32 aIndex)
+{
+    // mUpdate is already the next one
+    const uint64 update = mUpdate - 1;
+    if (mFree[aIndex])
+    {
+        Schedule(aIndex, update + GetWanderPeriod(aIndex));
+    }
+    else if (mTargets[aIndex])
+    {
+        Schedule(aIndex, update + GetStep(aIndex));
+    }
+    else
+    {
+        Schedule(aIndex, SLEEPING);
+    }
+}
+
+void MindList::DeleteMind(UnitId aUnitId)
+{
+    if (HasMind(aUnitId))
+    {
+        Delete(UnitList::GetIndex(aUnitId));
+    }
+}
+
+bool MindList::HasMind(UnitId aUnitId)
+{
+    const uint32 index = UnitList::GetIndex(aUnitId);
+    return index < mMindIds.size() && mMindIds[index] == aUnitId;
+}
+
+void MindList::Delete(uint32 aIndex)
+{
+    if (mMinds[aIndex])
+    {
+        delete mMinds[aIndex];
+        mMinds[aIndex] = NULL;
+        mMindIds[aIndex] = 0;
+        mTargets[aIndex] = NULL;
+        mNextUpdates[aIndex] = SLEEPING;
+        --mCount;
+    }
 }
 
 void MindList::UpdateMinds(GameTime aPeriod)
 {
-    std::vector<UnitId> deleteList;
-    deleteList.reserve(mMinds.size() * 0.1f);
-    for (MindListMap::iterator i = mMinds.begin(); i != mMinds.end(); ++i)
+    DecideMoves(aPeriod);
+    ApplyMoves();
+}
+
+void MindList::DecideMoves(GameTime aPeriod)
+{
+    if (mWheel.empty())
+    {
+        mWheel.resize(std::max(FLAGS_mind_wheel_size, 1));
+    }
+
     {
-        ServerUnit* unit = UnitList::GetUnit(i->first);
+        boost::lock_guard<boost::mutex> lock(mPostedMutex);
+        mPostedTaken.swap(mPosted);
+    }
+    // Commands wake minds, so they are given before woken minds are scheduled
+    for (size_t i = 0; i < mPostedTaken.size(); ++i)
+    {
+        if (HasMind(mPostedTaken[i].mUnitId))
+        {
+            mMinds[UnitList::GetIndex(mPostedTaken[i].mUnitId)]->SetCommand(*mPostedTaken[i].mTile);
+        }
+    }
+    mPostedTaken.clear();
+
+    {
+        boost::lock_guard<boost::mutex> lock(mWokenMutex);
+        for (size_t i = 0; i < mWoken.size(); ++i)
+        {
+            const uint32 index = UnitList::GetIndex(mWoken[i]);
+            if (index < mMindIds.size() && mMindIds[index] == mWoken[i] && mNextUpdates[index] != mUpdate)
+            {
+                Schedule(index, mUpdate);
+            }
+        }
+        mWoken.clear();
+    }
+
+    mDeciding.clear();
+    mDeleteList.clear();
+    std::vector<Entry>& slot = mWheel[mUpdate % mWheel.size()];
+    mDue.clear();
+    mDue.swap(slot);
+    for (size_t i = 0; i < mDue.size(); ++i)
+    {
+        const Entry& entry = mDue[i];
+        const uint32 index = UnitList::GetIndex(entry.mUnitId);
+        // Mind was deleted, woken or rescheduled since
+        if (index >= mMindIds.size() || mMindIds[index] != entry.mUnitId || mNextUpdates[index] != entry.mUpdate)
+        {
+            continue;
+        }
+        if (entry.mUpdate != mUpdate)
+        {
+            // One of the next turns of the wheel
+            slot.push_back(entry);
+        }
+        else if (UnitList::GetUnit(entry.mUnitId))
+        {
+            // Mind rescheduled to an update it already had an entry for has
+            // two entries in the slot, only the first one is taken
+            mNextUpdates[index] = SLEEPING;
+            mDeciding.push_back(index);
+        }
+        else
+        {
+            mDeleteList.push_back(entry.mUnitId);
+        }
+    }
+    std::sort(mDeciding.begin(), mDeciding.end());
+    mActiveCount = mDeciding.size();
+    ++mUpdate;
+
+    mMoves.assign(mDeciding.size(), NULL);
+    mDecidedCommands.resize(mDeciding.size());
+    // Minds drop flow fields only in ApplyMoves, so the users counted here
+    // do not change while minds decide
+    mShared.assign(mDeciding.size(), false);
+    for (size_t i = 0; i < mDeciding.size(); ++i)
+    {
+        const uint32 index = mDeciding[i];
+        mShared[i] = !mFree[index] && mTargets[index] && mMinds[index]->IsShared();
+        mDecidedCommands[i] = mCommands[index];
+    }
+    if (!mPool)
+    {
+        mPool.reset(new WorkerPool(std::max(FLAGS_mind_threads, 0)));
+    }
+    mPool->ParallelFor(mDeciding.size(), boost::bind(&MindList::Decide, aPeriod, _1, _2));
+}
+
+void MindList::Decide(GameTime aPeriod, size_t aBegin, size_t aEnd)
+{
+    for (size_t i = aBegin; i < aEnd; ++i)
+    {
+        const uint32 index = mDeciding[i];
+        if (mFree[index])
+        {
+            mMoves[i] = Mind::DecideFree(mMindIds[index], UnitList::GetPosition(index));
+        }
+        else if (mTargets[index])
+        {
+            mMoves[i] = mMinds[index]->Decide(aPeriod, mShared[i] != 0);
+        }
+    }
+}
+
+void MindList::ApplyMoves()
+{
+    for (size_t i = 0; i < mDeciding.size(); ++i)
+    {
+        ServerUnit* unit = UnitList::GetUnit(mMindIds[mDeciding[i]]);
+        // Command given after minds decided and before moves are applied
+        // makes the move stale, the mind decides again for the new one
+        const bool isCurrent = mCommands[mDeciding[i]] == mDecidedCommands[i];
+        bool isRefused = false;
+        if (isCurrent && unit && mMoves[i])
+        {
+            isRefused = !mMoves[i]->CanEnter();
+            if (!isRefused)
+            {
+                unit->Move(*mMoves[i]);
+            }
+        }
+        if (mMinds[mDeciding[i]])
+        {
+            // Before reschedule, finished command lets the mind sleep
+            mMinds[mDeciding[i]]->ApplyDecision(isCurrent && !isRefused);
+        }
         if (unit)
         {
-            i->second->Update(aPeriod);
+            Reschedule(mDeciding[i]);
         }
         else
         {
-            deleteList.push_back(i->first);
+            mDeleteList.push_back(mMindIds[mDeciding[i]]);
         }
     }
+    mDeciding.clear();
+    mMoves.clear();
+    mDecidedCommands.clear();
+    mShared.clear();
 
-    for (size_t i = 0; i < deleteList.size(); ++i)
+    for (size_t i = 0; i < mDeleteList.size(); ++i)
     {
-        mMinds.erase(deleteList[i]);
+        // Slot may have been given to a new unit meanwhile
+        DeleteMind(mDeleteList[i]);
     }
+    mDeleteList.clear();
 }
 
 Mind* MindList::GetFreeMind()
 {
-    MindListMap::iterator i = mMinds.begin();
-    Mind* freeMind = NULL;
-    while (i != mMinds.end() && freeMind == NULL)
+    for (size_t i = 0; i < mMinds.size(); ++i)
     {
-        Mind* mind = i->second;
-        if (mind->IsFree())
-            freeMind = mind;
-        ++i;
+        if (mMinds[i] && mFree[i])
+        {
+            return mMinds[i];
+        }
     }
-    return freeMind;
+    return NULL;
 }
 
 void MindList::Clear()
 {
+    for (size_t i = 0; i < mMinds.size(); ++i)
+    {
+        delete mMinds[i];
+    }
     mMinds.clear();
+    mMindIds.clear();
+    mFree.clear();
+    mTargets.clear();
+    mCommands.clear();
+    mNextUpdates.clear();
+    mCount = 0;
+    mActiveCount = 0;
+    mUpdate = 0;
+    mWheel.clear();
+    mDue.clear();
+    {
+        boost::lock_guard<boost::mutex> lock(mWokenMutex);
+        mWoken.clear();
+    }
+    {
+        boost::lock_guard<boost::mutex> lock(mPostedMutex);
+        mPosted.clear();
+    }
+    mPostedTaken.clear();
+    mDeciding.clear();
+    mMoves.clear();
+    mDecidedCommands.clear();
+    mShared.clear();
+    mDeleteList.clear();
+    mPool.reset();
 }
-
@@ -1,21 +1,102 @@
 #ifndef MINDLIST_H
 #define MINDLIST_H
 
-#include <boost/ptr_container/ptr_unordered_map.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <gflags/gflags.h>
 #include <Typedefs.h>
 class Mind;
+class ServerTile;
+class WorkerPool;
 
+DECLARE_int32(mind_threads);
+DECLARE_int32(wander_interval);
+
+// Minds by unit slot, see UnitList. Hot mind state is in arrays, so free
+// minds decide without touching their Mind. Minds are kept in a timing
+// wheel by the update they act next, minds with nothing to do sleep
+// until woken and cost nothing
 class MindList
 {
 public:
     static void NewMind(UnitId aUnitId);
+    static void DeleteMind(UnitId aUnitId);
+    static bool HasMind(UnitId aUnitId);
     static void UpdateMinds(GameTime aPeriod);
-    static size_t GetSize() {  return mMinds.size(); }
+    // Minds decide moves in parallel, world must not change meanwhile
+    static void DecideMoves(GameTime aPeriod);
+    // Moves are applied in unit slot order, so result does not depend on
+    // threads. Tile holds any number of units, so minds moving to the same
+    // tile all get there, in slot order. Move to a tile which can not be
+    // entered by then is refused, the mind keeps its command and retries
+    static void ApplyMoves();
+    static size_t GetSize() { return mCount; }
+    // Minds which decided on the last update
+    static size_t GetActiveCount() { return mActiveCount; }
+    // Mind acts on the next update, safe to call from any thread
+    static void Wake(UnitId aUnitId);
+    // Mind of the unit gets the command before the next update decides,
+    // safe to call from any thread. Ignored if the unit has no mind by then
+    static void PostCommand(UnitId aUnitId, ServerTile& aTile);
     static Mind* GetFreeMind();
     static void Clear();
+
+    static bool IsFree(uint32 aIndex) { return mFree[aIndex] != 0; }
+    static void SetFree(uint32 aIndex, bool aValue) { mFree[aIndex] = aValue; ++mCommands[aIndex]; }
+    static ServerTile* GetTarget(uint32 aIndex) { return mTargets[aIndex]; }
+    // Client commands bump the generation, so moves decided before are not applied
+    static void SetTarget(uint32 aIndex, ServerTile* aTile) { mTargets[aIndex] = aTile; ++mCommands[aIndex]; }
 private:
-    typedef boost::ptr_unordered_map<UnitId, Mind> MindListMap;
-    static MindListMap mMinds;
+    static void Decide(GameTime aPeriod, size_t aBegin, size_t aEnd);
+    static void Delete(uint32 aIndex);
+    static void Schedule(uint32 aIndex, uint64 aUpdate);
+    static void Reschedule(uint32 aIndex);
+    // Updates between steps of commanded and of free mind
+    static uint64 GetStep(uint32 aIndex);
+    static uint64 GetWanderPeriod(uint32 aIndex);
+
+    struct Entry
+    {
+        UnitId mUnitId;
+        uint64 mUpdate;
+    };
+    struct Command
+    {
+        UnitId mUnitId;
+        ServerTile* mTile;
+    };
+    static const uint64 SLEEPING = 0xFFFFFFFFFFFFFFFFull;
+
+    static std::vector<Mind*> mMinds;
+    // Unit of mind in slot, 0 if there is none
+    static std::vector<UnitId> mMindIds;
+    static std::vector<uint8> mFree;
+    static std::vector<ServerTile*> mTargets;
+    // Generation of command of mind, changed by SetFree and SetTarget
+    static std::vector<uint32> mCommands;
+    // Update on which mind acts next, SLEEPING if none
+    static std::vector<uint64> mNextUpdates;
+    static size_t mCount;
+    static size_t mActiveCount;
+
+    // Update to decide next, minds acting on update u are in mWheel[u % size]
+    static uint64 mUpdate;
+    static std::vector< std::vector<Entry> > mWheel;
+    static std::vector<Entry> mDue;
+    static std::vector<UnitId> mWoken;
+    static boost::mutex mWokenMutex;
+    static std::vector<Command> mPosted;
+    static std::vector<Command> mPostedTaken;
+    static boost::mutex mPostedMutex;
+    // Slots of minds acting on this update, and tiles they decided to move to
+    static std::vector<uint32> mDeciding;
+    static std::vector<ServerTile*> mMoves;
+    // Generations of commands moves were decided for
+    static std::vector<uint32> mDecidedCommands;
+    // Commanded minds which follow flow field, counted before minds decide
+    static std::vector<uint8> mShared;
+    static std::vector<UnitId> mDeleteList;
+    static boost::scoped_ptr<WorkerPool> mPool;
 };
 
 #endif // MINDLIST_H
@@ -57,6 +57,23 @@ void Network::WriteMessage(const PayloadMsg& aMessage)
     }
 }
 
+void Network::WriteEncoded(const std::string* aMessages, size_t aCount)
+{
+    // Ssl stream makes a record of each buffer, so frames are joined
+    mWriteBuffer.clear();
+    for (size_t i = 0; i < aCount; ++i)
+    {
+        HeaderMsg header;
+        header.set_size(aMessages[i].size());
+        header.AppendToString(&mWriteBuffer);
+        mWriteBuffer.append(aMessages[i]);
+    }
+    if (boost::asio::write(*mSSLStream, boost::asio::buffer(mWriteBuffer)) != mWriteBuffer.size())
+    {
+        boost::throw_exception(std::runtime_error("Неудалось записать в сокет сообщение!"));
+    }
+}
+
 void Network::ReadMessage(PayloadMsg& aMessage)
 {
     if (boost::asio::read(*mSSLStream, boost::asio::buffer(mHeaderBuffer, mHeaderSize)) != mHeaderSize)
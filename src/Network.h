@@ -12,14 +12,18 @@ public:
     Network(SSLStreamPtr aSocket);
     ~Network();
     virtual void WriteMessage(const PayloadMsg& aMessage);
+    virtual void WriteEncoded(const std::string* aMessages, size_t aCount);
     virtual void ReadMessage(PayloadMsg& aMessage);
 private:
     void AllocBuffer(int aSize);
+
     SSLStreamPtr mSSLStream;
     char* mMessageBuffer;
     char mHeaderBuffer[HEADER_BUFFER_SIZE];
     size_t mHeaderSize;
     int mBufferSize;
+    // Headers and messages of encoded write one after another
+    std::string mWriteBuffer;
 };
 
 #endif // NETWORK_H_INCLUDED
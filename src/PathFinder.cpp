@@ -0,0 +1,380 @@
+#include <pch.h>
+
+#include <PathFinder.h>
+
+struct PathFinder::Scratch
+{
+    Scratch(): mGeneration(0) {}
+
+    void Prepare(size_t aSize)
+    {
+        if (mVisited.size() != aSize)
+        {
+            mVisited.assign(aSize, 0);
+            mCost.resize(aSize);
+            mParent.resize(aSize);
+            mGeneration = 0;
+        }
+        ++mGeneration;
+        if (mGeneration == 0)
+        {
+            std::fill(mVisited.begin(), mVisited.end(), 0);
+            mGeneration = 1;
+        }
+        mOpen.clear();
+    }
+
+    struct Node
+    {
+        Node(float aEstimate, float aCost, TileId aTile): mEstimate(aEstimate), mCost(aCost), mTile(aTile) {}
+        // Heap keeps the greatest on top, so the best node has to be the greatest
+        bool operator<(const Node& aOther) const
+        {
+            if (mEstimate != aOther.mEstimate)
+            {
+                return mEstimate > aOther.mEstimate;
+            }
+            if (mCost != aOther.mCost)
+            {
+                return mCost < aOther.mCost;
+            }
+            return mTile > aOther.mTile;
+        }
+        float mEstimate;
+        float mCost;
+        TileId mTile;
+    };
+
+    std::vector<uint32> mVisited;
+    std::vector<float> mCost;
+    std::vector<TileId> mParent;
+    std::vector<Node> mOpen;
+    uint32 mGeneration;
+};
+
+struct PathFinder::Scratches
+{
+    Scratch mTiles;
+    Scratch mRegions;
+    std::vector<uint32> mCorridor;
+    uint32 mCorridorStamp;
+};
+
+struct PathFinder::Corridor
+{
+    const std::vector<uint32>* mMarks;
+    uint32 mStamp;
+};
+
+const ServerGeodesicGrid::Tiles* PathFinder::mTiles = NULL;
+const TileAdjacency* PathFinder::mAdjacency = NULL;
+std::vector<Ogre::Vector3> PathFinder::mDirections;
+float PathFinder::mMaxStepAngle = 1.0f;
+std::vector<TileId> PathFinder::mRegions;
+std::vector<Ogre::Vector3> PathFinder::mRegionDirections;
+TileAdjacency PathFinder::mRegionLinks;
+std::vector<float> PathFinder::mRegionLinkSteps;
+TileAdjacency PathFinder::mRegionGraph;
+std::vector<float> PathFinder::mRegionEdgeCosts;
+boost::atomic<uint32> PathFinder::mRegionGraphVersion(0);
+boost::shared_mutex PathFinder::mRegionGraphMutex;
+boost::thread_specific_ptr<PathFinder::Scratches> PathFinder::mScratches;
+
+namespace
+{
+    float CalcAngle(const Ogre::Vector3& a, const Ogre::Vector3& b)
+    {
+        return acos(Ogre::Math::Clamp(a.dotProduct(b), Ogre::Real(-1), Ogre::Real(1)));
+    }
+}
+
+void PathFinder::Init(const ServerGeodesicGrid::Tiles& aTiles, const TileAdjacency& aAdjacency, int32 aSize)
+{
+    boost::lock_guard<boost::shared_mutex> lock(mRegionGraphMutex);
+    mTiles = &aTiles;
+    mAdjacency = &aAdjacency;
+
+    mDirections.resize(aTiles.size());
+    for (TileId i = 0; i < aTiles.size(); ++i)
+    {
+        mDirections[i] = aTiles[i]->GetPosition().normalisedCopy();
+    }
+    mMaxStepAngle = 0;
+    for (TileId i = 0; i < aTiles.size(); ++i)
+    {
+        for (uint32 n = 0; n < aAdjacency.GetNeighbourCount(i); ++n)
+        {
+            mMaxStepAngle = std::max(mMaxStepAngle, CalcAngle(mDirections[i], mDirections[aAdjacency.GetNeighbour(i, n)]));
+        }
+    }
+
+    // Tiles of grid subdivided 3 times less, about 64 tiles per region
+    const int32 level = std::max(aSize + 1 - 3, 0);
+    const TileId regionCount = std::min<size_t>(10 * (1u << (2 * level)) + 2, aTiles.size());
+    mRegionDirections.assign(mDirections.begin(), mDirections.begin() + regionCount);
+
+    // Each tile belongs to the region reached first by breadth first search from all region tiles
+    const TileId none = std::numeric_limits<TileId>::max();
+    mRegions.assign(aTiles.size(), none);
+    std::vector<TileId> queue;
+    queue.reserve(aTiles.size());
+    for (TileId i = 0; i < regionCount; ++i)
+    {
+        mRegions[i] = i;
+        queue.push_back(i);
+    }
+    for (size_t q = 0; q < queue.size(); ++q)
+    {
+        const TileId tile = queue[q];
+        for (uint32 n = 0; n < aAdjacency.GetNeighbourCount(tile); ++n)
+        {
+            const TileId neighbour = aAdjacency.GetNeighbour(tile, n);
+            if (mRegions[neighbour] == none)
+            {
+                mRegions[neighbour] = mRegions[tile];
+                queue.push_back(neighbour);
+            }
+        }
+    }
+
+    LinkRegions();
+    UpdateRegionGraph();
+}
+
+void PathFinder::LinkRegions()
+{
+    const TileId regionCount = mRegionDirections.size();
+    std::vector< std::vector<TileId> > links(regionCount);
+    for (TileId i = 0; i < mTiles->size(); ++i)
+    {
+        for (uint32 n = 0; n < mAdjacency->GetNeighbourCount(i); ++n)
+        {
+            const TileId neighbour = mAdjacency->GetNeighbour(i, n);
+            if (mRegions[i] != mRegions[neighbour])
+            {
+                links[mRegions[i]].push_back(mRegions[neighbour]);
+            }
+        }
+    }
+
+    // Steps between region tiles, so that costs of both searches are comparable
+    std::vector<int32> steps(mTiles->size(), -1);
+    std::vector<TileId> queue;
+    mRegionLinks.Clear();
+    mRegionLinkSteps.clear();
+    for (TileId r = 0; r < regionCount; ++r)
+    {
+        std::vector<TileId>& neighbours = links[r];
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+        mRegionLinks.AddTile(neighbours.empty() ? NULL : &neighbours[0], neighbours.empty() ? NULL : &neighbours[0] + neighbours.size());
+
+        queue.assign(1, r);
+        steps[r] = 0;
+        size_t found = 0;
+        for (size_t q = 0; q < queue.size() && found < neighbours.size(); ++q)
+        {
+            const TileId tile = queue[q];
+            for (uint32 n = 0; n < mAdjacency->GetNeighbourCount(tile); ++n)
+            {
+                const TileId neighbour = mAdjacency->GetNeighbour(tile, n);
+                if (steps[neighbour] < 0)
+                {
+                    steps[neighbour] = steps[tile] + 1;
+                    queue.push_back(neighbour);
+                    found += std::binary_search(neighbours.begin(), neighbours.end(), neighbour);
+                }
+            }
+        }
+        for (size_t n = 0; n < neighbours.size(); ++n)
+        {
+            mRegionLinkSteps.push_back(steps[neighbours[n]]);
+        }
+        for (size_t q = 0; q < queue.size(); ++q)
+        {
+            steps[queue[q]] = -1;
+        }
+    }
+}
+
+void PathFinder::Clear()
+{
+    boost::lock_guard<boost::shared_mutex> lock(mRegionGraphMutex);
+    mTiles = NULL;
+    mAdjacency = NULL;
+    std::vector<Ogre::Vector3>().swap(mDirections);
+    std::vector<TileId>().swap(mRegions);
+    std::vector<Ogre::Vector3>().swap(mRegionDirections);
+    std::vector<float>().swap(mRegionLinkSteps);
+    std::vector<float>().swap(mRegionEdgeCosts);
+    mRegionLinks.Clear();
+    mRegionGraph.Clear();
+    mScratches.reset();
+}
+
+void PathFinder::UpdateRegionGraph()
+{
+    // Regions are linked where tiles which can be entered touch each other
+    std::vector< std::vector<TileId> > links(mRegionDirections.size());
+    for (TileId i = 0; i < mTiles->size(); ++i)
+    {
+        if (!(*mTiles)[i]->CanEnter())
+        {
+            continue;
+        }
+        for (uint32 n = 0; n < mAdjacency->GetNeighbourCount(i); ++n)
+        {
+            const TileId neighbour = mAdjacency->GetNeighbour(i, n);
+            if (mRegions[i] != mRegions[neighbour] && (*mTiles)[neighbour]->CanEnter())
+            {
+                links[mRegions[i]].push_back(mRegions[neighbour]);
+            }
+        }
+    }
+
+    mRegionGraph.Clear();
+    mRegionEdgeCosts.clear();
+    for (TileId r = 0; r < links.size(); ++r)
+    {
+        std::vector<TileId>& neighbours = links[r];
+        std::sort(neighbours.begin(), neighbours.end());
+        neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+        const TileId* linksBegin = mRegionLinks.GetNeighbours(r);
+        const TileId* linksEnd = linksBegin + mRegionLinks.GetNeighbourCount(r);
+        for (size_t n = 0; n < neighbours.size(); ++n)
+        {
+            const size_t link = std::lower_bound(linksBegin, linksEnd, neighbours[n]) - mRegionLinks.GetNeighbours(0);
+            mRegionEdgeCosts.push_back(mRegionLinkSteps[link]);
+        }
+        mRegionGraph.AddTile(neighbours.empty() ? NULL : &neighbours[0], neighbours.empty() ? NULL : &neighbours[0] + neighbours.size());
+    }
+    mRegionGraphVersion = ServerTile::GetTerrainVersion();
+}
+
+bool PathFinder::FindPath(TileId aFrom, TileId aTo, Path& aPath)
+{
+    aPath.clear();
+    if (aFrom == aTo)
+    {
+        return true;
+    }
+    if (!(*mTiles)[aTo]->CanEnter())
+    {
+        return false;
+    }
+
+    if (mRegionGraphVersion != ServerTile::GetTerrainVersion())
+    {
+        boost::lock_guard<boost::shared_mutex> lock(mRegionGraphMutex);
+        if (mRegionGraphVersion != ServerTile::GetTerrainVersion())
+        {
+            UpdateRegionGraph();
+        }
+    }
+    boost::shared_lock<boost::shared_mutex> lock(mRegionGraphMutex);
+
+    if (!mScratches.get())
+    {
+        mScratches.reset(new Scratches());
+        mScratches->mCorridorStamp = 0;
+    }
+    Scratches& scratches = *mScratches;
+
+    const TileId fromRegion = mRegions[aFrom];
+    const TileId toRegion = mRegions[aTo];
+    if (fromRegion != toRegion)
+    {
+        Path regions;
+        if (!Search(mRegionGraph, mRegionDirections, &mRegionEdgeCosts, NULL, scratches.mRegions, fromRegion, toRegion, regions))
+        {
+            return false;
+        }
+
+        // Found regions and their neighbours, so that path can cut corners
+        if (scratches.mCorridor.size() != mRegionDirections.size() || ++scratches.mCorridorStamp == 0)
+        {
+            scratches.mCorridor.assign(mRegionDirections.size(), 0);
+            scratches.mCorridorStamp = 1;
+        }
+        regions.push_back(fromRegion);
+        for (size_t i = 0; i < regions.size(); ++i)
+        {
+            scratches.mCorridor[regions[i]] = scratches.mCorridorStamp;
+            for (uint32 n = 0; n < mRegionGraph.GetNeighbourCount(regions[i]); ++n)
+            {
+                scratches.mCorridor[mRegionGraph.GetNeighbour(regions[i], n)] = scratches.mCorridorStamp;
+            }
+        }
+        Corridor corridor = { &scratches.mCorridor, scratches.mCorridorStamp };
+        if (Search(*mAdjacency, mDirections, NULL, &corridor, scratches.mTiles, aFrom, aTo, aPath))
+        {
+            return true;
+        }
+    }
+
+    // Same region, or regions are connected through tiles unreachable from each other
+    return Search(*mAdjacency, mDirections, NULL, NULL, scratches.mTiles, aFrom, aTo, aPath);
+}
+
+bool PathFinder::IsAllowed(const Corridor* aCorridor, TileId aTile)
+{
+    return !aCorridor || (*aCorridor->mMarks)[mRegions[aTile]] == aCorridor->mStamp;
+}
+
+bool PathFinder::Search(const TileAdjacency& aGraph, const std::vector<Ogre::Vector3>& aDirections, const std::vector<float>* aEdgeCosts,
+                        const Corridor* aCorridor, Scratch& aScratch, TileId aFrom, TileId aTo, Path& aPath)
+{
+    // Tiles are checked for terrain, regions are linked only through tiles units can enter
+    const bool checkTerrain = aEdgeCosts == NULL;
+    const Ogre::Vector3& target = aDirections[aTo];
+    aScratch.Prepare(aGraph.GetTileCount());
+    std::vector<Scratch::Node>& open = aScratch.mOpen;
+
+    aScratch.mVisited[aFrom] = aScratch.mGeneration;
+    aScratch.mCost[aFrom] = 0;
+    aScratch.mParent[aFrom] = aFrom;
+    open.push_back(Scratch::Node(CalcAngle(aDirections[aFrom], target) / mMaxStepAngle, 0, aFrom));
+
+    while (!open.empty())
+    {
+        std::pop_heap(open.begin(), open.end());
+        const Scratch::Node node = open.back();
+        open.pop_back();
+        if (node.mCost > aScratch.mCost[node.mTile])
+        {
+            continue;
+        }
+
+        if (node.mTile == aTo)
+        {
+            aPath.clear();
+            for (TileId tile = aTo; tile != aFrom; tile = aScratch.mParent[tile])
+            {
+                aPath.push_back(tile);
+            }
+            return true;
+        }
+
+        const TileId* neighbours = aGraph.GetNeighbours(node.mTile);
+        const uint32 count = aGraph.GetNeighbourCount(node.mTile);
+        const uint32 offset = aGraph.GetOffsets()[node.mTile];
+        for (uint32 n = 0; n < count; ++n)
+        {
+            const TileId neighbour = neighbours[n];
+            if ((checkTerrain && !(*mTiles)[neighbour]->CanEnter()) || !IsAllowed(aCorridor, neighbour))
+            {
+                continue;
+            }
+            const float cost = node.mCost + (aEdgeCosts ? (*aEdgeCosts)[offset + n] : 1.0f);
+            if (aScratch.mVisited[neighbour] != aScratch.mGeneration || cost < aScratch.mCost[neighbour])
+            {
+                aScratch.mVisited[neighbour] = aScratch.mGeneration;
+                aScratch.mCost[neighbour] = cost;
+                aScratch.mParent[neighbour] = node.mTile;
+                open.push_back(Scratch::Node(cost + CalcAngle(aDirections[neighbour], target) / mMaxStepAngle, cost, neighbour));
+                std::push_heap(open.begin(), open.end());
+            }
+        }
+    }
+    return false;
+}
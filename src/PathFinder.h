@@ -0,0 +1,56 @@
+#ifndef PATHFINDER_H
+#define PATHFINDER_H
+
+#include <Typedefs.h>
+#include <ServerGeodesicGrid.h>
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/tss.hpp>
+#include <boost/atomic.hpp>
+
+// A* over tiles which units can enter. Long paths are first found over
+// regions around tiles of a lower subdivision level, ids below the tile
+// count of that level, and fine search is kept inside found regions and
+// their neighbours, so long paths may be a bit longer than the shortest
+class PathFinder
+{
+public:
+    // Tiles from the target back to the next step, the next step is at the back
+    typedef std::vector<TileId> Path;
+
+    static void Init(const ServerGeodesicGrid::Tiles& aTiles, const TileAdjacency& aAdjacency, int32 aSize);
+    static void Clear();
+    static bool FindPath(TileId aFrom, TileId aTo, Path& aPath);
+    static TileId GetRegion(TileId aTile) { return mRegions[aTile]; }
+private:
+    struct Scratch;
+    struct Scratches;
+    struct Corridor;
+
+    static void LinkRegions();
+    static void UpdateRegionGraph();
+    // Costs are in steps, without aEdgeCosts every step costs 1
+    static bool Search(const TileAdjacency& aGraph, const std::vector<Ogre::Vector3>& aDirections, const std::vector<float>* aEdgeCosts,
+                       const Corridor* aCorridor, Scratch& aScratch, TileId aFrom, TileId aTo, Path& aPath);
+    static bool IsAllowed(const Corridor* aCorridor, TileId aTile);
+
+    static const ServerGeodesicGrid::Tiles* mTiles;
+    static const TileAdjacency* mAdjacency;
+    static std::vector<Ogre::Vector3> mDirections;
+    static float mMaxStepAngle;
+
+    // Tile of the coarse level every tile belongs to
+    static std::vector<TileId> mRegions;
+    static std::vector<Ogre::Vector3> mRegionDirections;
+    // Neighbour regions regardless of terrain, with steps between their tiles
+    static TileAdjacency mRegionLinks;
+    static std::vector<float> mRegionLinkSteps;
+    static TileAdjacency mRegionGraph;
+    static std::vector<float> mRegionEdgeCosts;
+    // Checked without the mutex before the search takes it
+    static boost::atomic<uint32> mRegionGraphVersion;
+    static boost::shared_mutex mRegionGraphMutex;
+
+    static boost::thread_specific_ptr<Scratches> mScratches;
+};
+
+#endif // PATHFINDER_H
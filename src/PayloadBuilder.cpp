@@ -0,0 +1,56 @@
+#include <pch.h>
+#include <PayloadBuilder.h>
+
+DEFINE_int32(max_payload_size, 16000, "Maximum size in bytes of one message of update, one change is never split");
+
+PayloadBuilder::PayloadBuilder(INetwork& aNetwork, size_t aMaxSize):
+    mNetwork(aNetwork), mMaxSize(aMaxSize), mMessages(1), mCount(0)
+{
+    PayloadMsg last;
+    last.set_last(false);
+    last.SerializeToString(&mLast);
+}
+
+void PayloadBuilder::Add(const ChangeMsg& aChange)
+{
+    mScratch.Clear();
+    mScratch.add_changes()->CopyFrom(aChange);
+    mScratch.SerializeToString(&mEncoded);
+    AddEncoded(mEncoded.data(), mEncoded.size());
+}
+
+void PayloadBuilder::AddEncoded(const char* aChange, size_t aSize)
+{
+    std::string& message = mMessages[mCount];
+    if (!message.empty() && message.size() + aSize + mLast.size() > mMaxSize)
+    {
+        Close();
+    }
+    // Changes go before last as fields are serialized by their numbers
+    mMessages[mCount].append(aChange, aSize);
+}
+
+void PayloadBuilder::Close()
+{
+    mMessages[mCount].append(mLast);
+    ++mCount;
+    if (mCount == mMessages.size())
+    {
+        mMessages.push_back(std::string());
+    }
+    mMessages[mCount].clear();
+}
+
+void PayloadBuilder::Flush()
+{
+    if (!mMessages[mCount].empty())
+    {
+        Close();
+    }
+    if (mCount > 0)
+    {
+        mNetwork.WriteEncoded(&mMessages[0], mCount);
+        mCount = 0;
+        mMessages[0].clear();
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef PAYLOADBUILDER_H
+#define PAYLOADBUILDER_H
+
+#include <Typedefs.h>
+#include <INetwork.h>
+#include <boost/noncopyable.hpp>
+#include <gflags/gflags.h>
+
+DECLARE_int32(max_payload_size);
+
+// Gathers changes of a response into messages of limited size, all with
+// last unset, and writes them to network at once on flush
+class PayloadBuilder: public boost::noncopyable
+{
+public:
+    PayloadBuilder(INetwork& aNetwork, size_t aMaxSize);
+    void Add(const ChangeMsg& aChange);
+    // Changes element of already serialized PayloadMsg
+    void AddEncoded(const char* aChange, size_t aSize);
+    void Flush();
+private:
+    void Close();
+
+    INetwork& mNetwork;
+    const size_t mMaxSize;
+    // Serialized last = false
+    std::string mLast;
+    // Strings are kept to reuse their memory, first mCount are complete
+    std::vector<std::string> mMessages;
+    size_t mCount;
+    PayloadMsg mScratch;
+    std::string mEncoded;
+};
+
+#endif // PAYLOADBUILDER_H
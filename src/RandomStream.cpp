@@ -0,0 +1,69 @@
+#include <pch.h>
+
+#include <RandomStream.h>
+
+DEFINE_int32(world_seed, 1, "Seed of terrain, population and unit decisions, same seed gives the same game");
+
+namespace
+{
+    const uint32 PHILOX_M0 = 0xD2511F53u;
+    const uint32 PHILOX_M1 = 0xCD9E8D57u;
+    const uint32 PHILOX_W0 = 0x9E3779B9u;
+    const uint32 PHILOX_W1 = 0xBB67AE85u;
+}
+
+void RandomStream::Philox(const uint32 aCounter[4], const uint32 aKey[2], uint32 aResult[4])
+{
+    uint32 c0 = aCounter[0];
+    uint32 c1 = aCounter[1];
+    uint32 c2 = aCounter[2];
+    uint32 c3 = aCounter[3];
+    uint32 k0 = aKey[0];
+    uint32 k1 = aKey[1];
+    for (int32 round = 0; round < 10; ++round)
+    {
+        const uint64 p0 = static_cast<uint64>(PHILOX_M0) * c0;
+        const uint64 p1 = static_cast<uint64>(PHILOX_M1) * c2;
+        const uint32 hi0 = static_cast<uint32>(p0 >> 32);
+        const uint32 lo0 = static_cast<uint32>(p0);
+        const uint32 hi1 = static_cast<uint32>(p1 >> 32);
+        const uint32 lo1 = static_cast<uint32>(p1);
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    aResult[0] = c0;
+    aResult[1] = c1;
+    aResult[2] = c2;
+    aResult[3] = c3;
+}
+
+RandomStream::RandomStream(uint32 aSeed, uint32 aStream, Purpose aPurpose, GameTime aTick): mUsed(4)
+{
+    mKey[0] = aSeed;
+    mKey[1] = aStream;
+    mCounter[0] = static_cast<uint32>(aTick);
+    mCounter[1] = static_cast<uint32>(aTick >> 32);
+    mCounter[2] = aPurpose;
+    mCounter[3] = 0;
+}
+
+uint32 RandomStream::Next()
+{
+    if (mUsed == 4)
+    {
+        Philox(mCounter, mKey, mBlock);
+        ++mCounter[3];
+        mUsed = 0;
+    }
+    return mBlock[mUsed++];
+}
+
+uint32 RandomStream::Next(uint32 aBound)
+{
+    // Multiply and shift instead of modulo, bias is below 2^-32 * aBound
+    return static_cast<uint32>((static_cast<uint64>(Next()) * aBound) >> 32);
+}
@@ -0,0 +1,35 @@
+#ifndef RANDOMSTREAM_H
+#define RANDOMSTREAM_H
+
+#include <Typedefs.h>
+#include <gflags/gflags.h>
+
+DECLARE_int32(world_seed);
+
+// Philox4x32-10 counter based generator. Numbers depend only on the key
+// (seed, stream) and the counter (tick, purpose, draw), so any unit can
+// draw its own numbers on any thread and a run can be replayed exactly
+class RandomStream
+{
+public:
+    // What numbers are drawn for, streams of different purposes do not overlap
+    enum Purpose
+    {
+        MIND_MOVE = 1,
+        POPULATION = 2
+    };
+
+    RandomStream(uint32 aSeed, uint32 aStream, Purpose aPurpose, GameTime aTick);
+    uint32 Next();
+    // Uniform in [0, aBound)
+    uint32 Next(uint32 aBound);
+
+    static void Philox(const uint32 aCounter[4], const uint32 aKey[2], uint32 aResult[4]);
+private:
+    uint32 mKey[2];
+    uint32 mCounter[4];
+    uint32 mBlock[4];
+    uint32 mUsed;
+};
+
+#endif // RANDOMSTREAM_H
@@ -0,0 +1,43 @@
+#include <pch.h>
+#include <SendPolicy.h>
+
+DEFINE_int32(send_queue_size, 1 << 20, "Bytes queued for subscribed client above which its updates are dropped");
+DEFINE_string(slow_client_policy, "resync", "Client which keeps its send queue full: resync or disconnect");
+DEFINE_int32(slow_client_grace, 10000, "Milliseconds client may drop updates before it is disconnected");
+
+bool SendPolicy::ShouldDrop(size_t aQueued, bool aWriting) const
+{
+    // Full update waits for the queue to drain
+    return aWriting && (mResync || aQueued >= static_cast<size_t>(std::max(FLAGS_send_queue_size, 0)));
+}
+
+bool SendPolicy::IsOverBudget(size_t aQueued, bool aWriting) const
+{
+    return aWriting && aQueued > static_cast<size_t>(std::max(FLAGS_send_queue_size, 0));
+}
+
+bool SendPolicy::ShouldDisconnect(Miliseconds aNow) const
+{
+    return IsCongested() && FLAGS_slow_client_policy == "disconnect" &&
+        aNow - mCongestedSince >= FLAGS_slow_client_grace;
+}
+
+void SendPolicy::Dropped(Miliseconds aNow)
+{
+    // Field of view may have changed with the dropped update, so the next one is full
+    mResync = true;
+    if (mCongestedSince == 0)
+    {
+        // Never 0, so congestion is not lost at clock start
+        mCongestedSince = std::max<Miliseconds>(aNow, 1);
+    }
+}
+
+void SendPolicy::Drained()
+{
+    // Drain which lets the full update go does not show client keeps up
+    if (!mResync)
+    {
+        mCongestedSince = 0;
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef SENDPOLICY_H
+#define SENDPOLICY_H
+
+#include <Typedefs.h>
+#include <gflags/gflags.h>
+
+DECLARE_int32(send_queue_size);
+DECLARE_string(slow_client_policy);
+DECLARE_int32(slow_client_grace);
+
+// Decides what happens to updates pushed to a subscribed client. Update is
+// dropped while a write is in flight and the queue is over its budget, the
+// next one is full. Client is congested from the first drop until the queue
+// drains with no full update pending, so client which drops again before
+// it catches up stays congested and may be disconnected
+class SendPolicy
+{
+public:
+    SendPolicy(): mResync(false), mCongestedSince(0) {}
+
+    // aQueued is bytes being written and queued
+    bool ShouldDrop(size_t aQueued, bool aWriting) const;
+    // Checked after update was written to the queue
+    bool IsOverBudget(size_t aQueued, bool aWriting) const;
+    bool ShouldDisconnect(Miliseconds aNow) const;
+    void Dropped(Miliseconds aNow);
+    // Update was queued or sent right away
+    void Sent() { mResync = false; }
+    // Nothing is being written or queued
+    void Drained();
+    // Full update replaces updates client missed
+    bool IsResync() const { return mResync; }
+    bool IsCongested() const { return mCongestedSince != 0; }
+private:
+    bool mResync;
+    // Time of the first drop, 0 if not congested
+    Miliseconds mCongestedSince;
+};
+
+#endif // SENDPOLICY_H
@@ -7,6 +7,7 @@
 #include <ReleaseVersion.h>
 #include <ProtocolVersion.h>
 #include <ConnectionManager.h>
+#include <ClientConnection.h>
 
 #ifndef _XOPEN_SOURCE_EXTENDED
 # define _XOPEN_SOURCE_EXTENDED 1
@@ -24,6 +25,7 @@ void GameLoop(ServerGame& aGame)
     while (true)
     {
         aGame.Update();
+        ClientConnection::PushUpdates();
     }
 }
 
@@ -1,9 +0,0 @@
-#ifndef SERVEREDGE_H
-#define SERVEREDGE_H
-
-#include<Edge.h>
-#include<ServerTile.h>
-
-typedef Edge<ServerTile> ServerEdge;
-
-#endif // SERVEREDGE_H
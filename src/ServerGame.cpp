@@ -8,6 +8,12 @@
 #include <UnitList.h>
 #include <UnitListIterator.h>
 #include <MindList.h>
+#include <PathFinder.h>
+#include <TerrainGenerator.h>
+#include <RandomStream.h>
+#include <FlowField.h>
+#include <Lifecycle.h>
+#include <UserList.h>
 
 DEFINE_int32(update_length, 1000, "Time in milliseconds between game updates");
 DEFINE_int32(time_step, 1, "Amount on which time advance on each update");
@@ -19,60 +25,50 @@ GameTime ServerGame::GetTime()
     return mTime;
 }
 
-void SpreadHeight(ServerTile& aTile, int32 aHeight)
-{
-    if (aTile.GetHeight() > 0 || aHeight <= 1)
-    {
-        return;
-    }
-
-    aTile.SetHeight(rand() % aHeight);
-
-    for (size_t i = 0; i < aTile.GetNeighbourCount(); ++i)
-    {
-        SpreadHeight(aTile.GetNeighbour(i), aHeight * 0.5);
-    }
-}
-
-
-ServerGame::ServerGame(int aSize):mSize(aSize),
+ServerGame::ServerGame(int aSize):mGrid(mTiles, aSize), mRings(mGrid.GetAdjacency(), FLAGS_ring_cache_size), mSize(aSize),
     mGrass(VC::LIVE | VC::PLANT, 100, 0),
     mZebra(VC::LIVE | VC::ANIMAL | VC::HERBIVORES, 500, 1),
     mAvatar(VC::LIVE | VC::ANIMAL | VC::HUMAN, 999999, 1),
     mTimer(FLAGS_update_length)
 {
-    // Create map
-    ServerGeodesicGrid grid(mTiles, aSize);
     LOG(INFO) << "Size " << aSize << " Tile count " << mTiles.size();
-    LOG(INFO) << "Tile radius " << grid.GetTileRadius();
+    LOG(INFO) << "Tile radius " << mGrid.GetTileRadius();
 
     // Generate height
-    SpreadHeight(*mTiles.at(2), 10000);
-    SpreadHeight(*mTiles.at(4), 5000);
+    TerrainGenerator(FLAGS_world_seed).Generate(mTiles, mGrid.GetAdjacency(), std::max(FLAGS_terrain_threads, 0));
+    PathFinder::Init(mTiles, mGrid.GetAdjacency(), aSize);
+    FlowFieldList::Init(mTiles, mGrid.GetAdjacency());
 
     // Populate
+    UnitList::Init(FLAGS_unit_index_bits);
     for (size_t i = 0; i < mTiles.size(); ++i)
     {
         ServerTile& tile = *mTiles.at(i);
         if (tile.GetWater() <= 0)
         {
-            switch (rand() % 10)
+            RandomStream random(FLAGS_world_seed, tile.GetTileId(), RandomStream::POPULATION, 0);
+            // Units start at different ages, so they do not all die on one turn
+            switch (random.Next(10))
             {
             case 1:
-                UnitList::NewUnit(tile, mZebra);
+                Lifecycle::Schedule(UnitList::NewUnit(tile, mZebra).GetUnitId(), random.Next(mZebra.GetMaxAge()));
                 break;
             case 6:
-                UnitList::NewUnit(tile, mGrass);
+                Lifecycle::Schedule(UnitList::NewUnit(tile, mGrass).GetUnitId(), random.Next(mGrass.GetMaxAge()));
                 break;
             }
         }
     }
+    PublishSnapshot();
 
 }
 
 ServerGame::~ServerGame()
 {
+    ClearUsers();
     UnitList::Clear();
+    PathFinder::Clear();
+    FlowFieldList::Clear();
     for (size_t i = 0; i < mTiles.size(); ++i)
     {
         delete mTiles[i];
@@ -82,17 +78,53 @@ ServerGame::~ServerGame()
 
 void ServerGame::Update()
 {
+    if (mUpdateThread == boost::thread::id())
+    {
+        mUpdateThread = boost::this_thread::get_id();
+    }
+    assert(mUpdateThread == boost::this_thread::get_id());
     mTimer.Wait();
 
-    boost::lock_guard<boost::shared_mutex> cs(mGameMutex);
-
-    MindList::UpdateMinds(FLAGS_time_step);
+    {
+        // Minds only read the world while they decide, clients post commands
+        // to MindList and do not take the lock
+        boost::shared_lock<boost::shared_mutex> rl(mGameMutex);
+        MindList::DecideMoves(FLAGS_time_step);
+    }
 
-    mTime += FLAGS_time_step;
-    for (ServerGeodesicGrid::Tiles::const_iterator i = mTiles.begin(); i != mTiles.end(); ++i)
     {
-        (*i)->GetChangeList()->Commit();
+        boost::lock_guard<boost::shared_mutex> cs(mGameMutex);
+
+        MindList::ApplyMoves();
+
+        mTime += FLAGS_time_step;
+        Lifecycle::Advance(mTime);
+        // Each unit which died of age is followed by a newborn, so population stays
+        const std::vector<Lifecycle::Death>& died = Lifecycle::GetDied();
+        for (size_t i = 0; i < died.size(); ++i)
+        {
+            UnitList::NewUnit(*died[i].mTile, *died[i].mClass);
+        }
+        ChangeList::CommitTurn();
     }
+
+    // Outside of the lock, commands of clients do not wait for the snapshot
+    PublishSnapshot();
+}
+
+void ServerGame::PublishSnapshot()
+{
+    assert(mUpdateThread == boost::thread::id() || mUpdateThread == boost::this_thread::get_id());
+    // Only this thread replaces the snapshot, so it reads it without mutex
+    WorldSnapshotPtr snapshot(new WorldSnapshot(mTiles, mSnapshot.get(), mTime));
+    boost::lock_guard<boost::mutex> lock(mSnapshotMutex);
+    mSnapshot.swap(snapshot);
+}
+
+WorldSnapshotPtr ServerGame::GetSnapshot()
+{
+    boost::lock_guard<boost::mutex> lock(mSnapshotMutex);
+    return mSnapshot;
 }
 
 
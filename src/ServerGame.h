@@ -3,11 +3,14 @@
 
 #include <Typedefs.h>
 #include <ServerGeodesicGrid.h>
+#include <KRingCache.h>
 #include <ServerUnit.h>
 #include <Payload.pb.h>
 #include <boost/thread.hpp>
 #include <UpdateTimer.h>
+#include <WorldSnapshot.h>
 
+DECLARE_int32(update_length);
 DECLARE_int32(time_step);
 
 class ServerGame: public boost::noncopyable
@@ -19,11 +22,20 @@ public:
     static GameTime GetTime();
 	Miliseconds GetUpdateLength() { return mTimer.GetLeft(); }
 	const ServerGeodesicGrid::Tiles& GetTiles() const { return mTiles; }
+	const ServerGeodesicGrid& GetGrid() const { return mGrid; }
+	KRingCache& GetRings() { return mRings; }
 	int32 GetSize() const { return mSize; }
 	boost::shared_mutex& GetGameMutex() { return mGameMutex; }
+	// State of the world after the last update, readable without game lock
+	WorldSnapshotPtr GetSnapshot();
     void Update();
 private:
+    // Game lock is not held. Tiles, units and turns are changed only by the
+    // constructor and then by the thread running Update, and only they call it
+    void PublishSnapshot();
     ServerGeodesicGrid::Tiles mTiles;
+    ServerGeodesicGrid mGrid;
+    KRingCache mRings;
     int32 mSize;
     static GameTime mTime;
     UnitClass mGrass;
@@ -31,6 +43,10 @@ private:
     UnitClass mAvatar;
     boost::shared_mutex mGameMutex;
 	UpdateTimer mTimer;
+	WorldSnapshotPtr mSnapshot;
+	boost::mutex mSnapshotMutex;
+	// Thread running Update, not a thread before the first update
+	boost::thread::id mUpdateThread;
 };
 
 #endif // SERVERGAME_H
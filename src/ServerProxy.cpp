@@ -5,8 +5,11 @@
 
 #include <HighResolutionClock.h>
 
+DEFINE_int32(ack_interval, 2, "Pushed updates acknowledged at once, should be below push_window of server");
+
 ServerProxy::ServerProxy(SSLStreamPtr aSSLStream): mSSLStream(aSSLStream), mMessageBuffer(NULL),
-mBufferSize(0), mAsync(false), mRequests(100), mInBytes(0), mOutBytes(0), mRequestTime(0), mPing(0)
+mBufferSize(0), mAsync(false), mSubscribing(false), mSubscribed(false), mUnacked(0),
+mRequests(100), mInBytes(0), mOutBytes(0), mRequestTime(0), mPing(0)
 {
     HeaderMsg header;
     header.set_size(0);
@@ -50,32 +53,73 @@ void ServerProxy::Request(ResponseCallBack aCallBack, PayloadPtr aPayloadMsg)
     }
 }
 
+void ServerProxy::Subscribe(ResponseCallBack aCallBack, GameTime aTime)
+{
+    PayloadPtr req(new PayloadMsg());
+    req->set_time(aTime);
+    req->set_subscribe(true);
+    Request(aCallBack, req);
+}
+
 void ServerProxy::WriteRequest(ResponseCallBack aCallBack, PayloadPtr aPayloadMsg)
 {
     mRequestTime = GetMiliseconds();
     //std::cout << "NET:WriteRequest " << aPayloadMsg->ShortDebugString() << std::endl;
-    size_t messageSize = aPayloadMsg->ByteSize();
     HeaderMsg header;
-    header.set_size(messageSize);
-    size_t headerSize = header.ByteSize();
-    header.SerializeToArray(mHeaderBuffer, headerSize);
-    mOutBytes += headerSize;
-    mOutBytes += messageSize;
-    AllocBuffer(messageSize);
-    aPayloadMsg->SerializeToArray(mMessageBuffer, messageSize);
-
-
-    boost::array<boost::asio::mutable_buffer, 2> bufs = {{
-        boost::asio::buffer(mHeaderBuffer, headerSize),
-        boost::asio::buffer(mMessageBuffer, messageSize)}};
+    header.set_size(aPayloadMsg->ByteSize());
+    // Subscribed proxy reads into the read buffers while it writes
+    mWriteBuffer.clear();
+    header.AppendToString(&mWriteBuffer);
+    aPayloadMsg->AppendToString(&mWriteBuffer);
+    mOutBytes += mWriteBuffer.size();
+
+    if (mSubscribed)
+    {
+        // Updates are already being read
+        boost::asio::async_write(*mSSLStream, boost::asio::buffer(mWriteBuffer),
+                                 boost::bind(&ServerProxy::WriteNext,
+                                             this, boost::asio::placeholders::error));
+        return;
+    }
 
-    boost::asio::async_write(*mSSLStream, bufs,
+    mSubscribing = mSubscribing || aPayloadMsg->subscribe();
+    boost::asio::async_write(*mSSLStream, boost::asio::buffer(mWriteBuffer),
                              boost::bind(&ServerProxy::ReadResponse,
                                          this, aCallBack,
                                          boost::asio::placeholders::error,
                                          boost::asio::placeholders::bytes_transferred));
 }
 
+void ServerProxy::WriteNext(const boost::system::error_code& aError)
+{
+    if (aError)
+    {
+        boost::throw_exception(std::runtime_error("Не удалось отправить сообщение!"));
+    }
+
+    if (!mRequests.empty())
+    {
+        std::pair<ResponseCallBack, PayloadPtr> nextRequest = mRequests.front();
+        mRequests.pop_front();
+        WriteRequest(nextRequest.first, nextRequest.second);
+    }
+    else
+    {
+        mAsync = false;
+    }
+}
+
+void ServerProxy::Acknowledge(GameTime aTime)
+{
+    if (++mUnacked >= std::max(FLAGS_ack_interval, 1))
+    {
+        mUnacked = 0;
+        PayloadPtr ack(new PayloadMsg());
+        ack->set_time(aTime);
+        Request(ResponseCallBack(), ack);
+    }
+}
+
 void ServerProxy::ReadResponse(ResponseCallBack aCallBack,
                            const boost::system::error_code& aError,
                            std::size_t aBytesTransferred)
@@ -96,7 +140,11 @@ void ServerProxy::ParseHeader(ResponseCallBack aCallBack,
                           const boost::system::error_code& aError,
                           std::size_t aBytesTransferred)
 {
-    mPing = GetMiliseconds() - mRequestTime;
+    if (!mSubscribed)
+    {
+        // Pushed updates are not answers to requests
+        mPing = GetMiliseconds() - mRequestTime;
+    }
 
     //std::cout << "NET:ParseHeader " << aError << " " << aBytesTransferred << std::endl;
     if (aError)
@@ -143,21 +191,27 @@ void ServerProxy::ParseMessage(ResponseCallBack aCallBack,
     //std::cout << "NET:ParseMessage " << msg->ShortDebugString() << std::endl;
     aCallBack(msg);
 
-    if (!msg->last())
+    if (mSubscribed)
+    {
+        // Server pushes the next update without request
+        if (msg->last())
+        {
+            Acknowledge(msg->time());
+        }
+        ReadResponse(aCallBack, aError, aBytesTransferred);
+    }
+    else if (!msg->last())
     {
         ReadResponse(aCallBack, aError, aBytesTransferred);
     }
     else
     {
-        if (!mRequests.empty())
-        {
-            std::pair<ResponseCallBack, PayloadPtr> nextRequest = mRequests.front();
-            mRequests.pop_front();
-            WriteRequest(nextRequest.first, nextRequest.second);
-        }
-        else
+        if (mSubscribing)
         {
-            mAsync = false;
+            // Answer to subscription is followed by pushed updates
+            mSubscribed = true;
+            ReadResponse(aCallBack, aError, aBytesTransferred);
         }
+        WriteNext(aError);
     }
 }
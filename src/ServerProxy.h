@@ -4,6 +4,7 @@
 #include <google/protobuf/message.h>
 #include <boost/circular_buffer.hpp>
 #include <Payload.pb.h>
+#include <gflags/gflags.h>
 
 typedef boost::shared_ptr< PayloadMsg > PayloadPtr;
 typedef boost::shared_ptr< const PayloadMsg > ConstPayloadPtr;
@@ -12,24 +13,35 @@ typedef boost::function< void (ConstPayloadPtr) > ResponseCallBack;
 typedef boost::circular_buffer< std::pair<ResponseCallBack, PayloadPtr> > Requests;
 const size_t HEADER_BUFFER_SIZE = 8;
 
+DECLARE_int32(ack_interval);
+
 class IServerProxy
 {
 public:
     virtual void Request(ResponseCallBack aCallBack, PayloadPtr aPayloadMsg) = 0;
 };
 
+// Requests are answered one after another. After subscription server pushes
+// updates without requests and does not answer them any more, so updates are
+// read all the time and acknowledged every ack_interval updates
 class ServerProxy: public IServerProxy
 {
 public:
     ServerProxy(SSLStreamPtr aSSLStream);
     ~ServerProxy();
     virtual void Request(ResponseCallBack aCallBack, PayloadPtr aPayloadMsg);
+    // aCallBack gets update since aTime and all pushed updates
+    void Subscribe(ResponseCallBack aCallBack, GameTime aTime);
+    bool IsSubscribed() const { return mSubscribed; }
     int32 GetInBytes() const { return mInBytes; }
     int32 GetOutBytes() const { return mOutBytes; }
     int32 GetPing() const { return mPing; }
 private:
     void AllocBuffer(int aSize);
     void WriteRequest(ResponseCallBack aCallBack, PayloadPtr aPayloadMsg);
+    // Writes the next request, subscribed proxy does not wait for answers
+    void WriteNext(const boost::system::error_code& aError);
+    void Acknowledge(GameTime aTime);
     void ReadResponse(ResponseCallBack aCallBack,
                       const boost::system::error_code& aError,
                       std::size_t aBytesTransferred);
@@ -44,7 +56,11 @@ private:
     char mHeaderBuffer[HEADER_BUFFER_SIZE];
     size_t mHeaderSize;
     int mBufferSize;
+    std::string mWriteBuffer;
     bool mAsync;
+    bool mSubscribing;
+    bool mSubscribed;
+    int32 mUnacked;
     Requests mRequests;
     int32 mInBytes;
     int32 mOutBytes;
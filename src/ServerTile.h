@@ -1,6 +1,8 @@
 #ifndef SERVERTILE_H
 #define SERVERTILE_H
 #include <Typedefs.h>
+#include <boost/noncopyable.hpp>
+#include <boost/atomic.hpp>
 #include <OgreVector3.h>
 #include <ChangeList.h>
 
@@ -10,13 +12,17 @@ public:
     typedef std::set<UnitId>::const_iterator UnitIterator;
     explicit ServerTile(TileId aId, const Ogre::Vector3& aPosition);
     ~ServerTile();
-    void AddNeighbour(ServerTile& aTile) { mNeighbourhood.push_back(&aTile); }
-    void RemoveNeighbour(ServerTile& aTile);
-    void SortNeighbourhood();
+    void SetNeighbourhood(const TileId* aNeighbours, uint32 aCount, const std::vector<ServerTile*>& aTiles)
+    {
+        mNeighbours = aNeighbours;
+        mNeighbourCount = aCount;
+        mTiles = &aTiles;
+    }
 
     const Ogre::Vector3& GetPosition() const { return mPosition; }
-    size_t GetNeighbourCount() const { return mNeighbourhood.size(); }
-    ServerTile& GetNeighbour(size_t aIndex) const { return *mNeighbourhood[aIndex]; }
+    size_t GetNeighbourCount() const { return mNeighbourCount; }
+    TileId GetNeighbourId(size_t aIndex) const { return mNeighbours[aIndex]; }
+    ServerTile& GetNeighbour(size_t aIndex) const { return *(*mTiles)[mNeighbours[aIndex]]; }
     UnitIterator GetUnits() const { return mUnitList.begin(); }
     bool IsLastUnit(UnitIterator aIterator) const { return mUnitList.end() == aIterator; }
     void AddUnitId(UnitId aUnitId) { mUnitList.insert(aUnitId); }
@@ -26,11 +32,20 @@ public:
 
     TileId GetTileId() const { return mTileId; }
     ChangeList* GetChangeList() { return &mChangeList; }
-    void SetHeight(int32 aHeight) { mHeight = aHeight; mWater = std::max(mHeight - 400, 0); }
+    void SetHeight(int32 aHeight) { mHeight = aHeight; mWater = std::max(mHeight - 400, 0); ++mTerrainVersion; }
     int32 GetHeight() const { return mHeight; }
     int32 GetWater() const { return mWater; }
+    // Changes on every height write, so whenever a tile may change whether
+    // it can be entered. Minds compare it from parallel threads
+    static uint32 GetTerrainVersion() { return mTerrainVersion.load(); }
 private:
-    std::vector< ServerTile* > mNeighbourhood;
+    static boost::atomic<uint32> mTerrainVersion;
+
+    // Points into grid adjacency table
+    const TileId* mNeighbours;
+    uint32 mNeighbourCount;
+    // Vector of grid tiles, not its storage, which may be reallocated
+    const std::vector<ServerTile*>* mTiles;
     std::set<UnitId> mUnitList;
     const Ogre::Vector3 mPosition;
     const TileId mTileId;
@@ -3,31 +3,30 @@
 
 #include <ServerTile.h>
 #include <ChangeList.h>
-#include <MindList.h>
 #include <UnitList.h>
 
-ServerUnit::ServerUnit(ServerTile& aTile, const UnitClass& aClass, UnitId aUnitId):
-    mUnitId(aUnitId), mClass(aClass), mPosition(&aTile),  mTarget(NULL)
+ServerTile& ServerUnit::GetUnitTile() const
 {
-    mPosition->AddUnitId(mUnitId);
-    if (aClass.GetMaxSpeed() > 0)
-    {
-        MindList::NewMind(aUnitId);
-    }
+    return UnitList::GetPosition(UnitList::GetIndex(mUnitId));
 }
 
-ServerUnit::~ServerUnit()
+const UnitClass& ServerUnit::GetClass() const
 {
-    mPosition->RemoveUnitId(mUnitId);
-    mPosition->GetChangeList()->AddRemove(mUnitId);
+    return UnitList::GetClass(UnitList::GetIndex(mUnitId));
 }
 
-void ServerUnit::Move(ServerTile& aNewPosition)
+GameTime ServerUnit::GetBirthTime() const
 {
-    mPosition->GetChangeList()->AddLeave(mUnitId, aNewPosition.GetTileId());
-    aNewPosition.GetChangeList()->AddEnter(mUnitId, mClass.GetVisualCode(), mPosition->GetTileId());
-    mPosition->RemoveUnitId(mUnitId);
-    mPosition = &aNewPosition;
-    mPosition->AddUnitId(mUnitId);
+    return UnitList::GetBirthTime(UnitList::GetIndex(mUnitId));
 }
 
+void ServerUnit::Move(ServerTile& aNewPosition)
+{
+    const uint32 index = UnitList::GetIndex(mUnitId);
+    ServerTile& position = UnitList::GetPosition(index);
+    position.GetChangeList()->AddLeave(mUnitId, aNewPosition.GetTileId());
+    aNewPosition.GetChangeList()->AddEnter(mUnitId, UnitList::GetClass(index).GetVisualCode(), position.GetTileId());
+    position.RemoveUnitId(mUnitId);
+    UnitList::SetPosition(index, aNewPosition);
+    aNewPosition.AddUnitId(mUnitId);
+}
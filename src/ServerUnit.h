@@ -6,21 +6,18 @@
 
 class ServerTile;
 
+// Handle of a unit, its state is kept in UnitList arrays by unit slot
 class ServerUnit
 {
 public:
-    ServerUnit(ServerTile& aTile, const UnitClass& aClass, UnitId aUnitId);
-    ServerTile& GetUnitTile() const { return *mPosition; }
+    explicit ServerUnit(UnitId aUnitId): mUnitId(aUnitId) {}
     UnitId GetUnitId() const { return mUnitId; }
-    virtual ~ServerUnit();
-    const UnitClass& GetClass() const { return mClass; }
+    ServerTile& GetUnitTile() const;
+    const UnitClass& GetClass() const;
+    GameTime GetBirthTime() const;
     void Move(ServerTile& aNewPosition);
-protected:
 private:
     const UnitId mUnitId;
-    const UnitClass& mClass;
-    ServerTile* mPosition;
-    ServerTile* mTarget;
 };
 
 #endif // SERVERUNIT_H
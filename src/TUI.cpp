@@ -30,7 +30,7 @@ void TUI::Run()
 {
 	TUIStatusWindow statusWindow(mGame);
 	TUILogWindow logWindow;
-	TUIMenuWindow menuWindow;
+	TUIMenuWindow menuWindow(mGame);
 
 	while (true)
 	{
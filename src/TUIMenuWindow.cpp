@@ -3,8 +3,9 @@
 #include <TUIMenuWindow.h>
 
 #include <UserList.h>
+#include <ServerGame.h>
 
-void RunAddUser()
+void RunAddUser(ServerGame& aGame)
 {
     const size_t bufferSize = 80;
     WINDOW* mWin = newwin(LINES / 2, COLS / 2, LINES / 4, COLS / 4);
@@ -30,8 +31,15 @@ void RunAddUser()
         wgetnstr(mWin, userPasswordConf, bufferSize);
         if (!strcmp(userPassword, userPasswordConf))
         {
-            AddUser(userName, userPassword);
-            mvwaddstr(mWin, 4, 1, "User added");
+            try
+            {
+                AddUser(userName, userPassword, aGame.GetGameMutex());
+                mvwaddstr(mWin, 4, 1, "User added");
+            }
+            catch (const std::exception& e)
+            {
+                mvwaddstr(mWin, 4, 1, e.what());
+            }
             wrefresh(mWin);
         }
         else
@@ -57,12 +65,12 @@ void RunKillServer()
 }
 
 
-TUIMenuWindow::TUIMenuWindow():mOption(0), mQuit(false)
+TUIMenuWindow::TUIMenuWindow(ServerGame& aGame):mOption(0), mQuit(false)
 {
     mWin = newwin(LINES, COLS, 0, 0);
     wborder(mWin, 0, 0, 0, 0, 0, 0, 0, 0);
     mCommands.push_back(Command("Close menu", boost::bind(&TUIMenuWindow::Exit, this)));
-    mCommands.push_back(Command("Add user", RunAddUser));
+    mCommands.push_back(Command("Add user", boost::bind(RunAddUser, boost::ref(aGame))));
     mCommands.push_back(Command("Kill server", RunKillServer));
 }
 
@@ -5,13 +5,15 @@
 #include <string>
 #include <curses.h>
 
+class ServerGame;
+
 class TUIMenuWindow
 {
 private:
 	typedef std::pair<std::string, boost::function< void()> > Command;
 	typedef std::vector<Command> CommandVector;
 public:
-	TUIMenuWindow();
+	TUIMenuWindow(ServerGame& aGame);
 	~TUIMenuWindow();
 	void Run();
 private:
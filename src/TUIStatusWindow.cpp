@@ -2,7 +2,9 @@
 
 #include <TUIStatusWindow.h>
 #include <UnitList.h>
+#include <MindList.h>
 #include <ServerApp.h>
+#include <ClientConnection.h>
 
 TUIStatusWindow::TUIStatusWindow(ServerGame& aGame):mGame(aGame)
 {
@@ -20,7 +22,9 @@ void TUIStatusWindow::Update()
     wclear(mWin);
     std::stringstream ss;
     ss << "S&C " << PROTOCOL_VERSION << '.' << RELEASE_VERSION << " at:" << FLAGS_address;
-    ss << " T:" << mGame.GetTiles().size() << " U:" << UnitList::GetCount() << " S:" << mGame.GetTime();
+    ss << " T:" << mGame.GetTiles().size() << " U:" << UnitList::GetCount() << " A:" << MindList::GetActiveCount() << " S:" << mGame.GetTime();
+    const ClientConnection::SendStats stats = ClientConnection::GetSendStats();
+    ss << " Q:" << stats.mQueuedBytes << " D:" << stats.mDrops << '/' << stats.mDisconnects;
     mvwaddstr(mWin, 0, 0, ss.str().c_str());
     wrefresh(mWin);
 }
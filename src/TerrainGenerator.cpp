@@ -0,0 +1,136 @@
+#include <pch.h>
+
+#include <TerrainGenerator.h>
+
+DEFINE_int32(terrain_threads, 0, "Threads generating terrain, 0 or less - one per hardware thread");
+DEFINE_int32(terrain_octaves, 6, "Noise octaves summed into terrain height");
+DEFINE_double(terrain_frequency, 2.0, "Noise frequency of the first octave, higher gives more continents");
+DEFINE_int32(terrain_smoothing, 1, "Passes averaging tile heights with neighbours after noise");
+DEFINE_int32(terrain_amplitude, 1000, "Height difference between noise -1 and 1");
+
+namespace
+{
+    // Water covers tiles higher than this, see ServerTile::SetHeight
+    const float SEA_LEVEL = 400.0f;
+
+    uint32 Hash(int32 x, int32 y, int32 z, uint32 aSeed)
+    {
+        uint32 h = aSeed ^ (uint32(x) * 0x8DA6B343u) ^ (uint32(y) * 0xD8163841u) ^ (uint32(z) * 0xCB1AB31Fu);
+        h ^= h >> 16;
+        h *= 0x85EBCA6Bu;
+        h ^= h >> 13;
+        h *= 0xC2B2AE35u;
+        h ^= h >> 16;
+        return h;
+    }
+
+    // Dot product with one of 12 gradients pointing to cube edge middles
+    float Gradient(uint32 aHash, float x, float y, float z)
+    {
+        const uint32 h = aHash & 15;
+        const float u = h < 8 ? x : y;
+        const float v = h < 4 ? y : (h == 12 || h == 14 ? x : z);
+        return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
+    }
+
+    float Fade(float t)
+    {
+        return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+    }
+
+    float Lerp(float a, float b, float t)
+    {
+        return a + t * (b - a);
+    }
+}
+
+TerrainGenerator::TerrainGenerator(uint32 aSeed): mSeed(aSeed)
+{
+}
+
+float TerrainGenerator::CalcOctave(const Ogre::Vector3& aPoint, uint32 aOctave) const
+{
+    const uint32 seed = Hash(aOctave, 0, 0, mSeed);
+    const int32 x0 = static_cast<int32>(floor(aPoint.x));
+    const int32 y0 = static_cast<int32>(floor(aPoint.y));
+    const int32 z0 = static_cast<int32>(floor(aPoint.z));
+    const float x = aPoint.x - x0;
+    const float y = aPoint.y - y0;
+    const float z = aPoint.z - z0;
+
+    const float n000 = Gradient(Hash(x0, y0, z0, seed), x, y, z);
+    const float n100 = Gradient(Hash(x0 + 1, y0, z0, seed), x - 1, y, z);
+    const float n010 = Gradient(Hash(x0, y0 + 1, z0, seed), x, y - 1, z);
+    const float n110 = Gradient(Hash(x0 + 1, y0 + 1, z0, seed), x - 1, y - 1, z);
+    const float n001 = Gradient(Hash(x0, y0, z0 + 1, seed), x, y, z - 1);
+    const float n101 = Gradient(Hash(x0 + 1, y0, z0 + 1, seed), x - 1, y, z - 1);
+    const float n011 = Gradient(Hash(x0, y0 + 1, z0 + 1, seed), x, y - 1, z - 1);
+    const float n111 = Gradient(Hash(x0 + 1, y0 + 1, z0 + 1, seed), x - 1, y - 1, z - 1);
+
+    const float u = Fade(x);
+    const float v = Fade(y);
+    const float w = Fade(z);
+    return Lerp(Lerp(Lerp(n000, n100, u), Lerp(n010, n110, u), v),
+                Lerp(Lerp(n001, n101, u), Lerp(n011, n111, u), v), w);
+}
+
+float TerrainGenerator::CalcNoise(const Ogre::Vector3& aDirection) const
+{
+    float noise = 0.0f;
+    float amplitude = 1.0f;
+    float amplitudeSum = 0.0f;
+    Ogre::Vector3 point = aDirection * static_cast<float>(FLAGS_terrain_frequency);
+    for (int32 octave = 0; octave < FLAGS_terrain_octaves; ++octave)
+    {
+        noise += CalcOctave(point, octave) * amplitude;
+        amplitudeSum += amplitude;
+        amplitude *= 0.5f;
+        point *= 2.0f;
+    }
+    return amplitudeSum > 0.0f ? noise / amplitudeSum : 0.0f;
+}
+
+void TerrainGenerator::CalcHeights(const ServerGeodesicGrid::Tiles& aTiles, std::vector<float>& aHeights, size_t aBegin, size_t aEnd) const
+{
+    for (size_t i = aBegin; i < aEnd; ++i)
+    {
+        aHeights[i] = SEA_LEVEL + CalcNoise(aTiles[i]->GetPosition().normalisedCopy()) * FLAGS_terrain_amplitude;
+    }
+}
+
+void TerrainGenerator::Smooth(const TileAdjacency& aAdjacency, const std::vector<float>& aHeights, std::vector<float>& aResult, size_t aBegin, size_t aEnd) const
+{
+    for (size_t i = aBegin; i < aEnd; ++i)
+    {
+        const TileId* neighbours = aAdjacency.GetNeighbours(i);
+        const uint32 count = aAdjacency.GetNeighbourCount(i);
+        float sum = aHeights[i];
+        for (uint32 n = 0; n < count; ++n)
+        {
+            sum += aHeights[neighbours[n]];
+        }
+        aResult[i] = sum / (count + 1);
+    }
+}
+
+void TerrainGenerator::Generate(const ServerGeodesicGrid::Tiles& aTiles, const TileAdjacency& aAdjacency, size_t aThreadCount) const
+{
+    WorkerPool pool(aThreadCount);
+    std::vector<float> heights(aTiles.size());
+    pool.ParallelFor(aTiles.size(), boost::bind(&TerrainGenerator::CalcHeights, this, boost::cref(aTiles), boost::ref(heights), _1, _2));
+
+    // Each pass reads only the previous one, so result does not depend on thread count
+    std::vector<float> smoothed(aTiles.size());
+    for (int32 pass = 0; pass < FLAGS_terrain_smoothing; ++pass)
+    {
+        pool.ParallelFor(aTiles.size(), boost::bind(&TerrainGenerator::Smooth, this, boost::cref(aAdjacency), boost::cref(heights), boost::ref(smoothed), _1, _2));
+        heights.swap(smoothed);
+    }
+
+    // Each write bumps the one shared terrain version, threads would only
+    // contend on it, and the writes themselves are cheap
+    for (size_t i = 0; i < aTiles.size(); ++i)
+    {
+        aTiles[i]->SetHeight(std::max(static_cast<int32>(heights[i]), 0));
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef TERRAINGENERATOR_H
+#define TERRAINGENERATOR_H
+
+#include <Typedefs.h>
+#include <ServerGeodesicGrid.h>
+#include <WorkerPool.h>
+
+DECLARE_int32(terrain_threads);
+
+// Heights from 3D gradient noise sampled at tile directions, so the same
+// seed gives the same world however tiles are split between threads
+class TerrainGenerator
+{
+public:
+    explicit TerrainGenerator(uint32 aSeed);
+    // Noise summed over octaves, about -1 .. 1 on the unit sphere
+    float CalcNoise(const Ogre::Vector3& aDirection) const;
+    void Generate(const ServerGeodesicGrid::Tiles& aTiles, const TileAdjacency& aAdjacency, size_t aThreadCount) const;
+private:
+    float CalcOctave(const Ogre::Vector3& aPoint, uint32 aOctave) const;
+    void CalcHeights(const ServerGeodesicGrid::Tiles& aTiles, std::vector<float>& aHeights, size_t aBegin, size_t aEnd) const;
+    void Smooth(const TileAdjacency& aAdjacency, const std::vector<float>& aHeights, std::vector<float>& aResult, size_t aBegin, size_t aEnd) const;
+
+    const uint32 mSeed;
+};
+
+#endif // TERRAINGENERATOR_H
@@ -0,0 +1,64 @@
+#ifndef TILEADJACENCY_H
+#define TILEADJACENCY_H
+
+#include <Typedefs.h>
+#include <boost/noncopyable.hpp>
+
+// Read only neighbour table in one allocation, neighbours of a tile are
+// mNeighbours[mOffsets[tile] .. mOffsets[tile + 1]) sorted around the tile
+class TileAdjacency: public boost::noncopyable
+{
+public:
+    TileAdjacency(): mOffsetStorage(1, 0), mOffsets(&mOffsetStorage[0]), mNeighbours(NULL), mTileCount(0) {}
+
+    void Reserve(size_t aTileCount, size_t aNeighbourCount)
+    {
+        mOffsetStorage.reserve(aTileCount + 1);
+        mNeighbourStorage.reserve(aNeighbourCount);
+        UpdatePointers();
+    }
+    // Appends neighbourhood of the next tile
+    void AddTile(const TileId* aBegin, const TileId* aEnd)
+    {
+        mNeighbourStorage.insert(mNeighbourStorage.end(), aBegin, aEnd);
+        mOffsetStorage.push_back(mNeighbourStorage.size());
+        UpdatePointers();
+    }
+    void Clear()
+    {
+        mOffsetStorage.assign(1, 0);
+        std::vector<TileId>().swap(mNeighbourStorage);
+        UpdatePointers();
+    }
+    // Uses tables owned by someone else, e.g. mapped grid file
+    void Assign(const uint32* aOffsets, const TileId* aNeighbours, size_t aTileCount)
+    {
+        std::vector<uint32>().swap(mOffsetStorage);
+        std::vector<TileId>().swap(mNeighbourStorage);
+        mOffsets = aOffsets;
+        mNeighbours = aNeighbours;
+        mTileCount = aTileCount;
+    }
+
+    size_t GetTileCount() const { return mTileCount; }
+    size_t GetTotalNeighbourCount() const { return mOffsets[mTileCount]; }
+    uint32 GetNeighbourCount(TileId aTile) const { return mOffsets[aTile + 1] - mOffsets[aTile]; }
+    TileId GetNeighbour(TileId aTile, size_t aIndex) const { return mNeighbours[mOffsets[aTile] + aIndex]; }
+    const TileId* GetNeighbours(TileId aTile) const { return mNeighbours + mOffsets[aTile]; }
+    const uint32* GetOffsets() const { return mOffsets; }
+private:
+    void UpdatePointers()
+    {
+        mOffsets = &mOffsetStorage[0];
+        mNeighbours = mNeighbourStorage.empty() ? NULL : &mNeighbourStorage[0];
+        mTileCount = mOffsetStorage.size() - 1;
+    }
+
+    std::vector<uint32> mOffsetStorage;
+    std::vector<TileId> mNeighbourStorage;
+    const uint32* mOffsets;
+    const TileId* mNeighbours;
+    size_t mTileCount;
+};
+
+#endif // TILEADJACENCY_H
@@ -0,0 +1,113 @@
+#include <pch.h>
+
+#include <TileIndex.h>
+
+void TileIndex::Build(const std::vector<Ogre::Vector3>& aPositions, const TileAdjacency& aAdjacency)
+{
+    mAdjacency = &aAdjacency;
+    mDirections.resize(aPositions.size());
+    for (size_t i = 0; i < aPositions.size(); ++i)
+    {
+        mDirections[i] = aPositions[i].normalisedCopy();
+    }
+
+    // About two cells per tile
+    mResolution = static_cast<size_t>(ceil(sqrt(aPositions.size() / 3.0)));
+    mCells.resize(6 * mResolution * mResolution);
+    TileId tile = 0;
+    for (size_t i = 0; i < mCells.size(); ++i)
+    {
+        // Cells go row by row, previous answer is next to the current one
+        tile = GetTile(GetCellDirection(i), tile);
+        mCells[i] = tile;
+    }
+}
+
+TileId TileIndex::GetTile(const Ogre::Vector3& aPosition) const
+{
+    return GetTile(aPosition, mCells[GetCell(aPosition)]);
+}
+
+TileId TileIndex::GetTile(const Ogre::Vector3& aPosition, TileId aStart) const
+{
+    // Neighbour graph is Delaunay triangulation of tile centres, so greedy walk ends at the nearest one
+    TileId current = aStart;
+    Ogre::Real best = mDirections[current].dotProduct(aPosition);
+    bool moved = true;
+    while (moved)
+    {
+        moved = false;
+        const TileId* neighbours = mAdjacency->GetNeighbours(current);
+        const uint32 count = mAdjacency->GetNeighbourCount(current);
+        for (uint32 n = 0; n < count; ++n)
+        {
+            const Ogre::Real dot = mDirections[neighbours[n]].dotProduct(aPosition);
+            if (dot > best)
+            {
+                best = dot;
+                current = neighbours[n];
+                moved = true;
+            }
+        }
+    }
+    return current;
+}
+
+size_t TileIndex::GetCell(const Ogre::Vector3& aDirection) const
+{
+    const Ogre::Real ax = Ogre::Math::Abs(aDirection.x);
+    const Ogre::Real ay = Ogre::Math::Abs(aDirection.y);
+    const Ogre::Real az = Ogre::Math::Abs(aDirection.z);
+    size_t face;
+    Ogre::Real major, u, v;
+    if (ax >= ay && ax >= az)
+    {
+        face = aDirection.x > 0 ? 0 : 1;
+        major = ax;
+        u = aDirection.y;
+        v = aDirection.z;
+    }
+    else if (ay >= az)
+    {
+        face = aDirection.y > 0 ? 2 : 3;
+        major = ay;
+        u = aDirection.x;
+        v = aDirection.z;
+    }
+    else
+    {
+        face = aDirection.z > 0 ? 4 : 5;
+        major = az;
+        u = aDirection.x;
+        v = aDirection.y;
+    }
+    if (major <= 0)
+    {
+        return 0;
+    }
+
+    const Ogre::Real scale = 0.5f * mResolution / major;
+    const size_t last = mResolution - 1;
+    const size_t column = std::min(static_cast<size_t>(std::max((u + major) * scale, Ogre::Real(0))), last);
+    const size_t row = std::min(static_cast<size_t>(std::max((v + major) * scale, Ogre::Real(0))), last);
+    return (face * mResolution + row) * mResolution + column;
+}
+
+Ogre::Vector3 TileIndex::GetCellDirection(size_t aCell) const
+{
+    const size_t column = aCell % mResolution;
+    const size_t row = aCell / mResolution % mResolution;
+    const size_t face = aCell / (mResolution * mResolution);
+    const Ogre::Real u = (column + 0.5f) * 2 / mResolution - 1;
+    const Ogre::Real v = (row + 0.5f) * 2 / mResolution - 1;
+    const Ogre::Real sign = face % 2 == 0 ? 1.0f : -1.0f;
+    switch (face / 2)
+    {
+    case 0:
+        return Ogre::Vector3(sign, u, v);
+    case 1:
+        return Ogre::Vector3(u, sign, v);
+    default:
+        return Ogre::Vector3(u, v, sign);
+    }
+}
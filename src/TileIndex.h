@@ -0,0 +1,31 @@
+#ifndef TILEINDEX_H
+#define TILEINDEX_H
+
+#include <Typedefs.h>
+#include <OgreVector3.h>
+#include <TileAdjacency.h>
+
+// Finds tile nearest to a direction: cube map cell gives a tile close to the
+// answer, greedy walk over the adjacency finishes in a step or two
+class TileIndex: public boost::noncopyable
+{
+public:
+    TileIndex(): mAdjacency(NULL), mResolution(0) {}
+
+    void Build(const std::vector<Ogre::Vector3>& aPositions, const TileAdjacency& aAdjacency);
+    // aPosition need not be on the sphere, any non zero vector works
+    TileId GetTile(const Ogre::Vector3& aPosition) const;
+    // Walk from aStart, for callers that already know a tile close by
+    TileId GetTile(const Ogre::Vector3& aPosition, TileId aStart) const;
+private:
+    size_t GetCell(const Ogre::Vector3& aDirection) const;
+    Ogre::Vector3 GetCellDirection(size_t aCell) const;
+
+    const TileAdjacency* mAdjacency;
+    std::vector<Ogre::Vector3> mDirections;
+    // 6 faces of mResolution x mResolution cells
+    std::vector<TileId> mCells;
+    size_t mResolution;
+};
+
+#endif // TILEINDEX_H
@@ -7,6 +7,7 @@
 #include <libintl.h>
 #define _(String) gettext (String)
 
+using google::protobuf::uint8;
 using google::protobuf::uint32;
 using google::protobuf::uint64;
 using google::protobuf::int32;
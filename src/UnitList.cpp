@@ -2,73 +2,155 @@
 #include <UnitList.h>
 
 #include <ServerUnit.h>
+#include <ServerTile.h>
+#include <ServerGame.h>
+#include <MindList.h>
+#include <Lifecycle.h>
 #include <UnitListIterator.h>
 
-UnitList::UnitVector UnitList::mUnits;
-UnitList::FreeIdList UnitList::mFreeIdList;
-int32 UnitList::mCount = 0;
+DEFINE_int32(unit_index_bits, 20, "Bits of unit id for slot index, the rest up to 31 is generation");
+
+int32 UnitList::mIndexBits = 20;
+uint32 UnitList::mIndexMask = (1u << 20) - 1;
+uint32 UnitList::mMaxGeneration = (1u << (31 - 20)) - 1;
+std::vector<UnitList::Storage*> UnitList::mChunks;
+std::vector<UnitId> UnitList::mIds;
+std::vector<uint32> UnitList::mGenerations;
+std::vector<ServerTile*> UnitList::mPositions;
+std::vector<const UnitClass*> UnitList::mClasses;
+std::vector<GameTime> UnitList::mBirthTimes;
+std::vector<uint32> UnitList::mDenseIndices;
+std::vector<ServerUnit*> UnitList::mDense;
+uint32 UnitList::mFreeHead = UnitList::NO_SLOT;
+
+void UnitList::Init(int32 aIndexBits)
+{
+    assert(mIds.empty());
+    if (aIndexBits < 1 || aIndexBits > 30)
+    {
+        boost::throw_exception(std::runtime_error("Unit index bits should be in 1..30"));
+    }
+    // Ids stay positive, generation is at least 1 so they are not 0 either
+    mIndexBits = aIndexBits;
+    mIndexMask = (1u << aIndexBits) - 1;
+    mMaxGeneration = (1u << (31 - aIndexBits)) - 1;
+}
 
 ServerUnit& UnitList::NewUnit(ServerTile& aTile, const UnitClass& aClass)
 {
-    ++mCount;
-    if (!mFreeIdList.empty())
+    uint32 index = mFreeHead;
+    if (index != NO_SLOT)
     {
-        UnitId freeId = mFreeIdList.front();
-        mFreeIdList.pop_front();
-        ServerUnit* unit = new ServerUnit(aTile, aClass, freeId + (1 << INDEX_SIZE));
-        assert(!mUnits[freeId & INDEX_MASK]);
-        mUnits[freeId & INDEX_MASK] = unit;
-        return *unit;
+        mFreeHead = GetNextFree(index);
     }
     else
     {
-        UnitId id = mUnits.size() + (1 << INDEX_SIZE);
-        ServerUnit* unit = new ServerUnit(aTile, aClass, id);
-        mUnits.push_back(unit);
-        return *unit;
+        index = mIds.size();
+        if (index > mIndexMask)
+        {
+            boost::throw_exception(std::runtime_error("Unit slots are used up for unit index bits"));
+        }
+        if (index % CHUNK_SIZE == 0)
+        {
+            mChunks.push_back(new Storage[CHUNK_SIZE]);
+        }
+        mIds.push_back(0);
+        mGenerations.push_back(0);
+        mPositions.push_back(NULL);
+        mClasses.push_back(NULL);
+        mBirthTimes.push_back(0);
+        mDenseIndices.push_back(0);
+    }
+
+    uint32& generation = mGenerations[index];
+    assert(generation < mMaxGeneration);
+    ++generation;
+    const UnitId id = static_cast<UnitId>((generation << mIndexBits) | index);
+    mIds[index] = id;
+    mPositions[index] = &aTile;
+    mClasses[index] = &aClass;
+    mBirthTimes[index] = ServerGame::GetTime();
+    mDenseIndices[index] = mDense.size();
+    ServerUnit* unit = new (&GetStorage(index)) ServerUnit(id);
+    mDense.push_back(unit);
+
+    aTile.AddUnitId(id);
+    aTile.GetChangeList()->AddCreate(id, aClass.GetVisualCode());
+    if (aClass.GetMaxSpeed() > 0)
+    {
+        MindList::NewMind(id);
     }
+    Lifecycle::Schedule(id);
+    return *unit;
+}
 
+void UnitList::Remove(uint32 aIndex)
+{
+    const UnitId id = mIds[aIndex];
+    mPositions[aIndex]->RemoveUnitId(id);
+    mPositions[aIndex]->GetChangeList()->AddRemove(id);
+    MindList::DeleteMind(id);
+    Lifecycle::Cancel(id);
+    reinterpret_cast<ServerUnit*>(&GetStorage(aIndex))->~ServerUnit();
+    mIds[aIndex] = 0;
+    mPositions[aIndex] = NULL;
+    mClasses[aIndex] = NULL;
 }
 
 void UnitList::DeleteUnit(UnitId aUnitId)
 {
-    int32 index = aUnitId & INDEX_MASK;
-    ServerUnit* unit = mUnits[index];
-    if (unit)
+    if (GetUnit(aUnitId))
     {
-        --mCount;
-        delete unit;
-        mUnits[index] = 0;
-        mFreeIdList.push_back(aUnitId);
+        const uint32 index = GetIndex(aUnitId);
+        const uint32 denseIndex = mDenseIndices[index];
+        ServerUnit* last = mDense.back();
+        mDense[denseIndex] = last;
+        mDenseIndices[GetIndex(last->GetUnitId())] = denseIndex;
+        mDense.pop_back();
+
+        Remove(index);
+        // Generation never wraps, slot which used them all is retired so its old ids stay dead
+        if (mGenerations[index] < mMaxGeneration)
+        {
+            GetNextFree(index) = mFreeHead;
+            mFreeHead = index;
+        }
     }
 }
 
 ServerUnit* UnitList::GetUnit(UnitId aUnitId)
-{	
-	const size_t index = aUnitId & INDEX_MASK;
-	if (index < mUnits.size())
-	{
-		ServerUnit* const unit = mUnits[index];
-		if (unit && unit->GetUnitId() == aUnitId)
-		{
-			return unit;
-		}
-	}    
+{
+    const uint32 index = GetIndex(aUnitId);
+    if (index < mIds.size() && mIds[index] == aUnitId && aUnitId != 0)
+    {
+        return reinterpret_cast<ServerUnit*>(&GetStorage(index));
+    }
     return NULL;
 }
 
 void UnitList::Clear()
 {
-    for (size_t i = 0; i < mUnits.size(); ++i)
+    for (size_t i = 0; i < mDense.size(); ++i)
+    {
+        Remove(GetIndex(mDense[i]->GetUnitId()));
+    }
+    for (size_t i = 0; i < mChunks.size(); ++i)
     {
-        delete mUnits[i];
+        delete[] mChunks[i];
     }
-    mUnits.clear();
-    mFreeIdList.clear();
-    mCount = 0;
+    mChunks.clear();
+    mIds.clear();
+    mGenerations.clear();
+    mPositions.clear();
+    mClasses.clear();
+    mBirthTimes.clear();
+    mDenseIndices.clear();
+    mDense.clear();
+    mFreeHead = NO_SLOT;
+    Lifecycle::Clear();
 }
 
 UnitListIterator UnitList::GetIterator()
 {
-    return UnitListIterator(mUnits);
+    return UnitListIterator(mDense);
 }
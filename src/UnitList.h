@@ -2,31 +2,67 @@
 #define UNITLIST_H
 
 #include <Typedefs.h>
-#include <list>
+#include <gflags/gflags.h>
+#include <boost/aligned_storage.hpp>
+#include <boost/type_traits/alignment_of.hpp>
+#include <ServerUnit.h>
 
-class ServerUnit;
 class ServerTile;
 class UnitClass;
 class UnitListIterator;
 
+DECLARE_int32(unit_index_bits);
+
+// Slot map of units. Unit id is slot index in low bits and slot
+// generation in the rest, so ids of deleted units are never found again.
+// Slot is retired when its generations are used up.
+// Unit handles live in chunks which never move, free slots are linked
+// through their storage, and live units are also kept packed for
+// iteration. Hot unit state is in arrays by slot
 class UnitList
 {
 public:
+    // Index bits can be changed only while there are no slots
+    static void Init(int32 aIndexBits);
+    static uint32 GetIndex(UnitId aUnitId) { return aUnitId & mIndexMask; }
+    // 0 if slot is free
+    static UnitId GetUnitId(uint32 aIndex) { return mIds[aIndex]; }
+    static ServerTile& GetPosition(uint32 aIndex) { return *mPositions[aIndex]; }
+    static void SetPosition(uint32 aIndex, ServerTile& aTile) { mPositions[aIndex] = &aTile; }
+    static const UnitClass& GetClass(uint32 aIndex) { return *mClasses[aIndex]; }
+    static GameTime GetBirthTime(uint32 aIndex) { return mBirthTimes[aIndex]; }
+
     static ServerUnit& NewUnit(ServerTile& aTile, const UnitClass& aClass);
     static void DeleteUnit(UnitId aUnitId);
     static ServerUnit* GetUnit(UnitId aUnitId);
-    static int32 GetSize() { return mUnits.size(); }
-    static int32 GetCount() { return mCount; }
+    static int32 GetSize() { return mIds.size(); }
+    static int32 GetCount() { return mDense.size(); }
     static void Clear();
     static UnitListIterator GetIterator();
 private:
-    typedef std::vector< ServerUnit* > UnitVector;
-    typedef std::list< UnitId > FreeIdList;
-    static const int32 INDEX_SIZE = 16;
-    static const int32 INDEX_MASK = 0x0000FFFF;
-    static UnitVector mUnits;
-    static FreeIdList mFreeIdList;
-    static int32 mCount;
+    static void Remove(uint32 aIndex);
+
+    typedef boost::aligned_storage<sizeof(ServerUnit), boost::alignment_of<ServerUnit>::value>::type Storage;
+    static const uint32 CHUNK_SIZE = 4096;
+    static const uint32 NO_SLOT = 0xFFFFFFFF;
+
+    static Storage& GetStorage(uint32 aIndex) { return mChunks[aIndex / CHUNK_SIZE][aIndex % CHUNK_SIZE]; }
+    static uint32& GetNextFree(uint32 aIndex) { return *reinterpret_cast<uint32*>(&GetStorage(aIndex)); }
+
+    static int32 mIndexBits;
+    static uint32 mIndexMask;
+    static uint32 mMaxGeneration;
+    static std::vector<Storage*> mChunks;
+    // Id of unit in slot, 0 if free
+    static std::vector<UnitId> mIds;
+    static std::vector<uint32> mGenerations;
+    static std::vector<ServerTile*> mPositions;
+    static std::vector<const UnitClass*> mClasses;
+    static std::vector<GameTime> mBirthTimes;
+    // Position of slot unit in mDense
+    static std::vector<uint32> mDenseIndices;
+    static std::vector<ServerUnit*> mDense;
+    static uint32 mFreeHead;
 };
 
 #endif // UNITLIST_H
@@ -6,16 +6,17 @@
 
 class ServerUnit;
 
+// Goes over packed live units, units must not be created or deleted meanwhile
 class UnitListIterator
 {
 public:
-    UnitListIterator(std::vector< ServerUnit* >& aUnits);
-    void Next();
-    bool IsDone();
+    UnitListIterator(const std::vector< ServerUnit* >& aUnits);
+    void Next() { ++mIndex; }
+    bool IsDone() const { return mIndex >= mUnits.size(); }
     ServerUnit* GetUnit() const { return mUnits[mIndex]; }
 private:
     size_t mIndex;
-    std::vector< ServerUnit* >& mUnits;
+    const std::vector< ServerUnit* >& mUnits;
 };
 
 #endif // UNITLISTITERATOR_H
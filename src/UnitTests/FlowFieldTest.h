@@ -0,0 +1,122 @@
+#ifndef FLOWFIELDTEST_H_INCLUDED
+#define FLOWFIELDTEST_H_INCLUDED
+
+#include <cxxtest/TestSuite.h>
+#include <ServerGeodesicGrid.h>
+#include <FlowField.h>
+
+class FlowFieldTest: public CxxTest::TestSuite
+{
+public:
+    void setUp()
+    {
+        mGrid = new ServerGeodesicGrid(mTiles, 2);
+        for (size_t i = 0; i < mTiles.size(); ++i)
+        {
+            // Scattered lakes
+            mTiles[i]->SetHeight(i % 5 == 2 ? 1000 : 0);
+        }
+        FlowFieldList::Init(mTiles, mGrid->GetAdjacency());
+    }
+
+    void tearDown()
+    {
+        FlowFieldList::Clear();
+        for (size_t i = 0; i < mTiles.size(); ++i)
+        {
+            delete mTiles[i];
+        }
+        mTiles.clear();
+        delete mGrid;
+    }
+
+    // Steps to aTarget over tiles which can be entered, -1 if it can not be reached
+    std::vector<int32> CalcDistances(TileId aTarget)
+    {
+        std::vector<int32> distances(mTiles.size(), -1);
+        std::vector<TileId> queue(1, aTarget);
+        distances[aTarget] = 0;
+        for (size_t q = 0; q < queue.size(); ++q)
+        {
+            const ServerTile& tile = *mTiles[queue[q]];
+            for (size_t n = 0; n < tile.GetNeighbourCount(); ++n)
+            {
+                const TileId neighbour = tile.GetNeighbourId(n);
+                if (distances[neighbour] < 0 && mTiles[neighbour]->CanEnter())
+                {
+                    distances[neighbour] = distances[queue[q]] + 1;
+                    queue.push_back(neighbour);
+                }
+            }
+        }
+        return distances;
+    }
+
+    void CheckNextHops(const FlowField& aFlowField)
+    {
+        const std::vector<int32> distances = CalcDistances(aFlowField.GetTarget());
+        for (TileId i = 0; i < mTiles.size(); ++i)
+        {
+            const TileId next = aFlowField.GetNextHop(i);
+            if (distances[i] <= 0 || !mTiles[i]->CanEnter())
+            {
+                TS_ASSERT_EQUALS(next, distances[i] == 0 ? i : FlowField::NO_HOP);
+            }
+            else
+            {
+                TS_ASSERT_DIFFERS(next, FlowField::NO_HOP);
+                TS_ASSERT_EQUALS(distances[next], distances[i] - 1);
+            }
+        }
+    }
+
+    void TestShortestSteps()
+    {
+        for (TileId target = 0; target < mTiles.size(); target += 41)
+        {
+            if (mTiles[target]->CanEnter())
+            {
+                CheckNextHops(*FlowFieldList::GetFlowField(target));
+            }
+        }
+        TS_ASSERT_EQUALS(FlowFieldList::GetSize(), size_t(0));
+    }
+
+    void TestShared()
+    {
+        FlowFieldPtr first = FlowFieldList::GetFlowField(10);
+        FlowFieldPtr second = FlowFieldList::GetFlowField(10);
+        FlowFieldPtr other = FlowFieldList::GetFlowField(11);
+        TS_ASSERT_EQUALS(first, second);
+        TS_ASSERT_DIFFERS(first, other);
+        TS_ASSERT_EQUALS(FlowFieldList::GetSize(), size_t(2));
+
+        first.reset();
+        TS_ASSERT_EQUALS(FlowFieldList::GetSize(), size_t(2));
+        second.reset();
+        TS_ASSERT_EQUALS(FlowFieldList::GetSize(), size_t(1));
+        other.reset();
+        TS_ASSERT_EQUALS(FlowFieldList::GetSize(), size_t(0));
+    }
+
+    void TestTerrainChange()
+    {
+        FlowFieldPtr flowField = FlowFieldList::GetFlowField(10);
+        CheckNextHops(*flowField);
+
+        // Flood the next hop of some tile
+        const TileId blocked = flowField->GetNextHop(300);
+        TS_ASSERT_DIFFERS(blocked, TileId(10));
+        mTiles[blocked]->SetHeight(1000);
+        CheckNextHops(*flowField);
+        TS_ASSERT_DIFFERS(flowField->GetNextHop(300), blocked);
+
+        mTiles[10]->SetHeight(1000);
+        TS_ASSERT_EQUALS(flowField->GetNextHop(300), FlowField::NO_HOP);
+    }
+private:
+    ServerGeodesicGrid::Tiles mTiles;
+    ServerGeodesicGrid* mGrid;
+};
+
+#endif // FLOWFIELDTEST_H_INCLUDED
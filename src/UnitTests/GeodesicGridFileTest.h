@@ -0,0 +1,168 @@
+#ifndef GEODESICGRIDFILETEST_H_INCLUDED
+#define GEODESICGRIDFILETEST_H_INCLUDED
+
+#include <cxxtest/TestSuite.h>
+
+#include <ServerGeodesicGrid.h>
+#include <boost/filesystem/operations.hpp>
+#include <fstream>
+
+class GeodesicGridFileTest: public CxxTest::TestSuite
+{
+public:
+    void setUp()
+    {
+        mGridDir = FLAGS_grid_dir;
+        FLAGS_grid_dir = "grid_file_test";
+        boost::filesystem::remove_all(FLAGS_grid_dir);
+        boost::filesystem::create_directories(FLAGS_grid_dir);
+    }
+
+    void tearDown()
+    {
+        boost::filesystem::remove_all(FLAGS_grid_dir);
+        FLAGS_grid_dir = mGridDir;
+    }
+
+    void TestSaveAndMap()
+    {
+        ServerGeodesicGrid::Tiles built;
+        ServerGeodesicGrid builtGrid(built, 2);
+        TS_ASSERT(boost::filesystem::exists(GeodesicGridFile::GetPath(2)));
+
+        ServerGeodesicGrid::Tiles mapped;
+        ServerGeodesicGrid mappedGrid(mapped, 2);
+        AssertSame(built, builtGrid, mapped, mappedGrid);
+
+        DeleteTiles(built);
+        DeleteTiles(mapped);
+    }
+
+    void TestInvalidFile()
+    {
+        {
+            std::ofstream out(GeodesicGridFile::GetPath(1).c_str(), std::ios::out | std::ios::binary);
+            out << "not a grid";
+        }
+        ServerGeodesicGrid::Tiles built;
+        ServerGeodesicGrid builtGrid(built, 1);
+
+        GeodesicGridFile file;
+        TS_ASSERT(file.Open(1));
+        TS_ASSERT(!file.Open(2));
+
+        ServerGeodesicGrid::Tiles mapped;
+        ServerGeodesicGrid mappedGrid(mapped, 1);
+        AssertSame(built, builtGrid, mapped, mappedGrid);
+
+        DeleteTiles(built);
+        DeleteTiles(mapped);
+    }
+
+    void TestCorruptBody()
+    {
+        ServerGeodesicGrid::Tiles built;
+        ServerGeodesicGrid builtGrid(built, 1);
+        const std::string path = GeodesicGridFile::GetPath(1);
+        const std::streamoff positions = 32;
+        const std::streamoff offsets = positions + built.size() * 3 * sizeof(float);
+        const std::streamoff size = boost::filesystem::file_size(path);
+
+        GeodesicGridFile file;
+        TS_ASSERT(file.Open(1));
+        // Ranges are checked on every start
+        Patch(path, offsets + sizeof(uint32), 0xFFFFFFF0);
+        TS_ASSERT(!file.Open(1));
+        Restore(path);
+        Patch(path, size - sizeof(TileId), built.size());
+        TS_ASSERT(!file.Open(1));
+        Restore(path);
+        Patch(path, positions, 0x7FC00000);
+        TS_ASSERT(!file.Open(1));
+        Restore(path);
+        // Moved position is in range, only its hash tells
+        Patch(path, positions, 0x3F800000);
+        TS_ASSERT(file.Open(1));
+        const bool verify = FLAGS_grid_verify;
+        FLAGS_grid_verify = true;
+        TS_ASSERT(!file.Open(1));
+        FLAGS_grid_verify = verify;
+        Restore(path);
+        // Corrupt file is rebuilt
+        Patch(path, size - sizeof(TileId), built.size());
+
+        ServerGeodesicGrid::Tiles rebuilt;
+        ServerGeodesicGrid rebuiltGrid(rebuilt, 1);
+        AssertSame(built, builtGrid, rebuilt, rebuiltGrid);
+        TS_ASSERT(file.Open(1));
+
+        DeleteTiles(built);
+        DeleteTiles(rebuilt);
+    }
+
+    void TestChecksumIsTopology()
+    {
+        ServerGeodesicGrid::Tiles tiles;
+        ServerGeodesicGrid grid(tiles, 1);
+        TS_ASSERT_EQUALS(GeodesicGridFile::CalcChecksum(1, grid.GetAdjacency()), grid.GetChecksum());
+        // Same topology of another size is another grid
+        TS_ASSERT_DIFFERS(GeodesicGridFile::CalcChecksum(2, grid.GetAdjacency()), grid.GetChecksum());
+        DeleteTiles(tiles);
+    }
+
+private:
+    void Patch(const std::string& aPath, std::streamoff aOffset, uint32 aValue)
+    {
+        std::fstream file(aPath.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(aOffset);
+        file.write(reinterpret_cast<const char*>(&aValue), sizeof(aValue));
+    }
+
+    void Restore(const std::string& aPath)
+    {
+        boost::filesystem::remove(aPath);
+        ServerGeodesicGrid::Tiles tiles;
+        ServerGeodesicGrid grid(tiles, 1);
+        DeleteTiles(tiles);
+    }
+
+    void AssertSame(const ServerGeodesicGrid::Tiles& aExpected, const ServerGeodesicGrid& aExpectedGrid,
+                    const ServerGeodesicGrid::Tiles& aTiles, const ServerGeodesicGrid& aGrid)
+    {
+        TS_ASSERT_EQUALS(aExpectedGrid.GetChecksum(), aGrid.GetChecksum());
+        TS_ASSERT_EQUALS(aExpectedGrid.GetTileRadius(), aGrid.GetTileRadius());
+        TS_ASSERT_EQUALS(aExpected.size(), aTiles.size());
+        size_t mismatches = 0;
+        for (size_t i = 0; i < aExpected.size() && i < aTiles.size(); ++i)
+        {
+            const ServerTile& expected = *aExpected[i];
+            const ServerTile& tile = *aTiles[i];
+            bool same = expected.GetPosition() == tile.GetPosition() &&
+                expected.GetNeighbourCount() == tile.GetNeighbourCount();
+            for (size_t n = 0; same && n < tile.GetNeighbourCount(); ++n)
+            {
+                same = expected.GetNeighbourId(n) == tile.GetNeighbourId(n) &&
+                    tile.GetNeighbour(n).GetTileId() == tile.GetNeighbourId(n);
+            }
+            if (!same)
+            {
+                ++mismatches;
+            }
+        }
+        TS_ASSERT_EQUALS(mismatches, size_t(0));
+    }
+
+    void DeleteTiles(ServerGeodesicGrid::Tiles& aTiles)
+    {
+        for (size_t i = 0; i < aTiles.size(); ++i)
+        {
+            delete aTiles[i];
+        }
+        aTiles.clear();
+    }
+
+    std::string mGridDir;
+};
+
+
+#endif // GEODESICGRIDFILETEST_H_INCLUDED
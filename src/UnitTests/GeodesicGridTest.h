@@ -6,16 +6,180 @@
 #include <ServerGeodesicGrid.h>
 #include <CompareEdgesAngles.h>
 
+// Edge based builder the grid was generated with before, kept as a reference for GeodesicGrid output
+class ReferenceTile: public boost::noncopyable
+{
+public:
+    ReferenceTile(TileId aId, const Ogre::Vector3& aPosition): mPosition(aPosition), mTileId(aId) {}
+    void AddNeighbour(ReferenceTile& aTile) { mNeighbourhood.push_back(&aTile); }
+    void RemoveNeighbour(ReferenceTile& aTile)
+    {
+        std::vector< ReferenceTile* >::iterator i = std::find(mNeighbourhood.begin(), mNeighbourhood.end(), &aTile);
+        assert(i != mNeighbourhood.end());
+        mNeighbourhood.erase(i);
+    }
+    static bool CompareAltitude(ReferenceTile* a, ReferenceTile* b)
+    {
+        return a->GetPosition().z < b->GetPosition().z;
+    }
+    void SortNeighbourhood()
+    {
+        std::sort(mNeighbourhood.begin(), mNeighbourhood.end(), CompareAltitude);
+        std::sort(mNeighbourhood.begin() + 1, mNeighbourhood.end(), CompareEdgesAngles<ReferenceTile>(mPosition, mNeighbourhood[0]->mPosition));
+    }
+    const Ogre::Vector3& GetPosition() const { return mPosition; }
+    size_t GetNeighbourCount() const { return mNeighbourhood.size(); }
+    ReferenceTile& GetNeighbour(size_t aIndex) const { return *mNeighbourhood[aIndex]; }
+    TileId GetTileId() const { return mTileId; }
+private:
+    std::vector< ReferenceTile* > mNeighbourhood;
+    const Ogre::Vector3 mPosition;
+    const TileId mTileId;
+};
+
+class ReferenceEdge: public boost::noncopyable
+{
+public:
+    ReferenceEdge(ReferenceTile& aTileA, ReferenceTile& aTileB): mTileA(aTileA), mTileB(aTileB)
+    {
+        mTileA.AddNeighbour(mTileB);
+        mTileB.AddNeighbour(mTileA);
+    }
+    void Unlink()
+    {
+        mTileA.RemoveNeighbour(mTileB);
+        mTileB.RemoveNeighbour(mTileA);
+    }
+    ReferenceTile& GetTileA() const { return mTileA; }
+    ReferenceTile& GetTileB() const { return mTileB; }
+private:
+    ReferenceTile& mTileA;
+    ReferenceTile& mTileB;
+};
+
+class ReferenceGeodesicGrid: public boost::noncopyable
+{
+public:
+    typedef std::vector<ReferenceTile*> Tiles;
+    ReferenceGeodesicGrid(Tiles& aTiles, int32 aSize)
+    {
+        const Ogre::Real tileArea = 2.598076211f * 70;
+        int tileCount = (int)(5.0f * pow(2.0f, 2 * aSize + 3)) + 2;
+        const Ogre::Real sphereArea = tileArea * tileCount;
+        const Ogre::Real sphereRadius = sqrt(sphereArea / (4 * Ogre::Math::PI));
+        const Ogre::Real phi = 1.618033989f;
+
+        aTiles.reserve(tileCount);
+        mEdges.reserve(tileCount * 3);
+
+        const Ogre::Real vertices[12][3] = {
+            {0.0f, 1.0f, phi}, {0.0f, 1.0f, -phi}, {0.0f, -1.0f, phi}, {0.0f, -1.0f, -phi},
+            {1.0f, phi, 0.0f}, {1.0f, -phi, 0.0f}, {-1.0f, phi, 0.0f}, {-1.0f, -phi, 0.0f},
+            {phi, 0.0f, 1.0f}, {phi, 0.0f, -1.0f}, {-phi, 0.0f, 1.0f}, {-phi, 0.0f, -1.0f}};
+        for (TileId i = 0; i < 12; ++i)
+        {
+            aTiles.push_back(new ReferenceTile(i, Ogre::Vector3(vertices[i]).normalisedCopy() * sphereRadius));
+        }
+        mIdCounter = 12;
+
+        const TileId edges[30][2] = {
+            {0, 2}, {0, 4}, {0, 6}, {0, 8}, {0, 10}, {1, 3}, {1, 4}, {1, 6}, {1, 9}, {1, 11},
+            {2, 5}, {2, 7}, {2, 8}, {2, 10}, {3, 5}, {3, 7}, {3, 9}, {3, 11}, {4, 6}, {4, 8},
+            {4, 9}, {5, 7}, {5, 8}, {5, 9}, {6, 10}, {6, 11}, {7, 10}, {7, 11}, {8, 9}, {10, 11}};
+        for (size_t i = 0; i < 30; ++i)
+        {
+            mEdges.push_back(new ReferenceEdge(*aTiles[edges[i][0]], *aTiles[edges[i][1]]));
+        }
+
+        for (int i = 0; i <= aSize; ++i)
+        {
+            Subdivide(sphereRadius, aTiles);
+        }
+
+        for (TileId i = 0; i < aTiles.size(); ++i)
+        {
+            aTiles[i]->SortNeighbourhood();
+        }
+    }
+
+    ~ReferenceGeodesicGrid()
+    {
+        for (size_t i = 0; i < mEdges.size(); ++i)
+        {
+            delete mEdges[i];
+        }
+    }
+
+    Ogre::Real GetTileRadius() const
+    {
+        Ogre::Real sum = 0;
+        for (size_t i = 0; i < mEdges.size(); ++i)
+        {
+            const ReferenceEdge* edge = mEdges.at(i);
+            sum += (edge->GetTileA().GetPosition() - edge->GetTileB().GetPosition()).squaredLength();
+        }
+        return sqrt(sum / mEdges.size() / 2.0f);
+    }
+private:
+    void Subdivide(const Ogre::Real aSphereRadius, Tiles& aTiles)
+    {
+        Tiles newTiles;
+        newTiles.reserve(mEdges.size());
+        std::vector< ReferenceEdge* > newEdges;
+
+        for (size_t i = 0; i < mEdges.size(); ++i)
+        {
+            ReferenceEdge* edge = mEdges[i];
+            const Ogre::Vector3& a = edge->GetTileA().GetPosition();
+            const Ogre::Vector3& b = edge->GetTileB().GetPosition();
+            ReferenceTile* tile = new ReferenceTile(mIdCounter, (a + b).normalisedCopy() * aSphereRadius);
+            mIdCounter += 1;
+            newEdges.push_back(new ReferenceEdge(*tile, edge->GetTileA()));
+            newEdges.push_back(new ReferenceEdge(*tile, edge->GetTileB()));
+            newTiles.push_back(tile);
+        }
+
+        for (size_t i = 0; i < mEdges.size(); ++i)
+        {
+            mEdges[i]->Unlink();
+            delete mEdges[i];
+        }
+        mEdges = newEdges;
+
+        for (size_t i = 0; i < aTiles.size(); ++i)
+        {
+            ReferenceTile* tile = aTiles[i];
+            tile->SortNeighbourhood();
+            for (size_t n = 0; n < tile->GetNeighbourCount(); ++n)
+            {
+                size_t to = n + 1;
+                if (to >= tile->GetNeighbourCount())
+                {
+                    to = 0;
+                }
+                mEdges.push_back(new ReferenceEdge(tile->GetNeighbour(n), tile->GetNeighbour(to)));
+            }
+        }
+
+        aTiles.insert(aTiles.end(), newTiles.begin(), newTiles.end());
+    }
+
+    std::vector< ReferenceEdge* > mEdges;
+    TileId mIdCounter;
+};
+
 
 class GeodesicGridTest: public CxxTest::TestSuite
 {
 public:
     void setUp()
     {
+        mGridThreads = FLAGS_grid_threads;
     }
 
     void tearDown()
     {
+        FLAGS_grid_threads = mGridThreads;
     }
     void TestGeodesicGrid()
     {
@@ -38,6 +202,105 @@ public:
         }
     }
 
+    void TestAdjacency()
+    {
+        ServerGeodesicGrid::Tiles tiles;
+        ServerGeodesicGrid grid(tiles, 1);
+        const TileAdjacency& adjacency = grid.GetAdjacency();
+        TS_ASSERT_EQUALS(adjacency.GetTileCount(), tiles.size());
+
+        size_t pentagons = 0;
+        for (TileId i = 0; i < tiles.size(); ++i)
+        {
+            const ServerTile& tile = *tiles[i];
+            TS_ASSERT_EQUALS(tile.GetNeighbourCount(), adjacency.GetNeighbourCount(i));
+            if (adjacency.GetNeighbourCount(i) == 5)
+            {
+                ++pentagons;
+            }
+            for (size_t n = 0; n < adjacency.GetNeighbourCount(i); ++n)
+            {
+                const TileId neighbour = adjacency.GetNeighbour(i, n);
+                TS_ASSERT_EQUALS(tile.GetNeighbourId(n), neighbour);
+                TS_ASSERT_EQUALS(&tile.GetNeighbour(n), tiles[neighbour]);
+                const TileId* begin = adjacency.GetNeighbours(neighbour);
+                const TileId* end = begin + adjacency.GetNeighbourCount(neighbour);
+                TS_ASSERT(std::find(begin, end, i) != end);
+            }
+        }
+        TS_ASSERT_EQUALS(pentagons, size_t(12));
+
+        for (size_t i = 0; i < tiles.size(); ++i)
+        {
+            delete tiles[i];
+        }
+    }
+
+    void TestParallelSameAsSerial()
+    {
+        FLAGS_grid_threads = 1;
+        ServerGeodesicGrid::Tiles serial;
+        ServerGeodesicGrid serialGrid(serial, 4);
+
+        FLAGS_grid_threads = 4;
+        ServerGeodesicGrid::Tiles parallel;
+        ServerGeodesicGrid parallelGrid(parallel, 4);
+
+        TS_ASSERT_EQUALS(serial.size(), parallel.size());
+        TS_ASSERT_EQUALS(serialGrid.GetChecksum(), parallelGrid.GetChecksum());
+        TS_ASSERT_EQUALS(serialGrid.GetTileRadius(), parallelGrid.GetTileRadius());
+
+        for (size_t i = 0; i < serial.size(); ++i)
+        {
+            delete serial[i];
+        }
+        for (size_t i = 0; i < parallel.size(); ++i)
+        {
+            delete parallel[i];
+        }
+    }
+
+    void TestSameAsReference()
+    {
+        for (int32 size = 1; size <= 6; ++size)
+        {
+            ReferenceGeodesicGrid::Tiles expected;
+            ReferenceGeodesicGrid expectedGrid(expected, size);
+            ServerGeodesicGrid::Tiles tiles;
+            ServerGeodesicGrid grid(tiles, size);
+
+            TS_ASSERT_EQUALS(tiles.size(), expected.size());
+            TS_ASSERT_EQUALS(grid.GetTileRadius(), expectedGrid.GetTileRadius());
+            size_t mismatches = 0;
+            for (size_t i = 0; i < tiles.size() && i < expected.size(); ++i)
+            {
+                const ServerTile& tile = *tiles[i];
+                const ReferenceTile& expectedTile = *expected[i];
+                bool same = tile.GetTileId() == expectedTile.GetTileId() &&
+                    tile.GetPosition() == expectedTile.GetPosition() &&
+                    tile.GetNeighbourCount() == expectedTile.GetNeighbourCount();
+                for (size_t n = 0; same && n < tile.GetNeighbourCount(); ++n)
+                {
+                    same = tile.GetNeighbour(n).GetTileId() == expectedTile.GetNeighbour(n).GetTileId();
+                }
+                if (!same)
+                {
+                    ++mismatches;
+                }
+            }
+            TS_ASSERT_EQUALS(mismatches, size_t(0));
+
+            for (size_t i = 0; i < tiles.size(); ++i)
+            {
+                delete tiles[i];
+            }
+            for (size_t i = 0; i < expected.size(); ++i)
+            {
+                delete expected[i];
+            }
+        }
+    }
+
     void TestCompareAngles()
     {
         Ogre::Vector3 root(0.0f,           0.52573108f,  0.850650787f);
@@ -70,6 +333,8 @@ public:
         TS_ASSERT_EQUALS(m[4]->GetTileId(), TileId(1));
     }
 
+private:
+    int32 mGridThreads;
 };
 
 
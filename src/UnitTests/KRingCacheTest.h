@@ -0,0 +1,91 @@
+#ifndef KRINGCACHETEST_H_INCLUDED
+#define KRINGCACHETEST_H_INCLUDED
+
+#include <cxxtest/TestSuite.h>
+#include <ServerGeodesicGrid.h>
+#include <KRingCache.h>
+
+class KRingCacheTest: public CxxTest::TestSuite
+{
+public:
+    void setUp()
+    {
+        mGrid = new ServerGeodesicGrid(mTiles, 2);
+    }
+
+    void tearDown()
+    {
+        for (size_t i = 0; i < mTiles.size(); ++i)
+        {
+            delete mTiles[i];
+        }
+        mTiles.clear();
+        delete mGrid;
+    }
+
+    void TestRingSizes()
+    {
+        const TileAdjacency& adjacency = mGrid->GetAdjacency();
+        // Tile 0 is pentagon, tile 500 is far enough from all of them
+        TS_ASSERT_EQUALS(KRingCache::CalcRing(adjacency, 0, 0)->mTiles.size(), size_t(1));
+        TS_ASSERT_EQUALS(KRingCache::CalcRing(adjacency, 0, 1)->mTiles.size(), size_t(6));
+        TS_ASSERT_EQUALS(KRingCache::CalcRing(adjacency, 500, 1)->mTiles.size(), size_t(7));
+        TS_ASSERT_EQUALS(KRingCache::CalcRing(adjacency, 0, 100)->mTiles.size(), mTiles.size());
+    }
+
+    void TestSameAsSearch()
+    {
+        const TileAdjacency& adjacency = mGrid->GetAdjacency();
+        for (TileId centre = 0; centre < mTiles.size(); centre += 37)
+        {
+            for (uint32 radius = 0; radius < 8; ++radius)
+            {
+                std::set<TileId> expected;
+                expected.insert(centre);
+                for (uint32 d = 0; d < radius; ++d)
+                {
+                    std::set<TileId> layer(expected);
+                    for (std::set<TileId>::const_iterator i = layer.begin(); i != layer.end(); ++i)
+                    {
+                        for (size_t n = 0; n < mTiles[*i]->GetNeighbourCount(); ++n)
+                        {
+                            expected.insert(mTiles[*i]->GetNeighbourId(n));
+                        }
+                    }
+                }
+                const KRingPtr ring = KRingCache::CalcRing(adjacency, centre, radius);
+                const TileRing& tiles = ring->mTiles;
+                TS_ASSERT(tiles.size() == expected.size() && std::equal(tiles.begin(), tiles.end(), expected.begin()));
+
+                const KRingPtr inner = KRingCache::CalcRing(adjacency, centre, radius > 0 ? radius - 1 : 0);
+                TileRing perimeter;
+                std::set_difference(tiles.begin(), tiles.end(), inner->mTiles.begin(), inner->mTiles.end(), std::back_inserter(perimeter));
+                TS_ASSERT(radius == 0 || ring->mPerimeter == perimeter);
+            }
+        }
+    }
+
+    void TestLeastRecentlyUsed()
+    {
+        KRingCache cache(mGrid->GetAdjacency(), 2);
+        const KRingPtr first = cache.GetRing(1, 3);
+        TS_ASSERT_EQUALS(cache.GetRing(1, 3), first);
+        const KRingPtr second = cache.GetRing(2, 3);
+        TS_ASSERT_EQUALS(cache.GetRing(1, 3), first);
+        TS_ASSERT_EQUALS(cache.GetSize(), size_t(2));
+
+        // Second is the least recently used one now
+        cache.GetRing(3, 3);
+        TS_ASSERT_EQUALS(cache.GetSize(), size_t(2));
+        TS_ASSERT_EQUALS(cache.GetRing(1, 3), first);
+        const KRingPtr secondAgain = cache.GetRing(2, 3);
+        TS_ASSERT_DIFFERS(secondAgain, second);
+        TS_ASSERT(secondAgain->mTiles == second->mTiles);
+    }
+
+private:
+    ServerGeodesicGrid::Tiles mTiles;
+    ServerGeodesicGrid* mGrid;
+};
+
+#endif // KRINGCACHETEST_H_INCLUDED
@@ -0,0 +1,161 @@
+#ifndef LIFECYCLETEST_H_INCLUDED
+#define LIFECYCLETEST_H_INCLUDED
+
+#include <cxxtest/TestSuite.h>
+#include <Lifecycle.h>
+#include <UnitList.h>
+#include <MindList.h>
+#include <Mind.h>
+#include <ServerTile.h>
+#include <ServerUnit.h>
+#include <UnitClass.h>
+#include <User.h>
+#include <OgreVector3.h>
+
+class LifecycleTest: public CxxTest::TestSuite
+{
+public:
+    void setUp()
+    {
+        mTile = new ServerTile(0, Ogre::Vector3::UNIT_X);
+    }
+
+    void tearDown()
+    {
+        UnitList::Clear();
+        MindList::Clear();
+        delete mTile;
+    }
+
+    void TestDeath()
+    {
+        UnitClass grass(0, 10, 0);
+        UnitClass rock(0, 0, 0);
+        const UnitId unitId = UnitList::NewUnit(*mTile, grass).GetUnitId();
+        const UnitId rockId = UnitList::NewUnit(*mTile, rock).GetUnitId();
+        const GameTime birth = UnitList::GetBirthTime(UnitList::GetIndex(unitId));
+        TS_ASSERT_EQUALS(Lifecycle::GetPendingCount(), 1);
+
+        Lifecycle::Advance(birth + 9);
+        TS_ASSERT(UnitList::GetUnit(unitId));
+        Lifecycle::Advance(birth + 10);
+        TS_ASSERT(!UnitList::GetUnit(unitId));
+        TS_ASSERT(UnitList::GetUnit(rockId));
+        TS_ASSERT_EQUALS(Lifecycle::GetPendingCount(), 0);
+    }
+
+    void TestBornOld()
+    {
+        UnitClass grass(0, 10, 0);
+        const UnitId oldId = UnitList::NewUnit(*mTile, grass).GetUnitId();
+        const UnitId ancientId = UnitList::NewUnit(*mTile, grass).GetUnitId();
+        const GameTime birth = UnitList::GetBirthTime(UnitList::GetIndex(oldId));
+        Lifecycle::Schedule(oldId, 6);
+        Lifecycle::Schedule(ancientId, 100);
+
+        // Unit born older than max age still lives one turn
+        Lifecycle::Advance(birth);
+        TS_ASSERT(UnitList::GetUnit(ancientId));
+        TS_ASSERT(Lifecycle::GetDied().empty());
+        Lifecycle::Advance(birth + 1);
+        TS_ASSERT(!UnitList::GetUnit(ancientId));
+        TS_ASSERT_EQUALS(Lifecycle::GetDied().size(), size_t(1));
+        TS_ASSERT_EQUALS(Lifecycle::GetDied()[0].mTile, mTile);
+        TS_ASSERT_EQUALS(Lifecycle::GetDied()[0].mClass, &grass);
+
+        Lifecycle::Advance(birth + 3);
+        TS_ASSERT(UnitList::GetUnit(oldId));
+        Lifecycle::Advance(birth + 4);
+        TS_ASSERT(!UnitList::GetUnit(oldId));
+    }
+
+    void TestLevels()
+    {
+        // Ages end up on every level of the wheel and beyond it
+        const uint32 ages[] = { 1, 255, 256, 300, 65535, 65536, 70000, 20000000, 0xFFFFFFFF };
+        const size_t count = sizeof(ages) / sizeof(ages[0]);
+        std::vector<UnitClass> classes;
+        for (size_t i = 0; i < count; ++i)
+        {
+            classes.push_back(UnitClass(0, ages[i], 0));
+        }
+        std::vector<UnitId> ids;
+        for (size_t i = 0; i < count; ++i)
+        {
+            ids.push_back(UnitList::NewUnit(*mTile, classes[i]).GetUnitId());
+        }
+        const GameTime birth = UnitList::GetBirthTime(UnitList::GetIndex(ids[0]));
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            // Long steps between deaths must not skip anyone
+            Lifecycle::Advance(birth + ages[i] - 1);
+            TS_ASSERT(UnitList::GetUnit(ids[i]));
+            Lifecycle::Advance(birth + ages[i]);
+            TS_ASSERT(!UnitList::GetUnit(ids[i]));
+            TS_ASSERT_EQUALS(Lifecycle::GetPendingCount(), count - i - 1);
+        }
+    }
+
+    void TestCancel()
+    {
+        UnitClass grass(0, 10, 0);
+        std::vector<UnitId> ids;
+        for (int i = 0; i < 100; ++i)
+        {
+            ids.push_back(UnitList::NewUnit(*mTile, grass).GetUnitId());
+        }
+        const GameTime birth = UnitList::GetBirthTime(UnitList::GetIndex(ids[0]));
+        for (int i = 0; i < 100; i += 2)
+        {
+            UnitList::DeleteUnit(ids[i]);
+        }
+        TS_ASSERT_EQUALS(Lifecycle::GetPendingCount(), 50);
+        // New unit in slot of deleted one has its own death
+        UnitClass zebra(0, 20, 0);
+        const UnitId zebraId = UnitList::NewUnit(*mTile, zebra).GetUnitId();
+        Lifecycle::Advance(birth + 10);
+        TS_ASSERT_EQUALS(UnitList::GetCount(), 1);
+        TS_ASSERT(UnitList::GetUnit(zebraId));
+        Lifecycle::Advance(birth + 20);
+        TS_ASSERT_EQUALS(UnitList::GetCount(), 0);
+    }
+
+    void TestAvatar()
+    {
+        UnitClass zebra(0, 10, 1);
+        const UnitId unitId = UnitList::NewUnit(*mTile, zebra).GetUnitId();
+        const GameTime birth = UnitList::GetBirthTime(UnitList::GetIndex(unitId));
+        Mind* mind = MindList::GetFreeMind();
+        mind->SetFree(false);
+        Lifecycle::Advance(birth + 100);
+        TS_ASSERT(UnitList::GetUnit(unitId));
+        mind->SetFree(true);
+        Lifecycle::Advance(birth + 200);
+        TS_ASSERT(!UnitList::GetUnit(unitId));
+    }
+
+    void TestUserAfterExpiry()
+    {
+        UnitClass zebra(0, 10, 1);
+        const UnitId unitId = UnitList::NewUnit(*mTile, zebra).GetUnitId();
+        const GameTime birth = UnitList::GetBirthTime(UnitList::GetIndex(unitId));
+        boost::shared_mutex gameMutex;
+        {
+            User user("user", "password", gameMutex);
+            TS_ASSERT_EQUALS(user.GetUnitId(), unitId);
+            Lifecycle::Advance(birth + 100);
+            TS_ASSERT(UnitList::GetUnit(unitId));
+        }
+        // Released avatar dies, then there is no unit for a new user
+        Lifecycle::Advance(birth + 200);
+        TS_ASSERT(!UnitList::GetUnit(unitId));
+        TS_ASSERT(!MindList::GetFreeMind());
+        TS_ASSERT_THROWS(User("user", "password", gameMutex), std::runtime_error);
+    }
+
+private:
+    ServerTile* mTile;
+};
+
+#endif // LIFECYCLETEST_H_INCLUDED
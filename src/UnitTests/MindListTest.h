@@ -5,6 +5,12 @@
 #include <MindList.h>
 #include <Mind.h>
 #include <Exceptions.h>
+#include <ServerGeodesicGrid.h>
+#include <ServerUnit.h>
+#include <UnitList.h>
+#include <PathFinder.h>
+#include <FlowField.h>
+#include <ChangeList.h>
 
 class MindListTest: public CxxTest::TestSuite
 {
@@ -37,6 +43,338 @@ public:
         MindList::UpdateMinds(1);
         TS_ASSERT_EQUALS(MindList::GetSize(), size_t(0));
     }
+
+    // Tiles of all units after some ticks, with every tenth unit commanded
+    std::vector<TileId> RunMinds(int32 aThreadCount)
+    {
+        const int32 threads = FLAGS_mind_threads;
+        FLAGS_mind_threads = aThreadCount;
+        ServerGeodesicGrid::Tiles tiles;
+        ServerGeodesicGrid* grid = new ServerGeodesicGrid(tiles, 2);
+        for (size_t i = 0; i < tiles.size(); ++i)
+        {
+            tiles[i]->SetHeight(i % 9 == 4 ? 1000 : 0);
+        }
+        PathFinder::Init(tiles, grid->GetAdjacency(), 2);
+        FlowFieldList::Init(tiles, grid->GetAdjacency());
+        UnitClass zebra(0, 100, 1);
+        std::vector<UnitId> units;
+        for (size_t i = 0; i < tiles.size(); i += 3)
+        {
+            if (tiles[i]->CanEnter())
+            {
+                units.push_back(UnitList::NewUnit(*tiles[i], zebra).GetUnitId());
+            }
+        }
+        for (size_t i = 0; i < units.size(); i += 10)
+        {
+            Mind* mind = MindList::GetFreeMind();
+            mind->SetFree(false);
+            mind->SetCommand(*tiles[(i / 10) % 2 ? 10 : i * 3]);
+        }
+
+        for (int32 tick = 0; tick < 20; ++tick)
+        {
+            MindList::UpdateMinds(1);
+        }
+
+        std::vector<TileId> positions;
+        for (size_t i = 0; i < units.size(); ++i)
+        {
+            positions.push_back(UnitList::GetUnit(units[i])->GetUnitTile().GetTileId());
+        }
+
+        UnitList::Clear();
+        MindList::Clear();
+        FlowFieldList::Clear();
+        PathFinder::Clear();
+        for (size_t i = 0; i < tiles.size(); ++i)
+        {
+            delete tiles[i];
+        }
+        delete grid;
+        FLAGS_mind_threads = threads;
+        return positions;
+    }
+
+    void TestSchedule()
+    {
+        ServerGeodesicGrid::Tiles tiles;
+        ServerGeodesicGrid* grid = new ServerGeodesicGrid(tiles, 1);
+        for (size_t i = 0; i < tiles.size(); ++i)
+        {
+            tiles[i]->SetHeight(0);
+        }
+        PathFinder::Init(tiles, grid->GetAdjacency(), 1);
+        FlowFieldList::Init(tiles, grid->GetAdjacency());
+        UnitClass zebra(0, 100, 1);
+        const int32 interval = FLAGS_wander_interval;
+        FLAGS_wander_interval = 4;
+
+        // Free minds wander every few updates, each on its own phase of the
+        // period, mind in slot 1 on updates 1, 5, 9... Avatar without command sleeps
+        UnitList::NewUnit(*tiles[0], zebra);
+        UnitList::NewUnit(*tiles[1], zebra);
+        Mind* avatar = MindList::GetFreeMind();
+        avatar->SetFree(false);
+        std::vector<size_t> active;
+        size_t total = 0;
+        for (int32 i = 0; i < 2 * FLAGS_wander_interval; ++i)
+        {
+            MindList::UpdateMinds(1);
+            active.push_back(MindList::GetActiveCount());
+            total += active.back();
+        }
+        TS_ASSERT_EQUALS(active[0], size_t(1));
+        TS_ASSERT_EQUALS(active[1], size_t(1));
+        TS_ASSERT_EQUALS(active[2], size_t(0));
+        TS_ASSERT_EQUALS(total, size_t(1 + 2));
+
+        // Command wakes avatar, it steps every update and sleeps once there
+        ServerTile& start = UnitList::GetUnit(avatar->GetUnitId())->GetUnitTile();
+        ServerTile& middle = start.GetNeighbour(0);
+        ServerTile& target = &middle.GetNeighbour(0) == &start ? middle.GetNeighbour(1) : middle.GetNeighbour(0);
+        avatar->SetCommand(target);
+        int32 avatarUpdates = 0;
+        for (int32 i = 0; i < 2 * FLAGS_wander_interval; ++i)
+        {
+            MindList::UpdateMinds(1);
+            avatarUpdates += MindList::GetActiveCount() - (i % FLAGS_wander_interval == 1 ? 1 : 0);
+        }
+        TS_ASSERT_EQUALS(&UnitList::GetUnit(avatar->GetUnitId())->GetUnitTile(), &target);
+        TS_ASSERT_LESS_THAN_EQUALS(avatarUpdates, 3);
+
+        FLAGS_wander_interval = interval;
+        UnitList::Clear();
+        MindList::Clear();
+        FlowFieldList::Clear();
+        PathFinder::Clear();
+        for (size_t i = 0; i < tiles.size(); ++i)
+        {
+            delete tiles[i];
+        }
+        delete grid;
+    }
+
+    void TestWanderersSpread()
+    {
+        ServerGeodesicGrid::Tiles tiles;
+        ServerGeodesicGrid* grid = new ServerGeodesicGrid(tiles, 3);
+        for (size_t i = 0; i < tiles.size(); ++i)
+        {
+            tiles[i]->SetHeight(0);
+        }
+        PathFinder::Init(tiles, grid->GetAdjacency(), 3);
+        FlowFieldList::Init(tiles, grid->GetAdjacency());
+        UnitClass zebra(0, 100, 1);
+        const int32 interval = FLAGS_wander_interval;
+        FLAGS_wander_interval = 16;
+        for (size_t i = 0; i < tiles.size(); ++i)
+        {
+            UnitList::NewUnit(*tiles[i], zebra);
+        }
+
+        // Wanderers are almost all units, with slower wander each update only
+        // a few of them decide, not all of them every few updates
+        size_t total = 0;
+        const int32 updates = 4 * FLAGS_wander_interval;
+        for (int32 i = 0; i < updates; ++i)
+        {
+            MindList::UpdateMinds(1);
+            TS_ASSERT_LESS_THAN_EQUALS(MindList::GetActiveCount() * 8, MindList::GetSize());
+            total += MindList::GetActiveCount();
+        }
+        TS_ASSERT_EQUALS(total, MindList::GetSize() * 4);
+
+        FLAGS_wander_interval = interval;
+        UnitList::Clear();
+        MindList::Clear();
+        FlowFieldList::Clear();
+        PathFinder::Clear();
+        for (size_t i = 0; i < tiles.size(); ++i)
+        {
+            delete tiles[i];
+        }
+        delete grid;
+    }
+
+    void TestCommandWhileWandering()
+    {
+        ServerGeodesicGrid::Tiles tiles;
+        ServerGeodesicGrid* grid = new ServerGeodesicGrid(tiles, 2);
+        for (size_t i = 0; i < tiles.size(); ++i)
+        {
+            tiles[i]->SetHeight(0);
+        }
+        PathFinder::Init(tiles, grid->GetAdjacency(), 2);
+        FlowFieldList::Init(tiles, grid->GetAdjacency());
+        UnitClass zebra(0, 100, 1);
+        const int32 interval = FLAGS_wander_interval;
+        FLAGS_wander_interval = 4;
+
+        // Wander entry is left in the wheel when the mind is commanded
+        const UnitId unitId = UnitList::NewUnit(*tiles[0], zebra).GetUnitId();
+        MindList::UpdateMinds(1);
+        Mind* mind = MindList::GetFreeMind();
+        mind->SetFree(false);
+        mind->SetCommand(*tiles[tiles.size() / 2]);
+        for (int32 i = 0; i < 3 * FLAGS_wander_interval; ++i)
+        {
+            ServerTile& before = UnitList::GetUnit(unitId)->GetUnitTile();
+            MindList::UpdateMinds(1);
+            TS_ASSERT_LESS_THAN_EQUALS(MindList::GetActiveCount(), size_t(1));
+            ServerTile& after = UnitList::GetUnit(unitId)->GetUnitTile();
+            bool isStep = &after == &before;
+            for (size_t n = 0; n < before.GetNeighbourCount(); ++n)
+            {
+                isStep = isStep || &before.GetNeighbour(n) == &after;
+            }
+            TS_ASSERT(isStep);
+        }
+
+        FLAGS_wander_interval = interval;
+        UnitList::Clear();
+        MindList::Clear();
+        FlowFieldList::Clear();
+        PathFinder::Clear();
+        for (size_t i = 0; i < tiles.size(); ++i)
+        {
+            delete tiles[i];
+        }
+        delete grid;
+    }
+
+    void TestCommandBetweenDecideAndApply()
+    {
+        ServerGeodesicGrid::Tiles tiles;
+        ServerGeodesicGrid* grid = new ServerGeodesicGrid(tiles, 2);
+        for (size_t i = 0; i < tiles.size(); ++i)
+        {
+            tiles[i]->SetHeight(0);
+        }
+        PathFinder::Init(tiles, grid->GetAdjacency(), 2);
+        FlowFieldList::Init(tiles, grid->GetAdjacency());
+        UnitClass zebra(0, 100, 1);
+
+        // Client command comes while minds decide, step to the old target is not taken
+        const UnitId unitId = UnitList::NewUnit(*tiles[0], zebra).GetUnitId();
+        Mind* mind = MindList::GetFreeMind();
+        mind->SetFree(false);
+        mind->SetCommand(*tiles[tiles.size() / 2]);
+        MindList::DecideMoves(1);
+        mind->SetCommand(*tiles[0]);
+        MindList::ApplyMoves();
+        TS_ASSERT_EQUALS(&UnitList::GetUnit(unitId)->GetUnitTile(), tiles[0]);
+
+        UnitList::Clear();
+        MindList::Clear();
+        FlowFieldList::Clear();
+        PathFinder::Clear();
+        for (size_t i = 0; i < tiles.size(); ++i)
+        {
+            delete tiles[i];
+        }
+        delete grid;
+    }
+
+    void TestSameTarget()
+    {
+        ServerGeodesicGrid::Tiles tiles;
+        ServerGeodesicGrid* grid = new ServerGeodesicGrid(tiles, 1);
+        for (size_t i = 0; i < tiles.size(); ++i)
+        {
+            tiles[i]->SetHeight(0);
+        }
+        PathFinder::Init(tiles, grid->GetAdjacency(), 1);
+        FlowFieldList::Init(tiles, grid->GetAdjacency());
+        UnitClass zebra(0, 100, 1);
+
+        // Two minds one step away from the same tile move there on one update
+        ServerTile& target = tiles[0]->GetNeighbour(0);
+        ServerTile& other = &target.GetNeighbour(0) == tiles[0] ? target.GetNeighbour(1) : target.GetNeighbour(0);
+        const UnitId first = UnitList::NewUnit(*tiles[0], zebra).GetUnitId();
+        const UnitId second = UnitList::NewUnit(other, zebra).GetUnitId();
+        for (int32 i = 0; i < 2; ++i)
+        {
+            Mind* mind = MindList::GetFreeMind();
+            mind->SetFree(false);
+            mind->SetCommand(target);
+        }
+        ChangeList::CommitTurn();
+        MindList::UpdateMinds(1);
+        TS_ASSERT_EQUALS(&UnitList::GetUnit(first)->GetUnitTile(), &target);
+        TS_ASSERT_EQUALS(&UnitList::GetUnit(second)->GetUnitTile(), &target);
+
+        // Lower slot enters first
+        ChangeList::CommitTurn();
+        std::vector<ChangeList::Turn::UnitChange> changes;
+        ChangeList::GetTurnChanges(ChangeList::GetTurn() - 1)->GetUnitChanges(changes);
+        std::vector<UnitId> entered;
+        for (size_t i = 0; i < changes.size(); ++i)
+        {
+            if (changes[i].mTileId == target.GetTileId() && changes[i].mEntered)
+            {
+                entered.push_back(changes[i].mUnitId);
+            }
+        }
+        TS_ASSERT_EQUALS(entered.size(), size_t(2));
+        TS_ASSERT(UnitList::GetIndex(first) < UnitList::GetIndex(second));
+        TS_ASSERT(entered.size() == 2 && entered[0] == first && entered[1] == second);
+
+        UnitList::Clear();
+        MindList::Clear();
+        FlowFieldList::Clear();
+        PathFinder::Clear();
+        for (size_t i = 0; i < tiles.size(); ++i)
+        {
+            delete tiles[i];
+        }
+        delete grid;
+    }
+
+    void TestRefusedMoveIsRetried()
+    {
+        ServerGeodesicGrid::Tiles tiles;
+        ServerGeodesicGrid* grid = new ServerGeodesicGrid(tiles, 1);
+        for (size_t i = 0; i < tiles.size(); ++i)
+        {
+            tiles[i]->SetHeight(0);
+        }
+        PathFinder::Init(tiles, grid->GetAdjacency(), 1);
+        FlowFieldList::Init(tiles, grid->GetAdjacency());
+        UnitClass zebra(0, 100, 1);
+
+        // Target flooded between decision and move keeps the command
+        ServerTile& target = tiles[0]->GetNeighbour(0);
+        const UnitId unitId = UnitList::NewUnit(*tiles[0], zebra).GetUnitId();
+        Mind* mind = MindList::GetFreeMind();
+        mind->SetFree(false);
+        mind->SetCommand(target);
+        MindList::DecideMoves(1);
+        target.SetHeight(1000);
+        MindList::ApplyMoves();
+        TS_ASSERT_EQUALS(&UnitList::GetUnit(unitId)->GetUnitTile(), tiles[0]);
+        TS_ASSERT_EQUALS(MindList::GetTarget(UnitList::GetIndex(unitId)), &target);
+
+        UnitList::Clear();
+        MindList::Clear();
+        FlowFieldList::Clear();
+        PathFinder::Clear();
+        for (size_t i = 0; i < tiles.size(); ++i)
+        {
+            delete tiles[i];
+        }
+        delete grid;
+    }
+
+    void TestParallelSameAsSerial()
+    {
+        const std::vector<TileId> serial = RunMinds(1);
+        TS_ASSERT(serial == RunMinds(4));
+        TS_ASSERT(serial == RunMinds(3));
+    }
+
+private:
 };
 
 
@@ -8,6 +8,7 @@
 #include <cstdlib>
 #include <ChangeList.h>
 #include <DummyNetwork.h>
+#include <PayloadBuilder.h>
 #include <Exceptions.h>
 
 class MyTestSuite : public CxxTest::TestSuite
@@ -16,6 +17,7 @@ public:
     void setUp()
     {
         mNetwork = new DummyNetwork();
+        mBuilder = new PayloadBuilder(*mNetwork, FLAGS_max_payload_size);
         mChangeList1 = new ChangeList();
         mChangeList2 = new ChangeList();
         mChangeList2->SetTileId(2);
@@ -24,6 +26,7 @@ public:
 
     void tearDown()
     {
+        delete mBuilder;
         delete mNetwork;
         delete mChangeList1;
         delete mChangeList2;
@@ -36,9 +39,10 @@ public:
         {
             mChangeList1->AddRemove(i);
         }
-        mChangeList1->Commit();
-        VisibleTiles visibleTiels;
-        mChangeList1->Write(*mNetwork, 0, visibleTiels);
+        ChangeList::CommitTurn();
+        VisibleTiles visibleTiels(10);
+        ChangeList::GetTurnChanges(ChangeList::GetTurn() - 1)->Write(*mBuilder, 1, visibleTiels);
+        mBuilder->Flush();
 
         TS_ASSERT_EQUALS(mNetwork->GetChangesWrited(), count);
         TS_ASSERT_EQUALS(mNetwork->GetWrites(), 1);
@@ -47,10 +51,11 @@ public:
     void TestLeave()
     {
         mChangeList1->AddLeave(1, 2);
-        mChangeList1->Commit();
-        VisibleTiles visibleTiels;
-        visibleTiels.insert(1);
-        mChangeList1->Write(*mNetwork, 0, visibleTiels);
+        ChangeList::CommitTurn();
+        VisibleTiles visibleTiels(10);
+        visibleTiels.set(1);
+        ChangeList::GetTurnChanges(ChangeList::GetTurn() - 1)->Write(*mBuilder, 1, visibleTiels);
+        mBuilder->Flush();
 
         TS_ASSERT_EQUALS(mNetwork->GetChangesWrited(), 1);
         TS_ASSERT_EQUALS(mNetwork->GetWrites(), 1);
@@ -59,10 +64,11 @@ public:
     void TestEnter()
     {
         mChangeList1->AddEnter(1, 1, 2);
-        mChangeList1->Commit();
-        VisibleTiles visibleTiels;
-        visibleTiels.insert(1);
-        mChangeList1->Write(*mNetwork, 0, visibleTiels);
+        ChangeList::CommitTurn();
+        VisibleTiles visibleTiels(10);
+        visibleTiels.set(1);
+        ChangeList::GetTurnChanges(ChangeList::GetTurn() - 1)->Write(*mBuilder, 1, visibleTiels);
+        mBuilder->Flush();
 
         TS_ASSERT_EQUALS(mNetwork->GetChangesWrited(), 1);
         TS_ASSERT_EQUALS(mNetwork->GetWrites(), 1);
@@ -73,13 +79,14 @@ public:
     void TestChangeListTwoTimes()
     {
         mChangeList1->AddRemove(0);
-        mChangeList1->Commit();
+        ChangeList::CommitTurn();
         mChangeList1->AddRemove(1);
-        mChangeList1->Commit();
+        ChangeList::CommitTurn();
         mChangeList1->AddRemove(2);
-        mChangeList1->Commit();
-        VisibleTiles visibleTiels;
-        mChangeList1->Write(*mNetwork, 0, visibleTiels);
+        ChangeList::CommitTurn();
+        VisibleTiles visibleTiels(10);
+        ChangeList::GetTurnChanges(ChangeList::GetTurn() - 1)->Write(*mBuilder, 1, visibleTiels);
+        mBuilder->Flush();
 
 
         TS_ASSERT_EQUALS(mNetwork->GetChangesWrited(), 1);
@@ -89,22 +96,134 @@ public:
     void TestChangeListClientWrong()
     {
         mChangeList1->AddRemove(0);
-        mChangeList1->Commit();
+        ChangeList::CommitTurn();
         mChangeList1->AddRemove(1);
-        mChangeList1->Commit();
-        VisibleTiles visibleTiels;
-        TS_ASSERT_THROWS_ANYTHING(mChangeList1->Write(*mNetwork, 2, visibleTiels));
+        ChangeList::CommitTurn();
+        VisibleTiles visibleTiels(10);
+        TS_ASSERT_THROWS_ANYTHING(ChangeList::GetTurnChanges(ChangeList::GetTurn())->Write(*mBuilder, 1, visibleTiels));
 
 
         TS_ASSERT_EQUALS(mNetwork->GetChangesWrited(), 0);
         TS_ASSERT_EQUALS(mNetwork->GetWrites(), 0);
     }
 
+    void TestEnterVisibleFrom()
+    {
+        mChangeList1->AddEnter(1, 7, 5);
+        ChangeList::CommitTurn();
+        VisibleTiles visibleTiels(10);
+        ChangeList::GetTurnChanges(ChangeList::GetTurn() - 1)->Write(*mBuilder, 1, visibleTiels);
+        mBuilder->Flush();
+        visibleTiels.set(5);
+        ChangeList::GetTurnChanges(ChangeList::GetTurn() - 1)->Write(*mBuilder, 1, visibleTiels);
+        mBuilder->Flush();
+
+        TS_ASSERT_EQUALS(mNetwork->GetMessages().size(), 2);
+        const UnitEnterMsg& hidden = mNetwork->GetMessages().at(0).changes(0).unitenter();
+        const UnitEnterMsg& visible = mNetwork->GetMessages().at(1).changes(0).unitenter();
+        TS_ASSERT_EQUALS(hidden.unitid(), 1);
+        TS_ASSERT_EQUALS(hidden.to(), 1);
+        TS_ASSERT_EQUALS(hidden.visualcode(), 7);
+        TS_ASSERT_EQUALS(visible.unitid(), 1);
+        TS_ASSERT(!visible.has_visualcode());
+        TS_ASSERT(!mNetwork->GetMessages().at(0).last());
+    }
+
+    void TestInterleavedTiles()
+    {
+        mChangeList1->AddRemove(1);
+        mChangeList2->AddRemove(2);
+        mChangeList1->AddRemove(3);
+        mChangeList2->AddRemove(4);
+        ChangeList::CommitTurn();
+        VisibleTiles visibleTiels(10);
+        ChangeList::GetTurnChanges(ChangeList::GetTurn() - 1)->Write(*mBuilder, 2, visibleTiels);
+        mBuilder->Flush();
+
+        TS_ASSERT_EQUALS(mNetwork->GetMessages().size(), 1);
+        const PayloadMsg& msg = mNetwork->GetMessages().at(0);
+        TS_ASSERT_EQUALS(msg.changes_size(), 2);
+        TS_ASSERT_EQUALS(msg.changes(0).remove().unitid(), 2);
+        TS_ASSERT_EQUALS(msg.changes(1).remove().unitid(), 4);
+    }
+
+    void TestPayloadSizeLimit()
+    {
+        const size_t maxSize = 64;
+        PayloadBuilder builder(*mNetwork, maxSize);
+        const int count = 200;
+        for (int i = 0; i < count; ++i)
+        {
+            ChangeMsg change;
+            change.mutable_remove()->set_unitid(i);
+            builder.Add(change);
+        }
+        builder.Flush();
+
+        TS_ASSERT_EQUALS(mNetwork->GetEncodedWrites(), 1);
+        TS_ASSERT_EQUALS(mNetwork->GetChangesWrited(), count);
+        TS_ASSERT(mNetwork->GetWrites() > 1);
+        TS_ASSERT(!mNetwork->IsLastWrited());
+        for (size_t i = 0; i < mNetwork->GetEncodedSizes().size(); ++i)
+        {
+            TS_ASSERT(mNetwork->GetEncodedSizes()[i] <= maxSize);
+        }
+        int unitId = 0;
+        for (size_t m = 0; m < mNetwork->GetMessages().size(); ++m)
+        {
+            const PayloadMsg& msg = mNetwork->GetMessages()[m];
+            for (int c = 0; c < msg.changes_size(); ++c)
+            {
+                TS_ASSERT_EQUALS(msg.changes(c).remove().unitid(), unitId++);
+            }
+        }
+
+        // Nothing is written for empty flush
+        builder.Flush();
+        TS_ASSERT_EQUALS(mNetwork->GetEncodedWrites(), 1);
+    }
+
+    void TestTurnWithoutChanges()
+    {
+        mChangeList1->AddRemove(0);
+        ChangeList::CommitTurn();
+        ChangeList::CommitTurn();
+        const uint32 turn = ChangeList::GetTurn();
+        TS_ASSERT(!HasChanges(*ChangeList::GetTurnChanges(turn - 1), 1));
+        TS_ASSERT(HasChanges(*ChangeList::GetTurnChanges(turn - 2), 1));
+        TS_ASSERT(!HasChanges(*ChangeList::GetTurnChanges(turn - 2), 2));
+        const ChangeList::TurnPtr held = ChangeList::GetTurnChanges(turn - 2);
+
+        for (int i = 0; i < FLAGS_max_change_list_size; ++i)
+        {
+            ChangeList::CommitTurn();
+        }
+        TS_ASSERT_THROWS_ANYTHING(HasChanges(*ChangeList::GetTurnChanges(turn - 2), 1));
+        // Held turn is not reused when it leaves the history
+        TS_ASSERT(HasChanges(*held, 1));
+        TS_ASSERT(!HasChanges(*held, 2));
+    }
 
 private:
+    // Turn has a change on the tile
+    static bool HasChanges(const ChangeList::Turn& aTurn, TileId aTileId)
+    {
+        std::vector<ChangeList::Turn::UnitChange> changes;
+        aTurn.GetUnitChanges(changes);
+        for (size_t i = 0; i < changes.size(); ++i)
+        {
+            if (changes[i].mTileId == aTileId)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
     DummyNetwork* mNetwork;
     ChangeList* mChangeList1;
     ChangeList* mChangeList2;
+    PayloadBuilder* mBuilder;
 };
 
 
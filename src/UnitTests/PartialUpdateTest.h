@@ -14,12 +14,15 @@ class PartialUpdateTest: public CxxTest::TestSuite
 public:
     void setUp()
     {
-        ServerGeodesicGrid grid(mTiles, 2);
+        mGrid = new ServerGeodesicGrid(mTiles, 2);
+        mRings = new KRingCache(mGrid->GetAdjacency(), 16);
         mUnitClass = new UnitClass(0, 0, 0);
         mUnit = &UnitList::NewUnit(*mTiles.at(0), *mUnitClass);
         mStranger = &UnitList::NewUnit(*mTiles.at(42), *mUnitClass);
+        // Clients are connected after the units are created
+        ChangeList::CommitTurn();
         mNetwork = new DummyNetwork();
-        mFOV = new ClientFOV(*mNetwork, mTiles, mUnit->GetUnitId());
+        mFOV = new ClientFOV(*mNetwork, mTiles, *mRings, mUnit->GetUnitId());
     }
 
     void tearDown()
@@ -28,28 +31,31 @@ public:
         delete mUnitClass;
         delete mNetwork;
         delete mFOV;
+        mSnapshot.reset();
         ServerGeodesicGrid::Tiles::iterator it = mTiles.begin();
         for (;it != mTiles.end(); ++it)
         {
             delete *it;
         }
         mTiles.clear();
+        delete mRings;
+        delete mGrid;
     }
 
     void TestClientFullUpdate()
     {
-        mFOV->WriteFullUpdate(1);
+        mFOV->WriteFullUpdate(Publish(), 1);
         TS_ASSERT_EQUALS(mNetwork->GetMessages().size(), 1);
 
         PayloadMsg showTiles;
         showTiles.set_last(false);
 
-        AddShowTile(showTiles, 0, mTiles);
-        AddShowTile(showTiles, 163, mTiles);
-        AddShowTile(showTiles, 167, mTiles);
-        AddShowTile(showTiles, 171, mTiles);
-        AddShowTile(showTiles, 175, mTiles);
-        AddShowTile(showTiles, 179, mTiles);
+        AddShowTile(showTiles, 0, mTiles, *mSnapshot);
+        AddShowTile(showTiles, 163, mTiles, *mSnapshot);
+        AddShowTile(showTiles, 167, mTiles, *mSnapshot);
+        AddShowTile(showTiles, 171, mTiles, *mSnapshot);
+        AddShowTile(showTiles, 175, mTiles, *mSnapshot);
+        AddShowTile(showTiles, 179, mTiles, *mSnapshot);
 
         //std::cout << mNetwork->GetMessages().at(0).DebugString() << std::endl;
         //std::cout << showTiles.DebugString();
@@ -59,30 +65,24 @@ public:
 
     void TestEmptyPartialUpdate()
     {
-        mFOV->WriteFullUpdate(1);
+        mFOV->WriteFullUpdate(Publish(), 1);
         TS_ASSERT_EQUALS(mNetwork->GetMessages().size(), 1);
 
-        for (ServerGeodesicGrid::Tiles::const_iterator i = mTiles.begin(); i != mTiles.end(); ++i)
-        {
-            (*i)->GetChangeList()->Commit();
-        }
+        ChangeList::CommitTurn();
 
-        mFOV->WritePartialUpdate(1, 1);
+        mFOV->WritePartialUpdate(Publish(), 1, 1);
         TS_ASSERT_EQUALS(mNetwork->GetMessages().size(), 1);
     }
 
     void TestMoveInPartialUpdate()
     {
-        mFOV->WriteFullUpdate(1);
+        mFOV->WriteFullUpdate(Publish(), 1);
         TS_ASSERT_EQUALS(mNetwork->GetMessages().size(), 1);
         mStranger->Move(*mTiles.at(163));
 
-        for (ServerGeodesicGrid::Tiles::const_iterator i = mTiles.begin(); i != mTiles.end(); ++i)
-        {
-            (*i)->GetChangeList()->Commit();
-        }
+        ChangeList::CommitTurn();
 
-        mFOV->WritePartialUpdate(1, 1);
+        mFOV->WritePartialUpdate(Publish(), 1, 1);
 
         TS_ASSERT_EQUALS(mNetwork->GetMessages().size(), 2);
 
@@ -103,68 +103,116 @@ public:
         //std::cout << mNetwork->GetMessages().at(3).DebugString() << std::endl;
     }
 
+    void TestCreatePartialUpdate()
+    {
+        mFOV->WriteFullUpdate(Publish(), 1);
+        TS_ASSERT_EQUALS(mNetwork->GetMessages().size(), 1);
+        const UnitId unitId = UnitList::NewUnit(*mTiles.at(163), *mUnitClass).GetUnitId();
+
+        ChangeList::CommitTurn();
+
+        mFOV->WritePartialUpdate(Publish(), 1, 1);
+
+        TS_ASSERT_EQUALS(mNetwork->GetMessages().size(), 2);
+
+        // Newborn comes as unit entering the tile, with visual code client has not seen
+        PayloadMsg createMsg;
+        ChangeMsg* change = createMsg.add_changes();
+        UnitEnterMsg* msg = change->mutable_unitenter();
+        msg->set_unitid(unitId);
+        msg->set_to(163);
+        msg->set_visualcode(0);
+        createMsg.set_last(false);
+
+        TS_ASSERT(mNetwork->GetMessages().at(1) == createMsg);
+    }
+
     void TestClientMovePartialUpdate()
     {
-        mFOV->WriteFullUpdate(1);
+        mFOV->WriteFullUpdate(Publish(), 1);
         TS_ASSERT_EQUALS(mNetwork->GetMessages().size(), 1);
         mUnit->Move(*mTiles.at(163));
 
-        for (ServerGeodesicGrid::Tiles::const_iterator i = mTiles.begin(); i != mTiles.end(); ++i)
-        {
-            (*i)->GetChangeList()->Commit();
-        }
+        ChangeList::CommitTurn();
 
-        mFOV->WritePartialUpdate(1, 1);
+        mFOV->WritePartialUpdate(Publish(), 1, 1);
 
-        TS_ASSERT_EQUALS(mNetwork->GetMessages().size(), 4);
+        // Shown and hidden tiles and changes come in one message
+        TS_ASSERT_EQUALS(mNetwork->GetMessages().size(), 2);
 
         PayloadMsg showHideMsg;
-        AddShowTile(showHideMsg, 42, mTiles);
-        AddShowTile(showHideMsg, 403, mTiles);
-        AddShowTile(showHideMsg, 404, mTiles);
+        AddShowTile(showHideMsg, 42, mTiles, *mSnapshot);
+        AddShowTile(showHideMsg, 403, mTiles, *mSnapshot);
+        AddShowTile(showHideMsg, 404, mTiles, *mSnapshot);
         AddHideTile(showHideMsg, 167);
         AddHideTile(showHideMsg, 171);
         showHideMsg.set_last(false);
 
-        TS_ASSERT(mNetwork->GetMessages().at(1) == showHideMsg);
-
-        PayloadMsg enterMsg;
-        ChangeMsg* change = enterMsg.add_changes();
+        // Leave to visible tile is empty
+        showHideMsg.add_changes();
+        ChangeMsg* change = showHideMsg.add_changes();
         UnitEnterMsg* msg = change->mutable_unitenter();
         msg->set_unitid(mUnit->GetUnitId());
         msg->set_to(163);
-        enterMsg.set_last(false);
 
-        TS_ASSERT(mNetwork->GetMessages().at(3) == enterMsg);
+        TS_ASSERT(mNetwork->GetMessages().at(1) == showHideMsg);
 
         //std::cout << showHideMsg.DebugString() << std::endl;
 
         //std::cout << mNetwork->GetMessages().at(1).DebugString() << std::endl;
-        //std::cout << mNetwork->GetMessages().at(2).DebugString() << std::endl;
-        //std::cout << mNetwork->GetMessages().at(3).DebugString() << std::endl;
+    }
+
+    void TestWalkPartialUpdate()
+    {
+        const int32 radius = 4;
+        mFOV->WriteFullUpdate(Publish(), radius);
+        KRingPtr previous = KRingCache::CalcRing(mGrid->GetAdjacency(), mUnit->GetUnitTile().GetTileId(), radius);
+        // Walk in steps to neighbours, each step must show and hide exactly the difference of rings
+        for (size_t step = 0; step < 20; ++step)
+        {
+            ServerTile& from = mUnit->GetUnitTile();
+            mUnit->Move(from.GetNeighbour(step % from.GetNeighbourCount()));
+            ChangeList::CommitTurn();
+            const size_t before = mNetwork->GetMessages().size();
+            mFOV->WritePartialUpdate(Publish(), 0, radius);
+
+            const KRingPtr current = KRingCache::CalcRing(mGrid->GetAdjacency(), mUnit->GetUnitTile().GetTileId(), radius);
+            PayloadMsg expected;
+            expected.set_last(false);
+            std::vector<TileId> difference;
+            std::set_difference(current->mTiles.begin(), current->mTiles.end(), previous->mTiles.begin(), previous->mTiles.end(), std::back_inserter(difference));
+            for (size_t i = 0; i < difference.size(); ++i)
+            {
+                AddShowTile(expected, difference[i], mTiles, *mSnapshot);
+            }
+            difference.clear();
+            std::set_difference(previous->mTiles.begin(), previous->mTiles.end(), current->mTiles.begin(), current->mTiles.end(), std::back_inserter(difference));
+            for (size_t i = 0; i < difference.size(); ++i)
+            {
+                AddHideTile(expected, difference[i]);
+            }
+
+            TS_ASSERT_EQUALS(mNetwork->GetMessages().size(), before + 1);
+            TS_ASSERT(mNetwork->GetMessages().back() == expected);
+            previous = current;
+        }
     }
 
     void TestLeavePartialUpdate()
     {
         mStranger->Move(*mTiles.at(163));
 
-        for (ServerGeodesicGrid::Tiles::const_iterator i = mTiles.begin(); i != mTiles.end(); ++i)
-        {
-            (*i)->GetChangeList()->Commit();
-        }
+        ChangeList::CommitTurn();
 
-        mFOV->WriteFullUpdate(1);
+        mFOV->WriteFullUpdate(Publish(), 1);
 
         TS_ASSERT_EQUALS(mNetwork->GetMessages().size(), 1);
 
         mStranger->Move(*mTiles.at(42));
 
-        for (ServerGeodesicGrid::Tiles::const_iterator i = mTiles.begin(); i != mTiles.end(); ++i)
-        {
-            (*i)->GetChangeList()->Commit();
-        }
+        ChangeList::CommitTurn();
 
-        mFOV->WritePartialUpdate(1, 1);
+        mFOV->WritePartialUpdate(Publish(), 1, 1);
 
         TS_ASSERT_EQUALS(mNetwork->GetMessages().size(), 2);
 
@@ -184,13 +232,127 @@ public:
         //std::cout << mNetwork->GetMessages().at(3).DebugString() << std::endl;
     }
 
+    void TestResyncAfterDrop()
+    {
+        ServerUnit& passer = UnitList::NewUnit(*mTiles.at(0), *mUnitClass);
+        ServerUnit& leaver = UnitList::NewUnit(*mTiles.at(167), *mUnitClass);
+        ChangeList::CommitTurn();
+        mFOV->WriteFullUpdate(Publish(), 1);
+        ClientView client;
+        Apply(client, 0);
+
+        // Avatar steps away, the update with it is dropped
+        mUnit->Move(*mTiles.at(163));
+        ChangeList::CommitTurn();
+        const size_t dropped = mNetwork->GetMessages().size();
+        mFOV->WritePartialUpdate(Publish(), 1, 1);
+        TS_ASSERT(mNetwork->GetMessages().size() > dropped);
+        mFOV->Rollback();
+
+        // Units leave tiles client has, to tiles it will and will not see
+        passer.Move(*mTiles.at(167));
+        leaver.Move(*mTiles.at(175));
+        ChangeList::CommitTurn();
+        const size_t resync = mNetwork->GetMessages().size();
+        mFOV->WriteFullUpdate(Publish(), 1);
+        Apply(client, resync);
+
+        // Client has exactly what server sees around the avatar
+        ClientView server;
+        const KRingPtr ring = KRingCache::CalcRing(mGrid->GetAdjacency(), 163, 1);
+        for (TileRing::const_iterator n = ring->mTiles.begin(); n != ring->mTiles.end(); ++n)
+        {
+            server.mTiles.insert(*n);
+            const WorldSnapshot::UnitIterator end = mSnapshot->GetUnitsEnd(*n);
+            for (WorldSnapshot::UnitIterator i = mSnapshot->GetUnitsBegin(*n); i != end; ++i)
+            {
+                server.mUnits[i->mUnitId] = *n;
+            }
+        }
+        TS_ASSERT(client.mTiles == server.mTiles);
+        TS_ASSERT(client.mUnits == server.mUnits);
+        TS_ASSERT(!client.mUnits.count(passer.GetUnitId()));
+        TS_ASSERT_EQUALS(client.mUnits[leaver.GetUnitId()], 175);
+    }
+
 private:
+    // Tiles and units client has, changed as ClientGame changes them
+    struct ClientView
+    {
+        std::set<TileId> mTiles;
+        std::map<UnitId, TileId> mUnits;
+
+        void ClearTile(TileId aTileId)
+        {
+            std::map<UnitId, TileId>::iterator i = mUnits.begin();
+            while (i != mUnits.end())
+            {
+                if (i->second == aTileId)
+                {
+                    mUnits.erase(i++);
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+        }
+    };
+
+    // Applies messages written from aFirst on
+    void Apply(ClientView& aView, size_t aFirst) const
+    {
+        const std::vector<PayloadMsg>& messages = mNetwork->GetMessages();
+        for (size_t m = aFirst; m < messages.size(); ++m)
+        {
+            for (int i = 0; i < messages[m].changes_size(); ++i)
+            {
+                const ChangeMsg& change = messages[m].changes(i);
+                if (change.has_unitenter())
+                {
+                    const UnitEnterMsg& enter = change.unitenter();
+                    if (enter.has_visualcode() || aView.mUnits.count(enter.unitid()))
+                    {
+                        aView.mUnits[enter.unitid()] = enter.to();
+                    }
+                }
+                if (change.has_unitleave())
+                {
+                    aView.mUnits.erase(change.unitleave().unitid());
+                }
+                if (change.has_remove())
+                {
+                    aView.mUnits.erase(change.remove().unitid());
+                }
+                if (change.has_showtile())
+                {
+                    aView.ClearTile(change.showtile().tileid());
+                    aView.mTiles.insert(change.showtile().tileid());
+                }
+                if (change.has_hidetile())
+                {
+                    aView.ClearTile(change.hidetile().tileid());
+                    aView.mTiles.erase(change.hidetile().tileid());
+                }
+            }
+        }
+    }
+
+    const WorldSnapshot& Publish()
+    {
+        mSnapshot.reset(new WorldSnapshot(mTiles, mSnapshot.get(), 0));
+        return *mSnapshot;
+    }
+
     UnitClass* mUnitClass;
     ServerUnit* mUnit;
     ServerUnit* mStranger;
     DummyNetwork* mNetwork;
     ClientFOV* mFOV;
+    WorldSnapshotPtr mSnapshot;
     ServerGeodesicGrid::Tiles mTiles;
+    ServerGeodesicGrid* mGrid;
+    KRingCache* mRings;
 };
 
 
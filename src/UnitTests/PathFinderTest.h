@@ -0,0 +1,164 @@
+#ifndef PATHFINDERTEST_H_INCLUDED
+#define PATHFINDERTEST_H_INCLUDED
+
+#include <cxxtest/TestSuite.h>
+#include <ServerGeodesicGrid.h>
+#include <PathFinder.h>
+
+class PathFinderTest: public CxxTest::TestSuite
+{
+public:
+    void setUp()
+    {
+        mGrid = new ServerGeodesicGrid(mTiles, 3);
+        for (size_t i = 0; i < mTiles.size(); ++i)
+        {
+            mTiles[i]->SetHeight(0);
+        }
+        PathFinder::Init(mTiles, mGrid->GetAdjacency(), 3);
+    }
+
+    void tearDown()
+    {
+        PathFinder::Clear();
+        for (size_t i = 0; i < mTiles.size(); ++i)
+        {
+            delete mTiles[i];
+        }
+        mTiles.clear();
+        delete mGrid;
+    }
+
+    // Steps of the shortest path over tiles which can be entered, -1 if there is none
+    int32 CalcDistance(TileId aFrom, TileId aTo)
+    {
+        std::vector<int32> distances(mTiles.size(), -1);
+        std::vector<TileId> queue(1, aFrom);
+        distances[aFrom] = 0;
+        for (size_t q = 0; q < queue.size(); ++q)
+        {
+            const ServerTile& tile = *mTiles[queue[q]];
+            for (size_t n = 0; n < tile.GetNeighbourCount(); ++n)
+            {
+                const TileId neighbour = tile.GetNeighbourId(n);
+                if (distances[neighbour] < 0 && mTiles[neighbour]->CanEnter())
+                {
+                    distances[neighbour] = distances[queue[q]] + 1;
+                    queue.push_back(neighbour);
+                }
+            }
+        }
+        return distances[aTo];
+    }
+
+    bool IsValid(TileId aFrom, TileId aTo, const PathFinder::Path& aPath)
+    {
+        if (aPath.empty() || aPath.front() != aTo)
+        {
+            return aPath.empty() && aFrom == aTo;
+        }
+        TileId current = aFrom;
+        for (PathFinder::Path::const_reverse_iterator i = aPath.rbegin(); i != aPath.rend(); ++i)
+        {
+            const ServerTile& tile = *mTiles[current];
+            bool isNeighbour = false;
+            for (size_t n = 0; n < tile.GetNeighbourCount(); ++n)
+            {
+                isNeighbour = isNeighbour || tile.GetNeighbourId(n) == *i;
+            }
+            if (!isNeighbour || !mTiles[*i]->CanEnter())
+            {
+                return false;
+            }
+            current = *i;
+        }
+        return true;
+    }
+
+    // Long paths are kept inside found regions, so they can be a bit longer
+    void CheckLength(const PathFinder::Path& aPath, int32 aDistance)
+    {
+        TS_ASSERT_LESS_THAN_EQUALS(aDistance, int32(aPath.size()));
+        TS_ASSERT_LESS_THAN_EQUALS(int32(aPath.size()), aDistance + aDistance / 3);
+    }
+
+    void CheckPaths()
+    {
+        for (TileId from = 0; from < mTiles.size(); from += 97)
+        {
+            for (TileId to = 5; to < mTiles.size(); to += 131)
+            {
+                if (!mTiles[from]->CanEnter())
+                {
+                    continue;
+                }
+                const int32 distance = CalcDistance(from, to);
+                PathFinder::Path path;
+                const bool found = PathFinder::FindPath(from, to, path);
+                TS_ASSERT_EQUALS(found, from == to || distance >= 0);
+                if (found)
+                {
+                    TS_ASSERT(IsValid(from, to, path));
+                    CheckLength(path, from == to ? 0 : distance);
+                }
+            }
+        }
+    }
+
+    void TestShortestOnLand()
+    {
+        CheckPaths();
+    }
+
+    void TestAroundWater()
+    {
+        // Band of water along the equator with a single gap, and scattered lakes
+        for (size_t i = 0; i < mTiles.size(); ++i)
+        {
+            const Ogre::Vector3 direction = mTiles[i]->GetPosition().normalisedCopy();
+            if ((std::abs(direction.y) < 0.1f && direction.x < 0.9f) || i % 7 == 3)
+            {
+                mTiles[i]->SetHeight(1000);
+            }
+        }
+        CheckPaths();
+    }
+
+    void TestTerrainChange()
+    {
+        const TileId from = 100;
+        const TileId to = 2000;
+        PathFinder::Path path;
+        TS_ASSERT(PathFinder::FindPath(from, to, path));
+
+        // Block the middle of the path
+        const TileId blocked = path[path.size() / 2];
+        mTiles[blocked]->SetHeight(1000);
+        TS_ASSERT(PathFinder::FindPath(from, to, path));
+        TS_ASSERT(IsValid(from, to, path));
+        TS_ASSERT(std::find(path.begin(), path.end(), blocked) == path.end());
+        CheckLength(path, CalcDistance(from, to));
+
+        // Target under water
+        mTiles[to]->SetHeight(1000);
+        TS_ASSERT(!PathFinder::FindPath(from, to, path));
+    }
+
+    void TestRegions()
+    {
+        // Tiles of the coarse level are their own regions
+        for (TileId i = 0; i < 42; ++i)
+        {
+            TS_ASSERT_EQUALS(PathFinder::GetRegion(i), i);
+        }
+        for (TileId i = 42; i < mTiles.size(); ++i)
+        {
+            TS_ASSERT_LESS_THAN(PathFinder::GetRegion(i), TileId(42));
+        }
+    }
+private:
+    ServerGeodesicGrid::Tiles mTiles;
+    ServerGeodesicGrid* mGrid;
+};
+
+#endif // PATHFINDERTEST_H_INCLUDED
@@ -0,0 +1,74 @@
+#ifndef RANDOMSTREAMTEST_H_INCLUDED
+#define RANDOMSTREAMTEST_H_INCLUDED
+
+#include <cxxtest/TestSuite.h>
+#include <RandomStream.h>
+
+class RandomStreamTest: public CxxTest::TestSuite
+{
+public:
+    void TestPhilox()
+    {
+        // Known answers of Philox4x32-10 from Random123
+        const uint32 zeros[4] = { 0, 0, 0, 0 };
+        const uint32 ones[4] = { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF };
+        const uint32 piCounter[4] = { 0x243F6A88, 0x85A308D3, 0x13198A2E, 0x03707344 };
+        const uint32 piKey[2] = { 0xA4093822, 0x299F31D0 };
+        uint32 result[4];
+
+        RandomStream::Philox(zeros, zeros, result);
+        TS_ASSERT_EQUALS(result[0], 0x6627E8D5u);
+        TS_ASSERT_EQUALS(result[1], 0xE169C58Du);
+        TS_ASSERT_EQUALS(result[2], 0xBC57AC4Cu);
+        TS_ASSERT_EQUALS(result[3], 0x9B00DBD8u);
+
+        RandomStream::Philox(ones, ones, result);
+        TS_ASSERT_EQUALS(result[0], 0x408F276Du);
+        TS_ASSERT_EQUALS(result[1], 0x41C83B0Eu);
+        TS_ASSERT_EQUALS(result[2], 0xA20BC7C6u);
+        TS_ASSERT_EQUALS(result[3], 0x6D5451FDu);
+
+        RandomStream::Philox(piCounter, piKey, result);
+        TS_ASSERT_EQUALS(result[0], 0xD16CFE09u);
+        TS_ASSERT_EQUALS(result[1], 0x94FDCCEBu);
+        TS_ASSERT_EQUALS(result[2], 0x5001E420u);
+        TS_ASSERT_EQUALS(result[3], 0x24126EA1u);
+    }
+
+    void TestReproducible()
+    {
+        RandomStream a(1, 100, RandomStream::MIND_MOVE, 5);
+        RandomStream b(1, 100, RandomStream::MIND_MOVE, 5);
+        RandomStream otherTick(1, 100, RandomStream::MIND_MOVE, 6);
+        RandomStream otherPurpose(1, 100, RandomStream::POPULATION, 5);
+        size_t sameTick = 0;
+        size_t samePurpose = 0;
+        for (int32 i = 0; i < 10; ++i)
+        {
+            const uint32 value = a.Next();
+            TS_ASSERT_EQUALS(value, b.Next());
+            sameTick += value == otherTick.Next();
+            samePurpose += value == otherPurpose.Next();
+        }
+        TS_ASSERT_EQUALS(sameTick, size_t(0));
+        TS_ASSERT_EQUALS(samePurpose, size_t(0));
+    }
+
+    void TestBound()
+    {
+        std::vector<int32> counts(6, 0);
+        for (uint32 unit = 0; unit < 6000; ++unit)
+        {
+            const uint32 value = RandomStream(7, unit, RandomStream::MIND_MOVE, 1).Next(6);
+            TS_ASSERT_LESS_THAN(value, 6u);
+            ++counts[std::min(value, 5u)];
+        }
+        for (size_t i = 0; i < counts.size(); ++i)
+        {
+            TS_ASSERT_LESS_THAN(800, counts[i]);
+            TS_ASSERT_LESS_THAN(counts[i], 1200);
+        }
+    }
+};
+
+#endif // RANDOMSTREAMTEST_H_INCLUDED
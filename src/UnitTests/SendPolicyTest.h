@@ -0,0 +1,100 @@
+#ifndef SENDPOLICYTEST_H_INCLUDED
+#define SENDPOLICYTEST_H_INCLUDED
+
+#include <cxxtest/TestSuite.h>
+#include <SendPolicy.h>
+
+class SendPolicyTest: public CxxTest::TestSuite
+{
+public:
+    void setUp()
+    {
+        mQueueSize = FLAGS_send_queue_size;
+        mPolicy = FLAGS_slow_client_policy;
+        mGrace = FLAGS_slow_client_grace;
+        FLAGS_send_queue_size = 100;
+        FLAGS_slow_client_policy = "disconnect";
+        FLAGS_slow_client_grace = 1000;
+    }
+
+    void tearDown()
+    {
+        FLAGS_send_queue_size = mQueueSize;
+        FLAGS_slow_client_policy = mPolicy;
+        FLAGS_slow_client_grace = mGrace;
+    }
+
+    void TestBudget()
+    {
+        SendPolicy policy;
+        // Nothing in flight, update is sent whatever its size
+        TS_ASSERT(!policy.ShouldDrop(1000, false));
+        TS_ASSERT(!policy.IsOverBudget(1000, false));
+        TS_ASSERT(!policy.ShouldDrop(99, true));
+        TS_ASSERT(policy.ShouldDrop(100, true));
+        TS_ASSERT(!policy.IsOverBudget(100, true));
+        TS_ASSERT(policy.IsOverBudget(101, true));
+    }
+
+    void TestResync()
+    {
+        SendPolicy policy;
+        TS_ASSERT(!policy.IsResync());
+        policy.Dropped(10);
+        TS_ASSERT(policy.IsResync());
+        // Full update waits for the queue to drain
+        TS_ASSERT(policy.ShouldDrop(0, true));
+        TS_ASSERT(!policy.ShouldDrop(0, false));
+        policy.Sent();
+        TS_ASSERT(!policy.IsResync());
+    }
+
+    void TestCongestion()
+    {
+        SendPolicy policy;
+        policy.Dropped(10);
+        TS_ASSERT(policy.IsCongested());
+        // Drain that lets the full update go keeps congestion
+        policy.Drained();
+        TS_ASSERT(policy.IsCongested());
+        policy.Sent();
+        TS_ASSERT(policy.IsCongested());
+        // Drop before the queue drains again
+        policy.Dropped(500);
+        policy.Drained();
+        policy.Sent();
+        TS_ASSERT(policy.IsCongested());
+        // Client caught up with everything sent since the last drop
+        policy.Drained();
+        TS_ASSERT(!policy.IsCongested());
+    }
+
+    void TestDisconnect()
+    {
+        SendPolicy policy;
+        TS_ASSERT(!policy.ShouldDisconnect(100000));
+        policy.Dropped(10);
+        TS_ASSERT(!policy.ShouldDisconnect(1009));
+        // Client which never keeps up is resynced between drops
+        policy.Drained();
+        policy.Sent();
+        policy.Dropped(900);
+        TS_ASSERT(policy.ShouldDisconnect(1010));
+        FLAGS_slow_client_policy = "resync";
+        TS_ASSERT(!policy.ShouldDisconnect(1010));
+    }
+
+    void TestCongestionAtClockStart()
+    {
+        SendPolicy policy;
+        policy.Dropped(0);
+        TS_ASSERT(policy.IsCongested());
+        TS_ASSERT(policy.ShouldDisconnect(1001));
+    }
+private:
+    int32 mQueueSize;
+    std::string mPolicy;
+    int32 mGrace;
+};
+
+#endif // SENDPOLICYTEST_H_INCLUDED
@@ -0,0 +1,177 @@
+#ifndef SERVERPROXYTEST_H_INCLUDED
+#define SERVERPROXYTEST_H_INCLUDED
+
+#include <cxxtest/TestSuite.h>
+#include <ServerGame.h>
+#include <ConnectionManager.h>
+#include <ClientConnection.h>
+#include <UserList.h>
+#include <ServerProxy.h>
+#include <ProtocolVersion.h>
+#include <openssl/srp.h>
+
+// Client proxy against a session served over loopback, client handlers run
+// in the test thread like in the client main loop
+class ServerProxyTest: public CxxTest::TestSuite
+{
+public:
+    void setUp()
+    {
+        mUpdateLength = FLAGS_update_length;
+        mPushWindow = FLAGS_push_window;
+        mAckInterval = FLAGS_ack_interval;
+        FLAGS_update_length = 1;
+        mGame = new ServerGame(1);
+        AddUser("test", "test", mGame->GetGameMutex());
+
+        mServerIO = new boost::asio::io_service();
+        mServerContext = new boost::asio::ssl::context(boost::asio::ssl::context::tlsv1_server);
+        TS_ASSERT(InitServerContext(*mServerContext));
+        mGate = new boost::asio::ip::tcp::acceptor(*mServerIO,
+            boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        ClientConnectionPtr connection(new ClientConnection(*mGame, *mServerIO, *mServerContext));
+        mGate->async_accept(connection->GetSocket(), boost::bind(&ClientConnection::Start, connection));
+        mServerThread = new boost::thread(boost::bind(&boost::asio::io_service::run, mServerIO));
+
+        mClientIO = new boost::asio::io_service();
+        mWork = new boost::asio::io_service::work(*mClientIO);
+        mClientContext = new boost::asio::ssl::context(boost::asio::ssl::context::tlsv1_client);
+        SSL_CTX* ctx = mClientContext->native_handle();
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+        // SRP ciphers of TLS 1.0 are below the default security level
+        SSL_CTX_set_security_level(ctx, 0);
+#endif
+        SSL_CTX_SRP_CTX_init(ctx);
+        SSL_CTX_set_cipher_list(ctx, "SRP");
+        SSL_CTX_set_srp_username(ctx, const_cast<char*>("test"));
+        SSL_CTX_set_srp_client_pwd_callback(ctx, GivePassword);
+        SSLStreamPtr socket(new SSLStream(*mClientIO, *mClientContext));
+        socket->lowest_layer().connect(mGate->local_endpoint());
+        socket->handshake(boost::asio::ssl::stream_base::client);
+        mProxy = new ServerProxy(socket);
+        mTime = 0;
+        mAvatar = 0;
+    }
+
+    void tearDown()
+    {
+        // Session closes when proxy shuts the stream down
+        delete mProxy;
+        delete mWork;
+        delete mClientContext;
+        delete mClientIO;
+        mServerIO->stop();
+        mServerThread->join();
+        delete mServerThread;
+        delete mGate;
+        delete mServerIO;
+        delete mServerContext;
+        delete mGame;
+        FLAGS_update_length = mUpdateLength;
+        FLAGS_push_window = mPushWindow;
+        FLAGS_ack_interval = mAckInterval;
+    }
+
+    void TestRequest()
+    {
+        Login();
+        PayloadPtr req(new PayloadMsg());
+        req->set_time(0);
+        mProxy->Request(boost::bind(&ServerProxyTest::OnPayloadMsg, this, _1), req);
+        TS_ASSERT(Pump(ServerGame::GetTime()));
+        TS_ASSERT(!mProxy->IsSubscribed());
+    }
+
+    void TestSubscribe()
+    {
+        FLAGS_push_window = 2;
+        FLAGS_ack_interval = 2;
+        Login();
+        mProxy->Subscribe(boost::bind(&ServerProxyTest::OnPayloadMsg, this, _1), 0);
+        TS_ASSERT(Pump(ServerGame::GetTime()));
+        TS_ASSERT(mProxy->IsSubscribed());
+
+        // Server stops after push_window updates unless they are acknowledged
+        for (int i = 0; i < 6; ++i)
+        {
+            mGame->Update();
+            ClientConnection::PushUpdates();
+            TS_ASSERT(Pump(ServerGame::GetTime()));
+        }
+
+        // Command is not answered, pushed updates go on
+        PayloadPtr command(new PayloadMsg());
+        command->mutable_commandmove()->set_position(0);
+        mProxy->Request(boost::bind(&ServerProxyTest::OnPayloadMsg, this, _1), command);
+        for (int i = 0; i < 3; ++i)
+        {
+            mGame->Update();
+            ClientConnection::PushUpdates();
+            TS_ASSERT(Pump(ServerGame::GetTime()));
+        }
+    }
+private:
+    static char* GivePassword(SSL* aSSL, void* aArg)
+    {
+        return BUF_strdup("test");
+    }
+
+    void OnPayloadMsg(ConstPayloadPtr aPayloadMsg)
+    {
+        if (aPayloadMsg->has_avatar())
+        {
+            mAvatar = aPayloadMsg->avatar();
+        }
+        if (aPayloadMsg->last() && aPayloadMsg->has_time())
+        {
+            mTime = aPayloadMsg->time();
+        }
+    }
+
+    void Login()
+    {
+        PayloadPtr req(new PayloadMsg());
+        req->set_protocolversion(PROTOCOL_VERSION);
+        mProxy->Request(boost::bind(&ServerProxyTest::OnPayloadMsg, this, _1), req);
+        for (int i = 0; i < 5000 && mAvatar == 0; ++i)
+        {
+            Poll();
+        }
+        TS_ASSERT(mAvatar != 0);
+    }
+
+    // Runs client handlers until update of aTime is received
+    bool Pump(GameTime aTime)
+    {
+        for (int i = 0; i < 5000 && mTime < aTime; ++i)
+        {
+            Poll();
+        }
+        return mTime == aTime;
+    }
+
+    void Poll()
+    {
+        if (!mClientIO->poll())
+        {
+            boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+        }
+    }
+
+    int32 mUpdateLength;
+    int32 mPushWindow;
+    int32 mAckInterval;
+    ServerGame* mGame;
+    boost::asio::io_service* mServerIO;
+    boost::asio::ssl::context* mServerContext;
+    boost::asio::ip::tcp::acceptor* mGate;
+    boost::thread* mServerThread;
+    boost::asio::io_service* mClientIO;
+    boost::asio::io_service::work* mWork;
+    boost::asio::ssl::context* mClientContext;
+    ServerProxy* mProxy;
+    GameTime mTime;
+    UnitId mAvatar;
+};
+
+#endif // SERVERPROXYTEST_H_INCLUDED
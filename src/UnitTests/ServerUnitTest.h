@@ -4,6 +4,7 @@
 #include <cxxtest/TestSuite.h>
 #include <ServerUnit.h>
 #include <ServerTile.h>
+#include <UnitList.h>
 #include <Ogre.h>
 #include <ChangeList.h>
 
@@ -12,15 +13,15 @@ class ServerUnitTest: public CxxTest::TestSuite
 public:
     void setUp()
     {
-        mClass = new UnitClass(0, 100, 1);
+        mClass = new UnitClass(0, 100, 0);
         mTile = new ServerTile(1, Ogre::Vector3::UNIT_X);
         mTile2 = new ServerTile(2, Ogre::Vector3::UNIT_Z);
-        mUnit = new ServerUnit(*mTile, *mClass, 1);
+        mUnit = &UnitList::NewUnit(*mTile, *mClass);
     }
 
     void tearDown()
     {
-        delete mUnit;
+        UnitList::Clear();
         delete mTile;
         delete mTile2;
         delete mClass;
@@ -32,11 +33,12 @@ public:
         TS_ASSERT(mTile->IsLastUnit(mTile->GetUnits()));
         TS_ASSERT_EQUALS(*mTile2->GetUnits(), mUnit->GetUnitId());
         TS_ASSERT_EQUALS(mTile2->GetTileId(), mUnit->GetUnitTile().GetTileId());
+        TS_ASSERT_EQUALS(&mUnit->GetClass(), mClass);
     }
 
     void TestDelete()
     {
-        delete mUnit;
+        UnitList::DeleteUnit(mUnit->GetUnitId());
         mUnit = NULL;
         TS_ASSERT(mTile->IsLastUnit(mTile->GetUnits()));
     }
@@ -0,0 +1,312 @@
+#ifndef SESSIONTEST_H_INCLUDED
+#define SESSIONTEST_H_INCLUDED
+
+#include <cxxtest/TestSuite.h>
+#include <ServerGame.h>
+#include <ConnectionManager.h>
+#include <ClientConnection.h>
+#include <UserList.h>
+#include <User.h>
+#include <UnitList.h>
+#include <ServerUnit.h>
+#include <MindList.h>
+#include <Network.h>
+#include <ProtocolVersion.h>
+#include <Header.pb.h>
+#include <openssl/srp.h>
+
+// Client sessions served over loopback, network thread runs the handlers
+class SessionTest: public CxxTest::TestSuite
+{
+public:
+    void setUp()
+    {
+        mUpdateLength = FLAGS_update_length;
+        mPushWindow = FLAGS_push_window;
+        mMaxRequestSize = FLAGS_max_request_size;
+        FLAGS_update_length = 1;
+        mGame = new ServerGame(1);
+        AddUser("test", "test", mGame->GetGameMutex());
+
+        mServerIO = new boost::asio::io_service();
+        mServerContext = new boost::asio::ssl::context(boost::asio::ssl::context::tlsv1_server);
+        TS_ASSERT(InitServerContext(*mServerContext));
+        mGate = new boost::asio::ip::tcp::acceptor(*mServerIO,
+            boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+        ClientConnectionPtr connection(new ClientConnection(*mGame, *mServerIO, *mServerContext));
+        mGate->async_accept(connection->GetSocket(), boost::bind(&ClientConnection::Start, connection));
+        mServerThread = new boost::thread(boost::bind(&boost::asio::io_service::run, mServerIO));
+
+        mClientIO = new boost::asio::io_service();
+        mClientContext = new boost::asio::ssl::context(boost::asio::ssl::context::tlsv1_client);
+        SSL_CTX* ctx = mClientContext->native_handle();
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+        // SRP ciphers of TLS 1.0 are below the default security level
+        SSL_CTX_set_security_level(ctx, 0);
+#endif
+        SSL_CTX_SRP_CTX_init(ctx);
+        SSL_CTX_set_cipher_list(ctx, "SRP");
+        SSL_CTX_set_srp_username(ctx, const_cast<char*>("test"));
+        SSL_CTX_set_srp_client_pwd_callback(ctx, GivePassword);
+        mSocket.reset(new SSLStream(*mClientIO, *mClientContext));
+        mSocket->lowest_layer().connect(mGate->local_endpoint());
+        mSocket->handshake(boost::asio::ssl::stream_base::client);
+        mNetwork = new Network(mSocket);
+    }
+
+    void tearDown()
+    {
+        delete mNetwork;
+        mSocket.reset();
+        delete mClientContext;
+        delete mClientIO;
+        mServerIO->stop();
+        mServerThread->join();
+        delete mServerThread;
+        delete mGate;
+        // Sessions left in handlers go with the io service
+        delete mServerIO;
+        delete mServerContext;
+        delete mGame;
+        FLAGS_update_length = mUpdateLength;
+        FLAGS_push_window = mPushWindow;
+        FLAGS_max_request_size = mMaxRequestSize;
+    }
+
+    void TestRequest()
+    {
+        Login();
+        PayloadMsg req;
+        req.set_time(0);
+        mNetwork->WriteMessage(req);
+        const PayloadMsg& res = ReadUpdate();
+        TS_ASSERT_EQUALS(res.time(), ServerGame::GetTime());
+        TS_ASSERT(mChanges > 0);
+
+        // Request without time is answered with an empty message
+        PayloadMsg command;
+        command.mutable_commandmove()->set_position(0);
+        mNetwork->WriteMessage(command);
+        PayloadMsg empty;
+        mNetwork->ReadMessage(empty);
+        TS_ASSERT(!empty.has_time());
+
+        mGame->Update();
+        req.set_time(res.time());
+        mNetwork->WriteMessage(req);
+        TS_ASSERT_EQUALS(ReadUpdate().time(), res.time() + FLAGS_time_step);
+    }
+
+    void TestClientAhead()
+    {
+        Login();
+        // Client time from the future gets a full update
+        PayloadMsg req;
+        req.set_time(ServerGame::GetTime() + 10 * FLAGS_time_step);
+        mNetwork->WriteMessage(req);
+        const PayloadMsg& res = ReadUpdate();
+        TS_ASSERT_EQUALS(res.time(), ServerGame::GetTime());
+        TS_ASSERT(mChanges > 0);
+    }
+
+    void TestCommandTarget()
+    {
+        Login();
+        const ServerGeodesicGrid::Tiles& tiles = mGame->GetTiles();
+        const TileId target = tiles.size() - 1;
+        const Ogre::Vector3 point = tiles[target]->GetPosition();
+        // Server finds the tile at the point, tile of the client is a hint
+        PayloadMsg command;
+        CommandMoveMsg* move = command.mutable_commandmove();
+        move->set_position(0);
+        move->set_target_x(point.x);
+        move->set_target_y(point.y);
+        move->set_target_z(point.z);
+        mNetwork->WriteMessage(command);
+        PayloadMsg empty;
+        mNetwork->ReadMessage(empty);
+        // Command is given by the game thread on the next update
+        TS_ASSERT(!MindList::GetTarget(UnitList::GetIndex(mAvatar)));
+        mGame->Update();
+        TS_ASSERT(IsHeadingTo(*tiles[target]));
+
+        // Command to no tile is ignored, session goes on
+        command.mutable_commandmove()->set_position(tiles.size());
+        mNetwork->WriteMessage(command);
+        mNetwork->ReadMessage(empty);
+        mGame->Update();
+        TS_ASSERT(IsHeadingTo(*tiles[target]));
+    }
+
+    void TestLoginAfterLifetime()
+    {
+        // Zebras live 500 turns, those which die are followed by newborns
+        for (int32 i = 0; i <= 500; ++i)
+        {
+            mGame->Update();
+        }
+        TS_ASSERT_THROWS_NOTHING(User("late", "late", mGame->GetGameMutex()));
+    }
+
+    void TestWrongVersion()
+    {
+        PayloadMsg req;
+        req.set_protocolversion(PROTOCOL_VERSION + 1);
+        mNetwork->WriteMessage(req);
+        PayloadMsg res;
+        mNetwork->ReadMessage(res);
+        TS_ASSERT(res.has_reason());
+        TS_ASSERT(!res.has_avatar());
+        // Session is closed after the answer
+        TS_ASSERT_THROWS_ANYTHING(mNetwork->ReadMessage(res));
+    }
+
+    void TestOldVersion()
+    {
+        // Client which does not expect unit creation in updates is refused
+        PayloadMsg req;
+        req.set_protocolversion(1);
+        mNetwork->WriteMessage(req);
+        PayloadMsg res;
+        mNetwork->ReadMessage(res);
+        TS_ASSERT(res.has_reason());
+        TS_ASSERT(!res.has_avatar());
+        TS_ASSERT_THROWS_ANYTHING(mNetwork->ReadMessage(res));
+    }
+
+    void TestBrokenMessage()
+    {
+        Login();
+        HeaderMsg header;
+        header.set_size(3);
+        const std::string frame = header.SerializeAsString() + "\xff\xff\xff";
+        boost::asio::write(*mSocket, boost::asio::buffer(frame));
+        PayloadMsg res;
+        TS_ASSERT_THROWS_ANYTHING(mNetwork->ReadMessage(res));
+    }
+
+    void TestRequestTooBig()
+    {
+        Login();
+        FLAGS_max_request_size = 16;
+        // Body is never sent, session closes on the header alone
+        HeaderMsg header;
+        header.set_size(17);
+        boost::asio::write(*mSocket, boost::asio::buffer(header.SerializeAsString()));
+        PayloadMsg res;
+        TS_ASSERT_THROWS_ANYTHING(mNetwork->ReadMessage(res));
+    }
+
+    void TestSubscribe()
+    {
+        Login();
+        PayloadMsg req;
+        req.set_time(0);
+        req.set_subscribe(true);
+        mNetwork->WriteMessage(req);
+        GameTime time = ReadUpdate().time();
+        TS_ASSERT_EQUALS(time, ServerGame::GetTime());
+
+        for (int i = 0; i < 3; ++i)
+        {
+            mGame->Update();
+            ClientConnection::PushUpdates();
+            const PayloadMsg& pushed = ReadUpdate();
+            TS_ASSERT_EQUALS(pushed.time(), time + FLAGS_time_step);
+            time = pushed.time();
+            PayloadMsg ack;
+            ack.set_time(time);
+            mNetwork->WriteMessage(ack);
+        }
+    }
+    void TestPushWindow()
+    {
+        FLAGS_push_window = 2;
+        Login();
+        PayloadMsg req;
+        req.set_time(0);
+        req.set_subscribe(true);
+        mNetwork->WriteMessage(req);
+        const GameTime time = ReadUpdate().time();
+
+        // Push takes the snapshot it runs with, so each one is read before the next update
+        for (int i = 1; i <= 2; ++i)
+        {
+            mGame->Update();
+            ClientConnection::PushUpdates();
+            TS_ASSERT_EQUALS(ReadUpdate().time(), time + i * FLAGS_time_step);
+        }
+        // Updates beyond the window wait for acknowledgement
+        for (int i = 0; i < 2; ++i)
+        {
+            mGame->Update();
+            ClientConnection::PushUpdates();
+        }
+
+        // Next update covers turns client missed
+        PayloadMsg ack;
+        ack.set_time(time + 2 * FLAGS_time_step);
+        mNetwork->WriteMessage(ack);
+        const PayloadMsg& pushed = ReadUpdate();
+        TS_ASSERT_EQUALS(pushed.time(), time + 4 * FLAGS_time_step);
+        TS_ASSERT_EQUALS(pushed.time(), ServerGame::GetTime());
+    }
+private:
+    static char* GivePassword(SSL* aSSL, void* aArg)
+    {
+        return BUF_strdup("test");
+    }
+
+    void Login()
+    {
+        PayloadMsg req;
+        req.set_protocolversion(PROTOCOL_VERSION);
+        mNetwork->WriteMessage(req);
+        PayloadMsg res;
+        mNetwork->ReadMessage(res);
+        TS_ASSERT(res.has_avatar());
+        TS_ASSERT_EQUALS(res.size(), 1);
+        mAvatar = res.avatar();
+    }
+
+    // Reads messages of one update, returns the last one
+    const PayloadMsg& ReadUpdate()
+    {
+        mChanges = 0;
+        mLast.Clear();
+        mNetwork->ReadMessage(mLast);
+        while (!mLast.last())
+        {
+            mChanges += mLast.changes_size();
+            mLast.Clear();
+            mNetwork->ReadMessage(mLast);
+        }
+        mChanges += mLast.changes_size();
+        return mLast;
+    }
+
+    // Avatar is commanded to the tile or has already reached it
+    bool IsHeadingTo(const ServerTile& aTile)
+    {
+        return MindList::GetTarget(UnitList::GetIndex(mAvatar)) == &aTile ||
+            &UnitList::GetUnit(mAvatar)->GetUnitTile() == &aTile;
+    }
+
+    int32 mUpdateLength;
+    int32 mPushWindow;
+    int32 mMaxRequestSize;
+    ServerGame* mGame;
+    boost::asio::io_service* mServerIO;
+    boost::asio::ssl::context* mServerContext;
+    boost::asio::ip::tcp::acceptor* mGate;
+    boost::thread* mServerThread;
+    boost::asio::io_service* mClientIO;
+    boost::asio::ssl::context* mClientContext;
+    SSLStreamPtr mSocket;
+    Network* mNetwork;
+    PayloadMsg mLast;
+    int mChanges;
+    UnitId mAvatar;
+};
+
+#endif // SESSIONTEST_H_INCLUDED
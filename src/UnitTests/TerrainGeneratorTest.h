@@ -0,0 +1,76 @@
+#ifndef TERRAINGENERATORTEST_H_INCLUDED
+#define TERRAINGENERATORTEST_H_INCLUDED
+
+#include <cxxtest/TestSuite.h>
+#include <ServerGeodesicGrid.h>
+#include <TerrainGenerator.h>
+
+class TerrainGeneratorTest: public CxxTest::TestSuite
+{
+public:
+    void setUp()
+    {
+        mGrid = new ServerGeodesicGrid(mTiles, 4);
+    }
+
+    void tearDown()
+    {
+        for (size_t i = 0; i < mTiles.size(); ++i)
+        {
+            delete mTiles[i];
+        }
+        mTiles.clear();
+        delete mGrid;
+    }
+
+    std::vector<int32> Generate(uint32 aSeed, size_t aThreadCount)
+    {
+        TerrainGenerator(aSeed).Generate(mTiles, mGrid->GetAdjacency(), aThreadCount);
+        std::vector<int32> heights;
+        for (size_t i = 0; i < mTiles.size(); ++i)
+        {
+            heights.push_back(mTiles[i]->GetHeight());
+        }
+        return heights;
+    }
+
+    void TestSameSeed()
+    {
+        const std::vector<int32> serial = Generate(7, 1);
+        TS_ASSERT(serial == Generate(7, 4));
+        TS_ASSERT(serial == Generate(7, 0));
+        TS_ASSERT(serial != Generate(8, 4));
+    }
+
+    void TestLandAndWater()
+    {
+        Generate(1, 0);
+        size_t land = 0;
+        int32 step = 0;
+        for (size_t i = 0; i < mTiles.size(); ++i)
+        {
+            land += mTiles[i]->CanEnter();
+            step = std::max(step, std::abs(mTiles[i]->GetHeight() - mTiles[i]->GetNeighbour(0).GetHeight()));
+        }
+        TS_ASSERT_LESS_THAN(mTiles.size() / 5, land);
+        TS_ASSERT_LESS_THAN(land, mTiles.size() * 4 / 5);
+        // Noise is coherent, neighbours are close in height
+        TS_ASSERT_LESS_THAN(step, 250);
+    }
+
+    void TestNoiseRange()
+    {
+        const TerrainGenerator generator(3);
+        for (size_t i = 0; i < mTiles.size(); ++i)
+        {
+            const float noise = generator.CalcNoise(mTiles[i]->GetPosition().normalisedCopy());
+            TS_ASSERT_LESS_THAN_EQUALS(-1.0f, noise);
+            TS_ASSERT_LESS_THAN_EQUALS(noise, 1.0f);
+        }
+    }
+private:
+    ServerGeodesicGrid::Tiles mTiles;
+    ServerGeodesicGrid* mGrid;
+};
+
+#endif // TERRAINGENERATORTEST_H_INCLUDED
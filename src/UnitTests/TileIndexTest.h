@@ -0,0 +1,92 @@
+#ifndef TILEINDEXTEST_H_INCLUDED
+#define TILEINDEXTEST_H_INCLUDED
+
+#include <cxxtest/TestSuite.h>
+#include <ServerGeodesicGrid.h>
+
+class TileIndexTest: public CxxTest::TestSuite
+{
+public:
+    void setUp()
+    {
+        mGrid = new ServerGeodesicGrid(mTiles, 3);
+    }
+
+    void tearDown()
+    {
+        for (size_t i = 0; i < mTiles.size(); ++i)
+        {
+            delete mTiles[i];
+        }
+        mTiles.clear();
+        delete mGrid;
+    }
+
+    void TestTileCentres()
+    {
+        const TileIndex& index = mGrid->GetIndex();
+        size_t mismatches = 0;
+        for (TileId i = 0; i < mTiles.size(); ++i)
+        {
+            if (index.GetTile(mTiles[i]->GetPosition()) != i)
+            {
+                ++mismatches;
+            }
+        }
+        TS_ASSERT_EQUALS(mismatches, size_t(0));
+    }
+
+    void TestNearestTile()
+    {
+        const TileIndex& index = mGrid->GetIndex();
+        size_t mismatches = 0;
+        // Spiral over the sphere, also hits cube map edges and corners
+        const size_t count = 20000;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Ogre::Real z = 1.0f - 2.0f * (i + 0.5f) / count;
+            const Ogre::Real r = sqrt(1.0f - z * z);
+            const Ogre::Real phi = i * 2.399963f;
+            const Ogre::Vector3 direction(r * cos(phi), r * sin(phi), z);
+            if (!IsNearest(index.GetTile(direction * 3.0f), direction))
+            {
+                ++mismatches;
+            }
+        }
+        const Ogre::Vector3 corners[] = {Ogre::Vector3(1, 1, 1), Ogre::Vector3(-1, 1, -1), Ogre::Vector3::UNIT_X, Ogre::Vector3::NEGATIVE_UNIT_Z};
+        for (size_t i = 0; i < 4; ++i)
+        {
+            if (!IsNearest(index.GetTile(corners[i]), corners[i].normalisedCopy()))
+            {
+                ++mismatches;
+            }
+        }
+        TS_ASSERT_EQUALS(mismatches, size_t(0));
+    }
+
+    void TestStartTile()
+    {
+        const Ogre::Vector3 direction = mTiles[100]->GetPosition();
+        TS_ASSERT_EQUALS(mGrid->GetIndex().GetTile(direction, 0), TileId(100));
+        TS_ASSERT_EQUALS(mGrid->GetIndex().GetTile(-direction, 100), mGrid->GetIndex().GetTile(-direction));
+    }
+
+private:
+    bool IsNearest(TileId aTile, const Ogre::Vector3& aDirection) const
+    {
+        const Ogre::Real dot = mTiles[aTile]->GetPosition().normalisedCopy().dotProduct(aDirection);
+        for (size_t i = 0; i < mTiles.size(); ++i)
+        {
+            if (mTiles[i]->GetPosition().normalisedCopy().dotProduct(aDirection) > dot + 1e-6f)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    ServerGeodesicGrid::Tiles mTiles;
+    ServerGeodesicGrid* mGrid;
+};
+
+#endif // TILEINDEXTEST_H_INCLUDED
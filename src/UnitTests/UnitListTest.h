@@ -20,6 +20,7 @@ public:
     void tearDown()
     {
         UnitList::Clear();
+        UnitList::Init(FLAGS_unit_index_bits);
         delete mTile;
     }
     void TestBase()
@@ -130,6 +131,88 @@ public:
         }
         TS_ASSERT_EQUALS(count, 1);
     }
+
+    void TestManyUnits()
+    {
+        UnitClass unitClass(0, 0 ,0);
+
+        std::vector<UnitId> ids;
+        for (int32 i = 0; i < 70000; ++i)
+        {
+            ids.push_back(UnitList::NewUnit(*mTile, unitClass).GetUnitId());
+        }
+        for (size_t i = 0; i < ids.size(); i += 2)
+        {
+            UnitList::DeleteUnit(ids[i]);
+        }
+        TS_ASSERT_EQUALS(UnitList::GetCount(), 35000);
+        for (size_t i = 0; i < ids.size(); ++i)
+        {
+            ServerUnit* unit = UnitList::GetUnit(ids[i]);
+            TS_ASSERT_EQUALS(unit != NULL, i % 2 == 1);
+            TS_ASSERT(!unit || unit->GetUnitId() == ids[i]);
+        }
+        std::set<UnitId> iterated;
+        for (UnitListIterator i = UnitList::GetIterator(); !i.IsDone(); i.Next())
+        {
+            iterated.insert(i.GetUnit()->GetUnitId());
+        }
+        TS_ASSERT_EQUALS(iterated.size(), size_t(35000));
+        TS_ASSERT_EQUALS(*iterated.begin(), ids[1]);
+    }
+
+    void TestGenerations()
+    {
+        UnitClass unitClass(0, 0 ,0);
+        UnitList::Clear();
+        // 4 slots, 29 bits of generation
+        UnitList::Init(2);
+
+        for (int32 i = 0; i < 4; ++i)
+        {
+            UnitList::NewUnit(*mTile, unitClass);
+        }
+        TS_ASSERT_THROWS_ANYTHING(UnitList::NewUnit(*mTile, unitClass));
+
+        UnitList::Clear();
+        UnitList::Init(2);
+        std::set<UnitId> ids;
+        for (int32 i = 0; i < 100; ++i)
+        {
+            const UnitId id = UnitList::NewUnit(*mTile, unitClass).GetUnitId();
+            TS_ASSERT_LESS_THAN(0, id);
+            ids.insert(id);
+            UnitList::DeleteUnit(id);
+        }
+        TS_ASSERT_EQUALS(ids.size(), size_t(100));
+        TS_ASSERT_EQUALS(UnitList::GetSize(), 1);
+    }
+
+    void TestRetiredSlot()
+    {
+        UnitClass unitClass(0, 0 ,0);
+        UnitList::Clear();
+        // 3 generations per slot
+        UnitList::Init(29);
+
+        std::vector<UnitId> ids;
+        for (int32 i = 0; i < 4; ++i)
+        {
+            ids.push_back(UnitList::NewUnit(*mTile, unitClass).GetUnitId());
+            UnitList::DeleteUnit(ids.back());
+        }
+        TS_ASSERT_EQUALS(UnitList::GetIndex(ids[2]), uint32(0));
+        // Slot 0 is retired instead of wrapping to the id of the first unit
+        TS_ASSERT_EQUALS(UnitList::GetIndex(ids[3]), uint32(1));
+        TS_ASSERT_EQUALS(UnitList::GetSize(), 2);
+        const UnitId id = UnitList::NewUnit(*mTile, unitClass).GetUnitId();
+        TS_ASSERT_EQUALS(UnitList::GetIndex(id), uint32(1));
+        for (size_t i = 0; i < ids.size(); ++i)
+        {
+            TS_ASSERT(!UnitList::GetUnit(ids[i]));
+        }
+    }
+
     ServerTile* mTile;
 
 };
@@ -0,0 +1,69 @@
+#ifndef WORKERPOOLTEST_H_INCLUDED
+#define WORKERPOOLTEST_H_INCLUDED
+
+#include <cxxtest/TestSuite.h>
+#include <WorkerPool.h>
+
+class WorkerPoolTest: public CxxTest::TestSuite
+{
+public:
+    void TestParallelFor()
+    {
+        WorkerPool pool(4);
+        TS_ASSERT_EQUALS(pool.GetThreadCount(), size_t(4));
+        for (size_t count = 0; count < 1000; count += 97)
+        {
+            mHits.assign(count, 0);
+            pool.ParallelFor(count, boost::bind(&WorkerPoolTest::Hit, this, _1, _2));
+            TS_ASSERT_EQUALS(std::count(mHits.begin(), mHits.end(), 1), int(count));
+        }
+    }
+
+    void TestSingleThread()
+    {
+        WorkerPool pool(1);
+        TS_ASSERT_EQUALS(pool.GetThreadCount(), size_t(1));
+        mHits.assign(10, 0);
+        pool.ParallelFor(mHits.size(), boost::bind(&WorkerPoolTest::Hit, this, _1, _2));
+        TS_ASSERT_EQUALS(std::count(mHits.begin(), mHits.end(), 1), 10);
+    }
+
+    void TestTaskThrows()
+    {
+        WorkerPool pool(4);
+        mHits.assign(100, 0);
+        TS_ASSERT_THROWS(pool.ParallelFor(mHits.size(), boost::bind(&WorkerPoolTest::HitOrThrow, this, _1, _2)), std::runtime_error);
+        // Pool is usable after the error
+        mHits.assign(100, 0);
+        pool.ParallelFor(mHits.size(), boost::bind(&WorkerPoolTest::Hit, this, _1, _2));
+        TS_ASSERT_EQUALS(std::count(mHits.begin(), mHits.end(), 1), 100);
+    }
+
+    void TestDefaultThreadCount()
+    {
+        WorkerPool pool(0);
+        TS_ASSERT(pool.GetThreadCount() >= 1);
+    }
+
+private:
+    void Hit(size_t aBegin, size_t aEnd)
+    {
+        for (size_t i = aBegin; i < aEnd; ++i)
+        {
+            ++mHits[i];
+        }
+    }
+
+    void HitOrThrow(size_t aBegin, size_t aEnd)
+    {
+        if (aBegin <= 50 && 50 < aEnd)
+        {
+            boost::throw_exception(std::runtime_error("Chunk failed"));
+        }
+        Hit(aBegin, aEnd);
+    }
+
+    std::vector<int> mHits;
+};
+
+#endif // WORKERPOOLTEST_H_INCLUDED
@@ -0,0 +1,158 @@
+#ifndef WORLDSNAPSHOTTEST_H_INCLUDED
+#define WORLDSNAPSHOTTEST_H_INCLUDED
+
+#include <cxxtest/TestSuite.h>
+#include <ServerGeodesicGrid.h>
+#include <WorldSnapshot.h>
+#include <ChangeList.h>
+#include <UnitList.h>
+#include <UnitClass.h>
+
+class WorldSnapshotTest: public CxxTest::TestSuite
+{
+public:
+    void setUp()
+    {
+        mGrid = new ServerGeodesicGrid(mTiles, 2);
+        mUnitClass = new UnitClass(7, 0, 0);
+        mUnit = &UnitList::NewUnit(*mTiles.at(0), *mUnitClass);
+        mOther = &UnitList::NewUnit(*mTiles.at(300), *mUnitClass);
+    }
+
+    void tearDown()
+    {
+        UnitList::Clear();
+        delete mUnitClass;
+        for (size_t i = 0; i < mTiles.size(); ++i)
+        {
+            delete mTiles[i];
+        }
+        mTiles.clear();
+        delete mGrid;
+    }
+
+    void TestUnits()
+    {
+        const WorldSnapshot snapshot(mTiles, NULL, 5);
+        TS_ASSERT_EQUALS(snapshot.GetTime(), 5);
+        TS_ASSERT_EQUALS(snapshot.GetUnitTile(mUnit->GetUnitId()), 0);
+        TS_ASSERT_EQUALS(snapshot.GetUnitTile(mOther->GetUnitId()), 300);
+        TS_ASSERT_THROWS_ANYTHING(snapshot.GetUnitTile(0));
+
+        WorldSnapshot::UnitIterator it = snapshot.GetUnitsBegin(300);
+        TS_ASSERT_EQUALS(snapshot.GetUnitsEnd(300) - it, 1);
+        TS_ASSERT_EQUALS(it->mUnitId, mOther->GetUnitId());
+        TS_ASSERT_EQUALS(it->mVisualCode, 7);
+        TS_ASSERT(snapshot.GetUnitsBegin(1) == snapshot.GetUnitsEnd(1));
+        TS_ASSERT_THROWS_ANYTHING(snapshot.GetUnitsBegin(mTiles.size()));
+    }
+
+    void TestChangesAfterPrevious()
+    {
+        ChangeList::CommitTurn();
+        const WorldSnapshot first(mTiles, NULL, 1);
+        const UnitId unitId = mUnit->GetUnitId();
+        mUnit->Move(*mTiles.at(163));
+        UnitList::DeleteUnit(mOther->GetUnitId());
+        ChangeList::CommitTurn();
+        const WorldSnapshot second(mTiles, &first, 2);
+
+        // Previous snapshot sees the world as it was
+        TS_ASSERT_EQUALS(first.GetUnitTile(unitId), 0);
+        TS_ASSERT_EQUALS(first.GetUnitsEnd(300) - first.GetUnitsBegin(300), 1);
+        TS_ASSERT_EQUALS(second.GetUnitTile(unitId), 163);
+        TS_ASSERT_EQUALS(second.GetUnitsEnd(0) - second.GetUnitsBegin(0), 0);
+        TS_ASSERT_EQUALS(second.GetUnitsEnd(163) - second.GetUnitsBegin(163), 1);
+        TS_ASSERT_EQUALS(second.GetUnitsEnd(300) - second.GetUnitsBegin(300), 0);
+    }
+
+    void TestCreateAfterPrevious()
+    {
+        UnitList::DeleteUnit(mOther->GetUnitId());
+        ChangeList::CommitTurn();
+        const WorldSnapshot first(mTiles, NULL, 1);
+        // Unit reuses the slot of the removed one
+        const UnitId unitId = UnitList::NewUnit(*mTiles.at(42), *mUnitClass).GetUnitId();
+        ChangeList::CommitTurn();
+        const WorldSnapshot second(mTiles, &first, 2);
+
+        TS_ASSERT_THROWS_ANYTHING(first.GetUnitTile(unitId));
+        TS_ASSERT_EQUALS(second.GetUnitTile(unitId), 42);
+        TS_ASSERT_EQUALS(second.GetUnitsEnd(42) - second.GetUnitsBegin(42), 1);
+        TS_ASSERT_EQUALS(second.GetUnitsBegin(42)->mVisualCode, 7);
+        TS_ASSERT(HasChanges(second.GetChanges(second.GetTurn() - 1), 42));
+    }
+
+    void TestSameAsFull()
+    {
+        ChangeList::CommitTurn();
+        const WorldSnapshot first(mTiles, NULL, 1);
+        // Unit moves twice in a turn and comes back to a tile it left
+        mUnit->Move(*mTiles.at(163));
+        mUnit->Move(*mTiles.at(300));
+        mOther->Move(*mTiles.at(0));
+        mOther->Move(*mTiles.at(300));
+        ServerUnit& created = UnitList::NewUnit(*mTiles.at(600), *mUnitClass);
+        ChangeList::CommitTurn();
+        created.Move(*mTiles.at(1));
+        ChangeList::CommitTurn();
+        const WorldSnapshot second(mTiles, &first, 3);
+        const WorldSnapshot full(mTiles, NULL, 3);
+
+        for (TileId t = 0; t < mTiles.size(); ++t)
+        {
+            TS_ASSERT_EQUALS(second.GetUnitsEnd(t) - second.GetUnitsBegin(t), full.GetUnitsEnd(t) - full.GetUnitsBegin(t));
+        }
+        TS_ASSERT_EQUALS(second.GetUnitsEnd(300) - second.GetUnitsBegin(300), 2);
+        TS_ASSERT(second.GetUnitsBegin(300)->mUnitId < (second.GetUnitsBegin(300) + 1)->mUnitId);
+        TS_ASSERT_EQUALS(second.GetUnitTile(mUnit->GetUnitId()), 300);
+        TS_ASSERT_EQUALS(second.GetUnitTile(mOther->GetUnitId()), 300);
+        TS_ASSERT_EQUALS(second.GetUnitTile(created.GetUnitId()), 1);
+    }
+
+    void TestTurns()
+    {
+        mUnit->Move(*mTiles.at(163));
+        ChangeList::CommitTurn();
+        ChangeList::CommitTurn();
+        const WorldSnapshot snapshot(mTiles, NULL, 1);
+        const uint32 turn = snapshot.GetTurn();
+        TS_ASSERT_EQUALS(turn, ChangeList::GetTurn());
+        TS_ASSERT(HasChanges(snapshot.GetChanges(turn - 2), 163));
+        TS_ASSERT(!HasChanges(snapshot.GetChanges(turn - 1), 163));
+        TS_ASSERT_THROWS_ANYTHING(snapshot.GetChanges(turn));
+
+        // Snapshot keeps turns it was made with
+        ChangeList::CommitTurn();
+        TS_ASSERT_THROWS_ANYTHING(snapshot.GetChanges(turn));
+        for (int i = 0; i < FLAGS_max_change_list_size; ++i)
+        {
+            ChangeList::CommitTurn();
+        }
+        TS_ASSERT(HasChanges(snapshot.GetChanges(turn - 2), 0));
+    }
+
+private:
+    // Turn has a change on the tile
+    static bool HasChanges(const ChangeList::Turn& aTurn, TileId aTileId)
+    {
+        std::vector<ChangeList::Turn::UnitChange> changes;
+        aTurn.GetUnitChanges(changes);
+        for (size_t i = 0; i < changes.size(); ++i)
+        {
+            if (changes[i].mTileId == aTileId)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    ServerGeodesicGrid* mGrid;
+    ServerGeodesicGrid::Tiles mTiles;
+    UnitClass* mUnitClass;
+    ServerUnit* mUnit;
+    ServerUnit* mOther;
+};
+
+#endif // WORLDSNAPSHOTTEST_H_INCLUDED
@@ -6,8 +6,8 @@
 
 DEFINE_string(srp_default_gN, "1024", "Name of preset g and N for SRP");
 
-User::User(const char* aName, const char* aPassword):
-    mName(aName), mSalt(NULL), mVerifier(NULL)
+User::User(const char* aName, const char* aPassword, boost::shared_mutex& aGameMutex):
+    mGameMutex(aGameMutex), mSalt(NULL), mVerifier(NULL), mName(aName)
 {
     SRP_gN *GN = SRP_get_default_gN(FLAGS_srp_default_gN.c_str());
     if(GN == NULL)
@@ -20,7 +20,15 @@ User::User(const char* aName, const char* aPassword):
         boost::throw_exception(std::runtime_error("Error in SRP_create_verifier_BN"));
     }
 
+    // Game thread deletes minds of units which die
+    boost::lock_guard<boost::shared_mutex> lock(mGameMutex);
     mMind = MindList::GetFreeMind();
+    if (!mMind)
+    {
+        BN_clear_free(mSalt);
+        BN_clear_free(mVerifier);
+        boost::throw_exception(std::runtime_error("No free unit for user"));
+    }
     mMind->SetFree(false);
 }
 
@@ -29,5 +37,6 @@ User::~User()
 {
     BN_clear_free(mSalt);
     BN_clear_free(mVerifier);
+    boost::lock_guard<boost::shared_mutex> lock(mGameMutex);
     mMind->SetFree(true);
 }
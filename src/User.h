@@ -3,19 +3,22 @@
 
 #include <openssl/bn.h>
 #include <Mind.h>
+#include <boost/thread/shared_mutex.hpp>
 
 DECLARE_string(srp_default_gN);
 
 class User
 {
 public:
-    User(const char* aName, const char* aPassword);
+    // Takes a free unit as avatar under game lock, throws if there is none
+    User(const char* aName, const char* aPassword, boost::shared_mutex& aGameMutex);
     ~User();
     UnitId GetUnitId() const { return mMind->GetUnitId(); }
     Mind* GetMind() const { return mMind; }
     BIGNUM* GetSalt() const { return mSalt; }
     BIGNUM* GetVerifier() const { return mVerifier; }
 private:
+    boost::shared_mutex& mGameMutex;
     Mind* mMind;
     BIGNUM* mSalt;
     BIGNUM* mVerifier;
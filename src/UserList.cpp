@@ -8,15 +8,21 @@ typedef boost::ptr_map<Ogre::String, User> UserMap;
 boost::shared_mutex theUserListMutex;
 UserMap theUserList;
 
-void AddUser(const char* aUserName, const char* aPassword)
+void AddUser(const char* aUserName, const char* aPassword, boost::shared_mutex& aGameMutex)
 {
-    std::auto_ptr<User> user(new User(aUserName, aPassword));
+    std::auto_ptr<User> user(new User(aUserName, aPassword, aGameMutex));
     {
         boost::lock_guard<boost::shared_mutex> lg(theUserListMutex);
         theUserList.insert(aUserName, user);
     }
 }
 
+void ClearUsers()
+{
+    boost::lock_guard<boost::shared_mutex> lg(theUserListMutex);
+    theUserList.clear();
+}
+
 const User* GetUser(const char* aUser)
 {
     boost::shared_lock<boost::shared_mutex> lg(theUserListMutex);
@@ -4,7 +4,10 @@
 #include <User.h>
 #include <Typedefs.h>
 
-void AddUser(const char* aUserName, const char* aPassword);
+// Throws if user can not be created
+void AddUser(const char* aUserName, const char* aPassword, boost::shared_mutex& aGameMutex);
+// Users release their avatars, game must be still alive
+void ClearUsers();
 const User* GetUser(const char* aUser);
 
 #endif // USERLIST_H_INCLUDED
@@ -0,0 +1,15 @@
+#ifndef VISIBLETILES_H
+#define VISIBLETILES_H
+
+#include <Typedefs.h>
+#include <boost/dynamic_bitset.hpp>
+
+// Bit per tile of the map
+typedef boost::dynamic_bitset<> VisibleTiles;
+
+inline bool IsVisible(const VisibleTiles& aVisibleTiles, TileId aTileId)
+{
+    return aTileId < aVisibleTiles.size() && aVisibleTiles.test(aTileId);
+}
+
+#endif // VISIBLETILES_H
@@ -0,0 +1,127 @@
+#include <pch.h>
+
+#include <WorkerPool.h>
+
+WorkerPool::WorkerPool(size_t aThreadCount):
+    mTask(NULL),
+    mCount(0),
+    mChunkSize(1),
+    mNext(0),
+    mRunning(0),
+    mGeneration(0),
+    mStop(false)
+{
+    if (aThreadCount == 0)
+    {
+        aThreadCount = std::max(boost::thread::hardware_concurrency(), 1u);
+    }
+    for (size_t i = 1; i < aThreadCount; ++i)
+    {
+        mThreads.create_thread(boost::bind(&WorkerPool::WorkerLoop, this));
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        boost::lock_guard<boost::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mWork.notify_all();
+    mThreads.join_all();
+}
+
+void WorkerPool::ParallelFor(size_t aCount, const Task& aTask)
+{
+    if (aCount == 0)
+    {
+        return;
+    }
+    if (mThreads.size() == 0)
+    {
+        aTask(0, aCount);
+        return;
+    }
+
+    boost::unique_lock<boost::mutex> lock(mMutex);
+    mTask = &aTask;
+    mCount = aCount;
+    // Few chunks per thread to even out uneven work
+    mChunkSize = std::max<size_t>(aCount / (GetThreadCount() * 4), 1);
+    mNext = 0;
+    ++mGeneration;
+    mWork.notify_all();
+
+    while (RunChunk(lock))
+    {
+    }
+    while (mRunning > 0)
+    {
+        mDone.wait(lock);
+    }
+    mTask = NULL;
+    if (mError)
+    {
+        const boost::exception_ptr error = mError;
+        mError = boost::exception_ptr();
+        boost::rethrow_exception(error);
+    }
+}
+
+void WorkerPool::WorkerLoop()
+{
+    boost::unique_lock<boost::mutex> lock(mMutex);
+    uint64 generation = mGeneration;
+    while (true)
+    {
+        while (!mStop && generation == mGeneration)
+        {
+            mWork.wait(lock);
+        }
+        if (mStop)
+        {
+            return;
+        }
+        generation = mGeneration;
+        while (RunChunk(lock))
+        {
+        }
+    }
+}
+
+bool WorkerPool::RunChunk(boost::unique_lock<boost::mutex>& aLock)
+{
+    if (!mTask || mNext >= mCount)
+    {
+        return false;
+    }
+    const size_t begin = mNext;
+    const size_t end = std::min(begin + mChunkSize, mCount);
+    mNext = end;
+    const Task& task = *mTask;
+    ++mRunning;
+
+    boost::exception_ptr error;
+    aLock.unlock();
+    try
+    {
+        task(begin, end);
+    }
+    catch (...)
+    {
+        error = boost::current_exception();
+    }
+    aLock.lock();
+
+    if (error && !mError)
+    {
+        mError = error;
+        mNext = mCount;
+    }
+    --mRunning;
+    if (mRunning == 0 && mNext >= mCount)
+    {
+        mDone.notify_all();
+    }
+    return true;
+}
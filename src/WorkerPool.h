@@ -0,0 +1,43 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <Typedefs.h>
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/exception_ptr.hpp>
+
+// Fixed set of threads running chunks of an index range, calling thread works too
+class WorkerPool: public boost::noncopyable
+{
+public:
+    typedef boost::function<void (size_t aBegin, size_t aEnd)> Task;
+
+    // 0 threads means one per hardware thread
+    explicit WorkerPool(size_t aThreadCount);
+    ~WorkerPool();
+
+    size_t GetThreadCount() const { return mThreads.size() + 1; }
+    // Splits [0, aCount) into chunks and returns when aTask is done for all of them.
+    // If a chunk throws, chunks not started yet are skipped and the first error is rethrown
+    void ParallelFor(size_t aCount, const Task& aTask);
+private:
+    void WorkerLoop();
+    bool RunChunk(boost::unique_lock<boost::mutex>& aLock);
+
+    boost::thread_group mThreads;
+    boost::mutex mMutex;
+    boost::condition_variable mWork;
+    boost::condition_variable mDone;
+    const Task* mTask;
+    size_t mCount;
+    size_t mChunkSize;
+    size_t mNext;
+    size_t mRunning;
+    uint64 mGeneration;
+    boost::exception_ptr mError;
+    bool mStop;
+};
+
+#endif // WORKERPOOL_H
@@ -0,0 +1,218 @@
+#include <pch.h>
+#include <WorldSnapshot.h>
+
+#include <ServerTile.h>
+#include <UnitList.h>
+#include <UnitClass.h>
+
+const uint32 WorldSnapshot::TILE_CHUNK_SIZE;
+const uint32 WorldSnapshot::UNIT_CHUNK_SIZE;
+const uint32 WorldSnapshot::PAGE_SIZE;
+
+WorldSnapshot::WorldSnapshot(const ServerGeodesicGrid::Tiles& aTiles, const WorldSnapshot* aPrevious, GameTime aTime):
+    mTime(aTime), mTurn(ChangeList::GetTurn()), mTileCount(aTiles.size()), mUnitSlots(UnitList::GetSize())
+{
+    const uint32 kept = std::min<uint32>(mTurn, std::max(FLAGS_max_change_list_size, 1));
+    for (uint32 t = mTurn - kept; t < mTurn; ++t)
+    {
+        mTurns.push_back(ChangeList::GetTurnChanges(t));
+    }
+
+    const size_t tileChunks = (mTileCount + TILE_CHUNK_SIZE - 1) / TILE_CHUNK_SIZE;
+    const size_t unitChunks = (mUnitSlots + UNIT_CHUNK_SIZE - 1) / UNIT_CHUNK_SIZE;
+    // Creation, moves and removal of units are all recorded in turns, so
+    // changes since the previous snapshot are all in turns committed after it
+    if (aPrevious && aPrevious->mTileCount == mTileCount && aPrevious->mUnitSlots == mUnitSlots &&
+        mTurn - aPrevious->mTurn <= kept)
+    {
+        mTileChunks = aPrevious->mTileChunks;
+        mUnitChunks = aPrevious->mUnitChunks;
+
+        std::vector<ChangeList::Turn::UnitChange> changes;
+        for (uint32 t = aPrevious->mTurn; t < mTurn; ++t)
+        {
+            GetChanges(t).GetUnitChanges(changes);
+        }
+        // Changes of a tile stay in order they happened
+        std::stable_sort(changes.begin(), changes.end(), IsTileBefore);
+        for (size_t i = 0, end = 0; i < changes.size(); i = end)
+        {
+            const size_t chunk = changes[i].mTileId / TILE_CHUNK_SIZE;
+            for (end = i + 1; end < changes.size() && changes[end].mTileId / TILE_CHUNK_SIZE == chunk; ++end)
+            {
+            }
+            UpdateTileChunk(chunk, &changes[i], &changes[0] + end);
+        }
+
+        std::vector<uint32> indices;
+        for (size_t i = 0; i < changes.size(); ++i)
+        {
+            indices.push_back(UnitList::GetIndex(changes[i].mUnitId));
+        }
+        std::sort(indices.begin(), indices.end());
+        indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+        for (size_t i = 0, end = 0; i < indices.size(); i = end)
+        {
+            const size_t chunk = indices[i] / UNIT_CHUNK_SIZE;
+            for (end = i + 1; end < indices.size() && indices[end] / UNIT_CHUNK_SIZE == chunk; ++end)
+            {
+            }
+            UpdateUnitChunk(chunk, &indices[i], &indices[0] + end);
+        }
+    }
+    else
+    {
+        mTileChunks.Resize(tileChunks);
+        for (size_t i = 0; i < tileChunks; ++i)
+        {
+            BuildTileChunk(aTiles, i);
+        }
+        mUnitChunks.Resize(unitChunks);
+        for (size_t i = 0; i < unitChunks; ++i)
+        {
+            BuildUnitChunk(i);
+        }
+    }
+}
+
+void WorldSnapshot::BuildTileChunk(const ServerGeodesicGrid::Tiles& aTiles, size_t aChunk)
+{
+    boost::shared_ptr<TileChunk> chunk(new TileChunk());
+    const size_t end = std::min<size_t>((aChunk + 1) * TILE_CHUNK_SIZE, mTileCount);
+    for (size_t i = aChunk * TILE_CHUNK_SIZE; i < end; ++i)
+    {
+        chunk->mBegins.push_back(chunk->mUnits.size());
+        const ServerTile& tile = *aTiles[i];
+        for (ServerTile::UnitIterator u = tile.GetUnits(); !tile.IsLastUnit(u); ++u)
+        {
+            const UnitEntry entry = { *u, UnitList::GetClass(UnitList::GetIndex(*u)).GetVisualCode() };
+            chunk->mUnits.push_back(entry);
+        }
+    }
+    chunk->mBegins.push_back(chunk->mUnits.size());
+    mTileChunks.Set(aChunk, chunk);
+}
+
+void WorldSnapshot::UpdateTileChunk(size_t aChunk, const UnitChange* aChanges, const UnitChange* aChangesEnd)
+{
+    const TileChunk& previous = mTileChunks.Get(aChunk);
+    boost::shared_ptr<TileChunk> chunk(new TileChunk());
+    const size_t begin = aChunk * TILE_CHUNK_SIZE;
+    const size_t end = std::min<size_t>(begin + TILE_CHUNK_SIZE, mTileCount);
+    chunk->mBegins.reserve(end - begin + 1);
+    chunk->mUnits.reserve(previous.mUnits.size());
+    for (size_t i = begin; i < end;)
+    {
+        // Run of unchanged tiles is copied at once
+        const size_t changed = aChanges != aChangesEnd ? aChanges->mTileId : end;
+        const uint32 first = previous.mBegins[i - begin];
+        const uint32 base = chunk->mUnits.size();
+        for (; i < changed; ++i)
+        {
+            chunk->mBegins.push_back(base + previous.mBegins[i - begin] - first);
+        }
+        chunk->mUnits.insert(chunk->mUnits.end(), previous.mUnits.begin() + first,
+            previous.mUnits.begin() + previous.mBegins[i - begin]);
+        if (i == end)
+        {
+            break;
+        }
+
+        // Units of a tile are sorted by id as in the tile
+        const uint32 tileBegin = chunk->mUnits.size();
+        chunk->mBegins.push_back(tileBegin);
+        chunk->mUnits.insert(chunk->mUnits.end(), previous.mUnits.begin() + previous.mBegins[i - begin],
+            previous.mUnits.begin() + previous.mBegins[i - begin + 1]);
+        for (; aChanges != aChangesEnd && aChanges->mTileId == i; ++aChanges)
+        {
+            std::vector<UnitEntry>::iterator it = std::lower_bound(chunk->mUnits.begin() + tileBegin, chunk->mUnits.end(),
+                aChanges->mUnitId, IsUnitBefore);
+            const bool found = it != chunk->mUnits.end() && it->mUnitId == aChanges->mUnitId;
+            if (aChanges->mEntered && !found)
+            {
+                const UnitEntry entry = { aChanges->mUnitId, aChanges->mVisualCode };
+                chunk->mUnits.insert(it, entry);
+            }
+            else if (!aChanges->mEntered && found)
+            {
+                chunk->mUnits.erase(it);
+            }
+        }
+        ++i;
+    }
+    chunk->mBegins.push_back(chunk->mUnits.size());
+    mTileChunks.Set(aChunk, chunk);
+}
+
+void WorldSnapshot::BuildUnitChunk(size_t aChunk)
+{
+    boost::shared_ptr<UnitChunk> chunk(new UnitChunk());
+    const size_t end = std::min<size_t>((aChunk + 1) * UNIT_CHUNK_SIZE, mUnitSlots);
+    for (size_t i = aChunk * UNIT_CHUNK_SIZE; i < end; ++i)
+    {
+        chunk->push_back(ReadPosition(i));
+    }
+    mUnitChunks.Set(aChunk, chunk);
+}
+
+void WorldSnapshot::UpdateUnitChunk(size_t aChunk, const uint32* aChanged, const uint32* aChangedEnd)
+{
+    boost::shared_ptr<UnitChunk> chunk(new UnitChunk(mUnitChunks.Get(aChunk)));
+    for (; aChanged != aChangedEnd; ++aChanged)
+    {
+        (*chunk)[*aChanged % UNIT_CHUNK_SIZE] = ReadPosition(*aChanged);
+    }
+    mUnitChunks.Set(aChunk, chunk);
+}
+
+WorldSnapshot::UnitPosition WorldSnapshot::ReadPosition(uint32 aIndex)
+{
+    const UnitId id = UnitList::GetUnitId(aIndex);
+    const UnitPosition position = { id, id ? UnitList::GetPosition(aIndex).GetTileId() : 0 };
+    return position;
+}
+
+const ChangeList::Turn& WorldSnapshot::GetChanges(uint32 aTurn) const
+{
+    if (aTurn >= mTurn || mTurn - aTurn > mTurns.size())
+    {
+        boost::throw_exception(std::out_of_range("Turn is not in snapshot"));
+    }
+    return *mTurns[mTurns.size() - (mTurn - aTurn)];
+}
+
+TileId WorldSnapshot::GetUnitTile(UnitId aUnitId) const
+{
+    const uint32 index = UnitList::GetIndex(aUnitId);
+    if (aUnitId != 0 && index < mUnitSlots)
+    {
+        const UnitPosition& position = mUnitChunks.Get(index / UNIT_CHUNK_SIZE)[index % UNIT_CHUNK_SIZE];
+        if (position.mUnitId == aUnitId)
+        {
+            return position.mTileId;
+        }
+    }
+    boost::throw_exception(std::out_of_range("Unit is not in snapshot"));
+    return 0;
+}
+
+const WorldSnapshot::TileChunk& WorldSnapshot::GetTileChunk(TileId aTileId) const
+{
+    if (aTileId >= mTileCount)
+    {
+        boost::throw_exception(std::out_of_range("Tile is not in snapshot"));
+    }
+    return mTileChunks.Get(aTileId / TILE_CHUNK_SIZE);
+}
+
+WorldSnapshot::UnitIterator WorldSnapshot::GetUnitsBegin(TileId aTileId) const
+{
+    const TileChunk& chunk = GetTileChunk(aTileId);
+    return chunk.mUnits.begin() + chunk.mBegins[aTileId % TILE_CHUNK_SIZE];
+}
+
+WorldSnapshot::UnitIterator WorldSnapshot::GetUnitsEnd(TileId aTileId) const
+{
+    const TileChunk& chunk = GetTileChunk(aTileId);
+    return chunk.mUnits.begin() + chunk.mBegins[aTileId % TILE_CHUNK_SIZE + 1];
+}
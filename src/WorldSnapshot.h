@@ -0,0 +1,115 @@
+#ifndef WORLDSNAPSHOT_H
+#define WORLDSNAPSHOT_H
+
+#include <Typedefs.h>
+#include <ServerGeodesicGrid.h>
+#include <ChangeList.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+// Read only state of the world after a game update. Game publishes one
+// after each update and sessions write client updates from it without the
+// game lock, so the game never waits for clients. Units of tiles and
+// positions of units are kept in chunks grouped in pages. Snapshot shares
+// chunks and pages of the previous one which turns since did not change.
+// Changes of units in the turns are applied to copies of changed tile
+// chunks and only positions of changed units are read from the world, so a
+// snapshot costs as much as the changes. Terrain does not change and is
+// read from tiles
+class WorldSnapshot: public boost::noncopyable
+{
+public:
+    struct UnitEntry
+    {
+        UnitId mUnitId;
+        uint32 mVisualCode;
+    };
+    typedef std::vector<UnitEntry>::const_iterator UnitIterator;
+
+    // Nothing should change the world meanwhile, previous snapshot can be NULL
+    WorldSnapshot(const ServerGeodesicGrid::Tiles& aTiles, const WorldSnapshot* aPrevious, GameTime aTime);
+    GameTime GetTime() const { return mTime; }
+    // Turns committed before the snapshot, the last one is GetTurn() - 1
+    uint32 GetTurn() const { return mTurn; }
+    // Throws if turn is not kept in the snapshot
+    const ChangeList::Turn& GetChanges(uint32 aTurn) const;
+    // Throws if there is no such unit
+    TileId GetUnitTile(UnitId aUnitId) const;
+    UnitIterator GetUnitsBegin(TileId aTileId) const;
+    UnitIterator GetUnitsEnd(TileId aTileId) const;
+private:
+    struct TileChunk
+    {
+        // Units of tile i of the chunk are from mBegins[i] to mBegins[i + 1]
+        std::vector<uint32> mBegins;
+        std::vector<UnitEntry> mUnits;
+    };
+    struct UnitPosition
+    {
+        // 0 if slot is free
+        UnitId mUnitId;
+        TileId mTileId;
+    };
+    typedef std::vector<UnitPosition> UnitChunk;
+    static const uint32 TILE_CHUNK_SIZE = 64;
+    static const uint32 UNIT_CHUNK_SIZE = 256;
+    static const uint32 PAGE_SIZE = 256;
+
+    // Chunks by index, snapshots share pages they do not change
+    template <typename Chunk>
+    class ChunkTable
+    {
+    public:
+        void Resize(size_t aChunks)
+        {
+            mPages.resize((aChunks + PAGE_SIZE - 1) / PAGE_SIZE);
+            for (size_t i = 0; i < mPages.size(); ++i)
+            {
+                mPages[i].reset(new Page(PAGE_SIZE));
+            }
+        }
+        const Chunk& Get(size_t aChunk) const
+        {
+            return *(*mPages[aChunk / PAGE_SIZE])[aChunk % PAGE_SIZE];
+        }
+        // Copies the page first if another snapshot holds it
+        void Set(size_t aChunk, const boost::shared_ptr<const Chunk>& aChunkPtr)
+        {
+            boost::shared_ptr<Page>& page = mPages[aChunk / PAGE_SIZE];
+            if (!page.unique())
+            {
+                page.reset(new Page(*page));
+            }
+            (*page)[aChunk % PAGE_SIZE] = aChunkPtr;
+        }
+    private:
+        typedef std::vector< boost::shared_ptr<const Chunk> > Page;
+        std::vector< boost::shared_ptr<Page> > mPages;
+    };
+
+    typedef ChangeList::Turn::UnitChange UnitChange;
+    static bool IsTileBefore(const UnitChange& aLeft, const UnitChange& aRight) { return aLeft.mTileId < aRight.mTileId; }
+    static bool IsUnitBefore(const UnitEntry& aLeft, UnitId aRight) { return aLeft.mUnitId < aRight; }
+
+    void BuildTileChunk(const ServerGeodesicGrid::Tiles& aTiles, size_t aChunk);
+    // Changes are sorted by tile
+    void UpdateTileChunk(size_t aChunk, const UnitChange* aChanges, const UnitChange* aChangesEnd);
+    void BuildUnitChunk(size_t aChunk);
+    // Changed slots are sorted
+    void UpdateUnitChunk(size_t aChunk, const uint32* aChanged, const uint32* aChangedEnd);
+    static UnitPosition ReadPosition(uint32 aIndex);
+    const TileChunk& GetTileChunk(TileId aTileId) const;
+
+    const GameTime mTime;
+    const uint32 mTurn;
+    const size_t mTileCount;
+    const size_t mUnitSlots;
+    // Oldest first
+    std::vector<ChangeList::TurnPtr> mTurns;
+    ChunkTable<TileChunk> mTileChunks;
+    ChunkTable<UnitChunk> mUnitChunks;
+};
+
+typedef boost::shared_ptr<const WorldSnapshot> WorldSnapshotPtr;
+
+#endif // WORLDSNAPSHOT_H
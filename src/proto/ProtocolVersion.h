@@ -1,7 +1,8 @@
 #ifndef PROTOCOLVERSION_H_INCLUDED
 #define PROTOCOLVERSION_H_INCLUDED
 
-const unsigned int PROTOCOL_VERSION = 1;
+// 2 - units created in view of client are sent as UnitEnterMsg with visual code
+const unsigned int PROTOCOL_VERSION = 2;
 
 
 #endif // PROTOCOLVERSION_H_INCLUDED